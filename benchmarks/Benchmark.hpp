@@ -0,0 +1,219 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+struct Options {
+    std::string filter;
+    size_t warmup = 2;
+    size_t repetitions = 10;
+    std::string output;
+    std::string baseline;
+    double threshold = 0.1;
+    std::string isa;
+};
+
+// Times are in seconds per iteration of the body.
+struct Result {
+    std::string name;
+    size_t iterations;
+    size_t repetitions;
+    double mean;
+    double median;
+    double stddev;
+    double min;
+    double max;
+};
+
+// Keeps the compiler from removing a computation whose result is otherwise unused. Other compilers store the value to a
+// volatile sink and read it back.
+template <typename T> void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+    static_cast<void>(sink);
+#endif
+}
+
+/**
+ * Set of named benchmarks. Each of them is prepared only if it passes the filter, and the preparation returns the body,
+ * so that building models and datasets is not timed. Every repetition times the body run a fixed number of times.
+ */
+class Suite {
+  public:
+    using Body = std::function<void()>;
+    using Prepare = std::function<Body()>;
+
+  private:
+    struct Case {
+        std::string name;
+        size_t iterations;
+        Prepare prepare;
+    };
+
+    std::vector<Case> _cases;
+
+    static Result measure(const std::string &name, size_t iterations, const Body &body, const Options &options);
+
+  public:
+    void add(const std::string &name, size_t iterations, Prepare prepare);
+    std::vector<Result> run(const Options &options) const;
+};
+
+inline void Suite::add(const std::string &name, size_t iterations, Prepare prepare) {
+    _cases.push_back({name, iterations, std::move(prepare)});
+}
+
+inline Result Suite::measure(const std::string &name, size_t iterations, const Body &body, const Options &options) {
+    std::vector<double> times;
+    for (size_t r = 0; r < options.warmup + options.repetitions; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (r >= options.warmup)
+            times.push_back(elapsed.count() / iterations);
+    }
+
+    Result result{name, iterations, times.size(), 0, 0, 0, 0, 0};
+    if (times.empty())
+        return result;
+
+    std::sort(times.begin(), times.end());
+    for (double time : times)
+        result.mean += time / times.size();
+    for (double time : times)
+        result.stddev += (time - result.mean) * (time - result.mean) / times.size();
+    result.stddev = std::sqrt(result.stddev);
+    result.median = times.size() % 2 ? times[times.size() / 2]
+                                     : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    result.min = times.front();
+    result.max = times.back();
+
+    return result;
+}
+
+inline std::vector<Result> Suite::run(const Options &options) const {
+    std::vector<Result> results;
+    for (const Case &benchmark : _cases) {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+            continue;
+
+        std::cerr << benchmark.name << "..." << std::flush;
+        Body body = benchmark.prepare();
+        results.push_back(measure(benchmark.name, benchmark.iterations, body, options));
+        std::cerr << ' ' << results.back().median * 1e6 << " us" << std::endl;
+    }
+    return results;
+}
+
+// Every benchmark is written on a line of its own, which is what readBaseline() relies on.
+inline void writeJson(std::ostream &os, const std::vector<Result> &results, const Options &options) {
+    os << "{\n";
+    os << "  \"context\": {\"compiler\": \"" << __VERSION__ << "\", \"threads\": " << std::thread::hardware_concurrency()
+       << ", \"isa\": \"" << options.isa << "\", \"warmup\": " << options.warmup
+       << ", \"repetitions\": " << options.repetitions << "},\n";
+    os << "  \"unit\": \"seconds per iteration\",\n";
+    os << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+           << ", \"repetitions\": " << r.repetitions << ", \"mean\": " << r.mean << ", \"median\": " << r.median
+           << ", \"stddev\": " << r.stddev << ", \"min\": " << r.min << ", \"max\": " << r.max << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+// Reads the medians of a file written by writeJson().
+inline std::map<std::string, double> readBaseline(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::invalid_argument("Could not open the baseline file " + path + ".");
+    }
+
+    std::map<std::string, double> medians;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median\": ");
+        if (name == std::string::npos || median == std::string::npos)
+            continue;
+
+        name += 9;
+        medians[line.substr(name, line.find('"', name) - name)] = std::stod(line.substr(median + 10));
+    }
+    return medians;
+}
+
+// Prints the change of every median against the baseline and returns the number of benchmarks that got slower by more
+// than the threshold.
+inline size_t compare(const std::vector<Result> &results, const std::map<std::string, double> &baseline,
+                      double threshold) {
+    size_t regressions = 0;
+    for (const Result &r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0)
+            continue;
+
+        double change = r.median / it->second - 1;
+        bool regressed = change > threshold;
+        regressions += regressed;
+
+        std::cerr << (regressed ? "REGRESSION " : "           ") << r.name << ": " << (change >= 0 ? "+" : "")
+                  << change * 100 << "%" << std::endl;
+    }
+    return regressions;
+}
+
+inline Options parseOptions(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing the value of the option " + argument + ".");
+        }
+
+        std::string value = argv[++i];
+        if (argument == "--filter")
+            options.filter = value;
+        else if (argument == "--warmup")
+            options.warmup = std::stoul(value);
+        else if (argument == "--repetitions")
+            options.repetitions = std::stoul(value);
+        else if (argument == "--output")
+            options.output = value;
+        else if (argument == "--baseline")
+            options.baseline = value;
+        else if (argument == "--threshold")
+            options.threshold = std::stod(value);
+        else if (argument == "--isa")
+            options.isa = value;
+        else
+            throw std::invalid_argument("Unknown option " + argument + ".");
+    }
+    return options;
+}
+
+} // namespace bench
@@ -0,0 +1,319 @@
+#include "../include/ShkyeraGrad.hpp"
+#include "Benchmark.hpp"
+
+using namespace shkyera;
+using T = Type::float32;
+
+namespace {
+
+Vec32 randomVector(size_t size) { return Vec32::of(utils::sample<T>(-1, 1, size)); }
+
+SequentialPtr<T> mlp(const std::vector<size_t> &sizes) {
+    auto builder = SequentialBuilder32::begin();
+    for (size_t i = 0; i + 1 < sizes.size(); ++i) {
+        builder = builder.add(Linear32::create(sizes[i], sizes[i + 1]));
+        builder = i + 2 < sizes.size() ? builder.add(ReLU32::create()) : builder.add(Softmax32::create());
+    }
+    return builder.build();
+}
+
+void addValueBenchmarks(bench::Suite &suite) {
+    suite.add("value/create", 100000, [] { return [] { bench::doNotOptimize(Val32::create(1)->getValue()); }; });
+
+    auto binary = [&suite](const std::string &name, auto op) {
+        suite.add("value/" + name, 100000, [op] {
+            auto a = Val32::create(1.5);
+            auto b = Val32::create(2.5);
+            return [a, b, op] { bench::doNotOptimize(op(a, b)->getValue()); };
+        });
+    };
+    binary("add", [](const ValuePtr<T> &a, const ValuePtr<T> &b) { return a + b; });
+    binary("multiply", [](const ValuePtr<T> &a, const ValuePtr<T> &b) { return a * b; });
+    binary("divide", [](const ValuePtr<T> &a, const ValuePtr<T> &b) { return a / b; });
+
+    for (size_t size : {16, 256, 4096}) {
+        suite.add("vector/dot/" + std::to_string(size), 100000 / size, [size] {
+            Vec32 a = randomVector(size);
+            Vec32 b = randomVector(size);
+            return [a, b] { bench::doNotOptimize(a.dot(b)->getValue()); };
+        });
+    }
+}
+
+// The kernels on their own, on the instruction set picked with --isa.
+void addKernelBenchmarks(bench::Suite &suite) {
+    const size_t size = 4096;
+    auto data = [size] {
+        auto x = std::make_shared<utils::AlignedVector<T>>(size);
+        std::vector<T> values = utils::sample<T>(-1, 1, size);
+        std::copy(values.begin(), values.end(), x->begin());
+        return x;
+    };
+    std::string suffix = "/" + std::to_string(size);
+
+    suite.add("kernels/dot" + suffix, 1000, [data, size] {
+        auto a = data(), b = data();
+        return [a, b, size] { bench::doNotOptimize(Kernels::dot(a->data(), b->data(), size)); };
+    });
+    suite.add("kernels/axpy" + suffix, 1000, [data, size] {
+        auto x = data(), y = data();
+        return [x, y, size] {
+            Kernels::axpy(T(1e-3), x->data(), y->data(), size);
+            bench::doNotOptimize((*y)[0]);
+        };
+    });
+    suite.add("kernels/sum" + suffix, 1000, [data, size] {
+        auto x = data();
+        return [x, size] { bench::doNotOptimize(Kernels::sum(x->data(), size)); };
+    });
+    suite.add("kernels/argmax" + suffix, 1000, [data, size] {
+        auto x = data();
+        return [x, size] { bench::doNotOptimize(Kernels::argMax(x->data(), size)); };
+    });
+
+    for (auto [name, activation] : std::vector<std::pair<std::string, Kernels::Activation>>{
+             {"relu", Kernels::Activation::ReLU},
+             {"sigmoid", Kernels::Activation::Sigmoid},
+             {"tanh", Kernels::Activation::Tanh},
+             {"exp", Kernels::Activation::Exp}}) {
+        suite.add("kernels/" + name + suffix, 1000, [data, size, activation = activation] {
+            auto x = data(), y = data();
+            return [x, y, size, activation] {
+                Kernels::activate(activation, x->data(), y->data(), size);
+                bench::doNotOptimize((*y)[0]);
+            };
+        });
+    }
+}
+
+// Shapes of the products of a Linear layer with 784 inputs and 100 outputs on a batch of 16, and a square one.
+void addGemmBenchmarks(bench::Suite &suite) {
+    struct Shape {
+        std::string name;
+        bool transposeA, transposeB;
+        size_t m, n, k;
+    };
+    for (const Shape &shape : std::vector<Shape>{{"forward/16x100x784", false, true, 16, 100, 784},
+                                                 {"input_gradient/16x784x100", false, false, 16, 784, 100},
+                                                 {"weight_gradient/100x784x16", true, false, 100, 784, 16},
+                                                 {"gemv/1x100x784", false, true, 1, 100, 784},
+                                                 {"square/256", false, false, 256, 256, 256}}) {
+        size_t iterations = std::max<size_t>(1, 20000000 / (shape.m * shape.n * shape.k));
+        suite.add("gemm/" + shape.name, iterations, [shape] {
+            auto a = std::make_shared<std::vector<T>>(utils::sample<T>(-1, 1, shape.m * shape.k));
+            auto b = std::make_shared<std::vector<T>>(utils::sample<T>(-1, 1, shape.k * shape.n));
+            auto c = std::make_shared<std::vector<T>>(shape.m * shape.n);
+            return [shape, a, b, c] {
+                Gemm::multiply(shape.transposeA, shape.transposeB, shape.m, shape.n, shape.k, T(1), a->data(),
+                               shape.transposeA ? shape.m : shape.k, b->data(), shape.transposeB ? shape.k : shape.n,
+                               T(0), c->data(), shape.n);
+                bench::doNotOptimize((*c)[0]);
+            };
+        });
+    }
+}
+
+void addLayerBenchmarks(bench::Suite &suite) {
+    for (auto [input, output] : std::vector<std::pair<size_t, size_t>>{{16, 16}, {128, 64}, {784, 64}}) {
+        std::string size = std::to_string(input) + "x" + std::to_string(output);
+        size_t iterations = std::max<size_t>(1, 200000 / (input * output));
+
+        suite.add("linear/forward/" + size, iterations, [input = input, output = output] {
+            auto layer = Linear32::create(input, output);
+            Vec32 x = randomVector(input);
+            return [layer, x] { bench::doNotOptimize(layer->forward(x)[0]->getValue()); };
+        });
+
+        suite.add("linear/forward_backward/" + size, iterations, [input = input, output = output] {
+            auto layer = Linear32::create(input, output);
+            Vec32 x = randomVector(input);
+            return [layer, x] {
+                Vec32 y = layer->forward(x);
+                std::vector<ValuePtr<T>> outputs;
+                for (const ValuePtr<T> &value : y)
+                    outputs.push_back(value);
+                Val32::sum(outputs)->backward();
+            };
+        });
+
+        suite.add("linear/batch16/forward_backward/" + size, std::max<size_t>(1, iterations / 16),
+                  [input = input, output = output] {
+                      auto layer = Linear32::create(input, output);
+                      Batch<T> x;
+                      for (size_t i = 0; i < 16; ++i)
+                          x.push_back(randomVector(input));
+                      return [layer, x] {
+                          std::vector<ValuePtr<T>> outputs;
+                          for (const Vec32 &y : layer->forward(x))
+                              for (const ValuePtr<T> &value : y)
+                                  outputs.push_back(value);
+                          Val32::sum(outputs)->backward();
+                      };
+                  });
+    }
+
+    std::vector<std::pair<std::string, ModulePtr<T>>> norms = {{"batchnorm", BatchNorm1d32::create(256)},
+                                                               {"layernorm", LayerNorm32::create(256)}};
+    for (auto [name, layer] : norms) {
+        suite.add(name + "/batch16/forward_backward/256", 20, [layer = layer] {
+            Batch<T> x;
+            for (size_t i = 0; i < 16; ++i)
+                x.push_back(randomVector(256));
+            return [layer, x] {
+                std::vector<ValuePtr<T>> outputs;
+                for (const Vec32 &y : layer->forward(x))
+                    for (const ValuePtr<T> &value : y)
+                        outputs.push_back(value);
+                Val32::sum(outputs)->backward();
+            };
+        });
+    }
+
+    // An MNIST-sized image through a 3x3 convolution with 8 filters and a 2x2 max pooling, as tensors.
+    suite.add("conv2d/batch16/forward_backward/1x28x28x8", 5, [] {
+        auto conv = Conv2D32::create({1, 28, 28}, 8, 3, 1, 1);
+        auto pool = MaxPool2D32::create(conv->outputShape(), 2);
+        Batch<T> x;
+        for (size_t i = 0; i < 16; ++i)
+            x.push_back(randomVector(784));
+        auto input = Tensor32::of(x);
+        return [conv, pool, input] { pool->forward(conv->forward(input))->sum()->backward(); };
+    });
+
+    for (size_t size : {10, 100, 1000}) {
+        suite.add("softmax/" + std::to_string(size), 100000 / size, [size] {
+            auto softmax = Softmax32::create();
+            Vec32 x = randomVector(size);
+            return [softmax, x] { bench::doNotOptimize(softmax->forward(x)[0]->getValue()); };
+        });
+    }
+}
+
+// A Softmax layer followed by the Cross Entropy, against the fused loss on the logits.
+void addLossBenchmarks(bench::Suite &suite) {
+    auto add = [&suite](const std::string &name, bool fused) {
+        suite.add("loss/" + name + "/batch16/10", 1000, [fused] {
+            Batch<T> logits, targets;
+            for (size_t i = 0; i < 16; ++i) {
+                logits.push_back(randomVector(10));
+                targets.push_back(Vec32::oneHotEncode(i % 10, 10));
+            }
+            auto softmax = Softmax32::create();
+            return [fused, logits, targets, softmax] {
+                if (fused)
+                    Loss::compute(Loss::SoftmaxCrossEntropy<T>, logits, targets);
+                else
+                    Loss::compute(Loss::CrossEntropy<T>, softmax->forward(logits), targets);
+            };
+        });
+    };
+    add("cross_entropy", false);
+    add("softmax_cross_entropy", true);
+}
+
+template <typename O> void addOptimizerBenchmark(bench::Suite &suite, const std::string &name) {
+    suite.add("optimizer/" + name + "/step", 100, [] {
+        auto network = mlp({128, 64, 10});
+        auto optimizer = std::make_shared<O>(network->parameters(), 0.001);
+        optimizer->reset();
+        Loss::compute(Loss::MSE<T>, network->forward(randomVector(128)), randomVector(10));
+        return [network, optimizer] { optimizer->step(); };
+    });
+}
+
+void addDataBenchmarks(bench::Suite &suite) {
+    suite.add("dataloader/iterate/1024x16", 10, [] {
+        auto data = std::make_shared<Dataset<Vec32, Vec32>>();
+        for (size_t i = 0; i < 1024; ++i)
+            data->addSample(randomVector(16), randomVector(1));
+        auto loader = std::make_shared<DataLoader<Vec32, Vec32>>(*data, 32, true);
+
+        return [data, loader] {
+            size_t batches = 0;
+            for (const auto &[x, y] : *loader)
+                batches += x.size();
+            bench::doNotOptimize(batches);
+        };
+    });
+}
+
+void addEndToEndBenchmarks(bench::Suite &suite) {
+    suite.add("e2e/xor/epoch", 100, [] {
+        auto data = std::make_shared<Dataset<Vec32, Vec32>>();
+        data->addSample(Vec32::of(0, 0), Vec32::of(0));
+        data->addSample(Vec32::of(0, 1), Vec32::of(1));
+        data->addSample(Vec32::of(1, 0), Vec32::of(1));
+        data->addSample(Vec32::of(1, 1), Vec32::of(0));
+        auto loader = std::make_shared<DataLoader<Vec32, Vec32>>(*data, 2, true);
+
+        auto network = SequentialBuilder32::begin()
+                           .add(Linear32::create(2, 15))
+                           .add(ReLU32::create())
+                           .add(Linear32::create(15, 5))
+                           .add(ReLU32::create())
+                           .add(Linear32::create(5, 1))
+                           .add(Sigmoid32::create())
+                           .build();
+        auto optimizer = std::make_shared<Adam32>(network->parameters(), 0.1);
+
+        return [data, loader, network, optimizer] {
+            optimizer->reset();
+            for (const auto &[x, y] : *loader)
+                Loss::compute(Loss::MSE<T>, network->forward(x), y);
+            optimizer->step();
+        };
+    });
+
+    // Same shapes as the MNIST example, with random images, so that no dataset has to be downloaded.
+    suite.add("e2e/mnist_mlp/step/batch16", 2, [] {
+        auto images = std::make_shared<std::vector<Vec32>>();
+        auto labels = std::make_shared<std::vector<Vec32>>();
+        for (size_t i = 0; i < 16; ++i) {
+            images->push_back(Vec32::of(utils::sample<T>(0, 1, 784)));
+            labels->push_back(Vec32::oneHotEncode(i % 10, 10));
+        }
+
+        auto network = mlp({784, 100, 50, 10});
+        auto optimizer = std::make_shared<Adam32>(network->parameters(), 0.01);
+
+        return [images, labels, network, optimizer] {
+            optimizer->reset();
+            Loss::compute(Loss::CrossEntropy<T>, network->forward(*images), *labels);
+            optimizer->step();
+        };
+    });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bench::Options options = bench::parseOptions(argc, argv);
+    if (!options.isa.empty())
+        Kernels::force(Kernels::parse(options.isa));
+    options.isa = Kernels::name(Kernels::current());
+
+    bench::Suite suite;
+    addValueBenchmarks(suite);
+    addKernelBenchmarks(suite);
+    addGemmBenchmarks(suite);
+    addLayerBenchmarks(suite);
+    addLossBenchmarks(suite);
+    addOptimizerBenchmark<SGD32>(suite, "SGD");
+    addOptimizerBenchmark<NAG32>(suite, "NAG");
+    addOptimizerBenchmark<Adam32>(suite, "Adam");
+    addOptimizerBenchmark<AdaMax32>(suite, "AdaMax");
+    addDataBenchmarks(suite);
+    addEndToEndBenchmarks(suite);
+
+    std::vector<bench::Result> results = suite.run(options);
+
+    if (options.output.empty()) {
+        bench::writeJson(std::cout, results, options);
+    } else {
+        std::ofstream file(options.output);
+        bench::writeJson(file, results, options);
+    }
+
+    if (!options.baseline.empty() && bench::compare(results, bench::readBaseline(options.baseline), options.threshold))
+        return 1;
+}
@@ -37,22 +37,29 @@ int main() {
                 .add(ReLU32::create())
                 .add(Linear32::create(100, 50))
                 .add(Sigmoid32::create())
-                .add(Linear32::create(50, 10))
-                .add(Softmax32::create())
+                .add(Linear32::create(50, 10))  // Logits, the loss applies the softmax
                 .build();
     // clang-format on
 
     auto optimizer = Adam32(mlp->parameters(), 0.01, 0.99);
-    auto lossFunction = Loss::CrossEntropy<Type::float32>;
+    auto lossFunction = Loss::SoftmaxCrossEntropy<Type::float32>;
+
+    Telemetry telemetry;                            // Throughput and latencies, reported every 10 seconds
+    telemetry.setJsonLinesFile("mnist.jsonl");
+    telemetry.setPrometheusFile("mnist.prom");
 
     for (size_t epoch = 0; epoch < 50; epoch++) {
         float epochLoss = 0;
         double epochAccuracy = 0;
 
-        for (const auto [x, y] : trainLoader) {
+        for (const auto [x, y] : telemetry.track(trainLoader)) { // Loading batches is timed as well
             optimizer.reset();
 
-            auto pred = mlp->forward(x);
+            std::vector<Vec32> pred;
+            {
+                auto timer = telemetry.measure(Telemetry::Phase::Forward);
+                pred = mlp->forward(x); // Every Linear layer multiplies the whole batch at once
+            }
 
             double accuracy = 0;
             for (size_t i = 0; i < pred.size(); ++i) {
@@ -66,10 +73,22 @@ int main() {
             accuracy /= pred.size();
             epochAccuracy += accuracy;
 
-            auto loss = Loss::compute(lossFunction, pred, y);
+            ValuePtr<Type::float32> loss;
+            {
+                auto timer = telemetry.measure(Telemetry::Phase::Loss);
+                loss = Loss::evaluate(lossFunction, pred, y); // Leaves the backward pass to its own phase
+            }
+            {
+                auto timer = telemetry.measure(Telemetry::Phase::Backward);
+                loss->backward();
+            }
             epochLoss = epochLoss + loss->getValue();
 
-            optimizer.step();
+            {
+                auto timer = telemetry.measure(Telemetry::Phase::Step);
+                optimizer.step();
+            }
+            telemetry.finishStep(x.size());
 
             std::cerr << "Loss: " << loss->getValue() << " Accuracy: " << accuracy << std::endl;
         }
@@ -7,16 +7,37 @@
 
 #pragma once
 
+#include "core/Expression.hpp"
+#include "core/ForwardModeGuard.hpp"
+#include "core/Graph.hpp"
+#include "core/Gemm.hpp"
+#include "core/GraphArena.hpp"
 #include "core/Image.hpp"
+#include "core/ImageShape.hpp"
+#include "core/Kernels.hpp"
+#include "core/LossScale.hpp"
+#include "core/ModuleScope.hpp"
+#include "core/NoGradGuard.hpp"
+#include "core/NodeStatistics.hpp"
+#include "core/Normalization.hpp"
+#include "core/Operation.hpp"
+#include "core/Profiler.hpp"
+#include "core/RecomputeGuard.hpp"
+#include "core/StaticGraph.hpp"
+#include "core/Tape.hpp"
+#include "core/Tensor.hpp"
 #include "core/Type.hpp"
 #include "core/Utils.hpp"
 #include "core/Value.hpp"
 #include "core/Vector.hpp"
+#include "core/WeightCache.hpp"
 
 #include "nn/Loss.hpp"
 #include "nn/Module.hpp"
 #include "nn/Neuron.hpp"
+#include "nn/Quantization.hpp"
 #include "nn/Sequential.hpp"
+#include "nn/Telemetry.hpp"
 
 #include "nn/data/DataLoader.hpp"
 #include "nn/data/Dataset.hpp"
@@ -34,5 +55,11 @@
 #include "nn/activation/Softmax.hpp"
 #include "nn/activation/Tanh.hpp"
 
+#include "nn/layers/AvgPool2D.hpp"
+#include "nn/layers/BatchNorm1d.hpp"
+#include "nn/layers/Conv2D.hpp"
 #include "nn/layers/Dropout.hpp"
+#include "nn/layers/LayerNorm.hpp"
 #include "nn/layers/Linear.hpp"
+#include "nn/layers/MaxPool2D.hpp"
+#include "nn/layers/QuantizedLinear.hpp"
@@ -0,0 +1,361 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "ForwardModeGuard.hpp"
+#include "NoGradGuard.hpp"
+#include "Tape.hpp"
+#include "Value.hpp"
+
+/**
+ * Expression templates over Values. An expression started with expr::lift() is built as a typed tree on the stack,
+ * e.g. (expr::lift(a) - b)->pow(2) * c, and becomes a single node of the graph once it is converted to a ValuePtr or
+ * passed to expr::fuse(). The backward pass of the whole tree is then one inlined function of the fused node.
+ *
+ * Under a tape or in forward mode, the expression is expanded into the regular operations instead.
+ */
+namespace shkyera::expr {
+
+template <typename T, typename Derived> class Expression;
+template <typename T> class Leaf;
+template <typename T> class Constant;
+template <typename T, typename Operand, typename Operation> class Unary;
+template <typename T, typename Left, typename Right, typename Operation> class Binary;
+
+template <typename T, typename E> ValuePtr<T> fuse(const Expression<T, E> &expression);
+
+namespace detail {
+
+template <typename X> struct ExpressionTraits {
+    static constexpr bool isExpression = false;
+};
+
+template <typename T> struct ExpressionTraits<ValuePtr<T>> {
+    static constexpr bool isExpression = false;
+    using Scalar = T;
+    using Type = Leaf<T>;
+    static Type lift(const ValuePtr<T> &value) { return Leaf<T>(value); }
+};
+
+template <typename T> struct ExpressionTraits<Leaf<T>> {
+    static constexpr bool isExpression = true;
+    using Scalar = T;
+};
+
+template <typename T> struct ExpressionTraits<Constant<T>> {
+    static constexpr bool isExpression = true;
+    using Scalar = T;
+};
+
+template <typename T, typename Operand, typename Operation> struct ExpressionTraits<Unary<T, Operand, Operation>> {
+    static constexpr bool isExpression = true;
+    using Scalar = T;
+};
+
+template <typename T, typename Left, typename Right, typename Operation>
+struct ExpressionTraits<Binary<T, Left, Right, Operation>> {
+    static constexpr bool isExpression = true;
+    using Scalar = T;
+};
+
+template <typename X> constexpr bool isExpression = ExpressionTraits<X>::isExpression;
+
+template <typename L, typename R>
+using Scalar = typename ExpressionTraits<std::conditional_t<isExpression<L> || !std::is_arithmetic_v<L>, L, R>>::Scalar;
+
+template <typename T, typename X> auto lift(const X &x) {
+    if constexpr (isExpression<X>)
+        return x;
+    else if constexpr (std::is_arithmetic_v<X>)
+        return Constant<T>(static_cast<T>(x));
+    else
+        return ExpressionTraits<X>::lift(x);
+}
+
+} // namespace detail
+
+template <typename T, typename Derived> class Expression {
+  public:
+    const Derived *operator->() const { return static_cast<const Derived *>(this); }
+    operator ValuePtr<T>() const { return fuse(*this); }
+
+    auto operator-() const;
+    auto square() const;
+    auto pow(T exponent) const;
+    auto tanh() const;
+    auto sigmoid() const;
+    auto relu() const;
+    auto exp() const;
+    auto log() const;
+    auto abs() const;
+};
+
+template <typename T> class Leaf : public Expression<T, Leaf<T>> {
+  private:
+    Value<T> *_node;
+    T _value = 0;
+    uint32_t _index = 0;
+
+  public:
+    Leaf(const ValuePtr<T> &node) : _node(node.get()) {}
+
+    T evaluate() {
+        _value = _node->_data;
+        return _value;
+    }
+    T value() const { return _value; }
+
+    // The gradient goes through the children of the fused node, which lets the parallel backward redirect it.
+    void collect(typename Value<T>::Children &children) {
+        _index = static_cast<uint32_t>(children.size());
+        children.push_back(_node->shared_from_this());
+    }
+    void propagate(Value<T> *fused, T gradient) const {
+        const ValuePtr<T> &child = fused->_children[_index];
+        if (!child->_constant)
+            child->_gradient += gradient;
+    }
+
+    ValuePtr<T> materialize() const { return _node->shared_from_this(); }
+};
+
+template <typename T> class Constant : public Expression<T, Constant<T>> {
+  private:
+    T _value;
+
+  public:
+    Constant(T value) : _value(value) {}
+
+    T evaluate() { return _value; }
+    T value() const { return _value; }
+
+    void collect(typename Value<T>::Children &) {}
+    void propagate(Value<T> *, T) const {}
+
+    ValuePtr<T> materialize() const { return Value<T>::constant(_value); }
+};
+
+template <typename T, typename Operand, typename Operation>
+class Unary : public Expression<T, Unary<T, Operand, Operation>> {
+  private:
+    Operand _operand;
+    T _parameter;
+    T _value = 0;
+
+  public:
+    Unary(const Operand &operand, T parameter = 0) : _operand(operand), _parameter(parameter) {}
+
+    T evaluate() {
+        _value = Operation::forward(_operand.evaluate(), _parameter);
+        return _value;
+    }
+    T value() const { return _value; }
+
+    void collect(typename Value<T>::Children &children) { _operand.collect(children); }
+    void propagate(Value<T> *fused, T gradient) const {
+        _operand.propagate(fused, Operation::derivative(_operand.value(), _value, _parameter) * gradient);
+    }
+
+    ValuePtr<T> materialize() const { return Operation::materialize(_operand.materialize(), _parameter); }
+};
+
+template <typename T, typename Left, typename Right, typename Operation>
+class Binary : public Expression<T, Binary<T, Left, Right, Operation>> {
+  private:
+    Left _left;
+    Right _right;
+    T _value = 0;
+
+  public:
+    Binary(const Left &left, const Right &right) : _left(left), _right(right) {}
+
+    T evaluate() {
+        T left = _left.evaluate();
+        _value = Operation::forward(left, _right.evaluate());
+        return _value;
+    }
+    T value() const { return _value; }
+
+    void collect(typename Value<T>::Children &children) {
+        _left.collect(children);
+        _right.collect(children);
+    }
+    void propagate(Value<T> *fused, T gradient) const {
+        _left.propagate(fused, Operation::leftDerivative(_left.value(), _right.value(), _value) * gradient);
+        _right.propagate(fused, Operation::rightDerivative(_left.value(), _right.value(), _value) * gradient);
+    }
+
+    ValuePtr<T> materialize() const { return Operation::materialize(_left.materialize(), _right.materialize()); }
+};
+
+namespace operations {
+
+struct Add {
+    template <typename T> static T forward(T l, T r) { return l + r; }
+    template <typename T> static T leftDerivative(T, T, T) { return 1; }
+    template <typename T> static T rightDerivative(T, T, T) { return 1; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> l, ValuePtr<T> r) { return l + r; }
+};
+
+struct Subtract {
+    template <typename T> static T forward(T l, T r) { return l - r; }
+    template <typename T> static T leftDerivative(T, T, T) { return 1; }
+    template <typename T> static T rightDerivative(T, T, T) { return -1; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> l, ValuePtr<T> r) { return l - r; }
+};
+
+struct Multiply {
+    template <typename T> static T forward(T l, T r) { return l * r; }
+    template <typename T> static T leftDerivative(T, T r, T) { return r; }
+    template <typename T> static T rightDerivative(T l, T, T) { return l; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> l, ValuePtr<T> r) { return l * r; }
+};
+
+struct Divide {
+    template <typename T> static T forward(T l, T r) { return l / r; }
+    template <typename T> static T leftDerivative(T, T r, T) { return 1 / r; }
+    template <typename T> static T rightDerivative(T, T r, T y) { return -y / r; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> l, ValuePtr<T> r) { return l / r; }
+};
+
+struct Negate {
+    template <typename T> static T forward(T x, T) { return -x; }
+    template <typename T> static T derivative(T, T, T) { return -1; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return -x; }
+};
+
+struct Square {
+    template <typename T> static T forward(T x, T) { return x * x; }
+    template <typename T> static T derivative(T x, T, T) { return 2 * x; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->square(); }
+};
+
+struct Pow {
+    template <typename T> static T forward(T x, T exponent) { return std::pow(x, exponent); }
+    template <typename T> static T derivative(T x, T, T exponent) { return exponent * std::pow(x, exponent - 1); }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T exponent) {
+        return x->pow(Value<T>::constant(exponent));
+    }
+};
+
+struct Tanh {
+    template <typename T> static T forward(T x, T) { return (std::exp(2 * x) - 1) / (std::exp(2 * x) + 1); }
+    template <typename T> static T derivative(T, T y, T) { return 1 - y * y; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->tanh(); }
+};
+
+struct Sigmoid {
+    template <typename T> static T forward(T x, T) { return 1 / (std::exp(-x) + 1); }
+    template <typename T> static T derivative(T, T y, T) { return y * (1 - y); }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->sigmoid(); }
+};
+
+struct ReLU {
+    template <typename T> static T forward(T x, T) { return x > 0 ? x : 0; }
+    template <typename T> static T derivative(T, T y, T) { return y > 0 ? 1 : 0; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->relu(); }
+};
+
+struct Exp {
+    template <typename T> static T forward(T x, T) { return std::exp(x); }
+    template <typename T> static T derivative(T, T y, T) { return y; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->exp(); }
+};
+
+struct Log {
+    template <typename T> static T forward(T x, T) { return std::log(x); }
+    template <typename T> static T derivative(T x, T, T) { return 1 / x; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->log(); }
+};
+
+struct Abs {
+    template <typename T> static T forward(T x, T) { return x < 0 ? -x : x; }
+    template <typename T> static T derivative(T x, T, T) { return x < 0 ? -1 : 1; }
+    template <typename T> static ValuePtr<T> materialize(ValuePtr<T> x, T) { return x->abs(); }
+};
+
+} // namespace operations
+
+template <typename T> Leaf<T> lift(const ValuePtr<T> &value) { return Leaf<T>(value); }
+
+template <typename T, typename E> ValuePtr<T> fuse(const Expression<T, E> &expression) {
+    E tree = static_cast<const E &>(expression);
+
+    if (NoGradGuard::isActive())
+        return Value<T>::create(tree.evaluate(), Operation::Fused);
+    if (ForwardModeGuard::isActive() || Tape<T>::current() != nullptr)
+        return tree.materialize();
+
+    ValuePtr<T> result = Value<T>::create(tree.evaluate(), Operation::Fused);
+    tree.collect(result->_children);
+    result->_backward = [node = result.get(), tree]() { tree.propagate(node, node->_gradient); };
+
+    return result;
+}
+
+template <typename T, typename D> auto Expression<T, D>::operator-() const {
+    return Unary<T, D, operations::Negate>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::square() const {
+    return Unary<T, D, operations::Square>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::pow(T exponent) const {
+    return Unary<T, D, operations::Pow>(static_cast<const D &>(*this), exponent);
+}
+template <typename T, typename D> auto Expression<T, D>::tanh() const {
+    return Unary<T, D, operations::Tanh>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::sigmoid() const {
+    return Unary<T, D, operations::Sigmoid>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::relu() const {
+    return Unary<T, D, operations::ReLU>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::exp() const {
+    return Unary<T, D, operations::Exp>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::log() const {
+    return Unary<T, D, operations::Log>(static_cast<const D &>(*this));
+}
+template <typename T, typename D> auto Expression<T, D>::abs() const {
+    return Unary<T, D, operations::Abs>(static_cast<const D &>(*this));
+}
+
+template <typename Operation, typename L, typename R> auto combine(const L &left, const R &right) {
+    using T = detail::Scalar<L, R>;
+    auto l = detail::lift<T>(left);
+    auto r = detail::lift<T>(right);
+    return Binary<T, decltype(l), decltype(r), Operation>(l, r);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<detail::isExpression<L> || detail::isExpression<R>>>
+auto operator+(const L &left, const R &right) {
+    return combine<operations::Add>(left, right);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<detail::isExpression<L> || detail::isExpression<R>>>
+auto operator-(const L &left, const R &right) {
+    return combine<operations::Subtract>(left, right);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<detail::isExpression<L> || detail::isExpression<R>>>
+auto operator*(const L &left, const R &right) {
+    return combine<operations::Multiply>(left, right);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<detail::isExpression<L> || detail::isExpression<R>>>
+auto operator/(const L &left, const R &right) {
+    return combine<operations::Divide>(left, right);
+}
+
+} // namespace shkyera::expr
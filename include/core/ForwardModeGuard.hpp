@@ -0,0 +1,47 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+namespace shkyera {
+
+/**
+ * Forward-mode differentiation. Every Value carries a tangent next to its data, which makes it a dual number. While a
+ * guard is alive, the operations on Values created on the same thread propagate the tangents of their operands to
+ * their result, and no graph, closure or tape record is kept. Seeding the tangents of a few inputs with
+ * Value::setTangent() yields a Jacobian-vector product in a single forward pass.
+ */
+class ForwardModeGuard {
+  private:
+    bool _previous;
+
+    inline static thread_local bool _active = false;
+
+  public:
+    ForwardModeGuard();
+    ~ForwardModeGuard();
+
+    ForwardModeGuard(const ForwardModeGuard &) = delete;
+    ForwardModeGuard &operator=(const ForwardModeGuard &) = delete;
+
+    static bool isActive();
+    static bool setActive(bool active);
+};
+
+inline ForwardModeGuard::ForwardModeGuard() : _previous(ForwardModeGuard::setActive(true)) {}
+
+inline ForwardModeGuard::~ForwardModeGuard() { ForwardModeGuard::setActive(_previous); }
+
+inline bool ForwardModeGuard::isActive() { return _active; }
+
+inline bool ForwardModeGuard::setActive(bool active) {
+    bool previous = _active;
+    _active = active;
+    return previous;
+}
+
+} // namespace shkyera
@@ -0,0 +1,315 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Kernels.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+namespace shkyera {
+
+/**
+ * Matrix products on row-major matrices, with the same arguments as BLAS:
+ *
+ *     C = alpha * op(A) * op(B) + beta * C
+ *
+ * where op(A) is m x k, op(B) is k x n, and op() transposes a matrix stored the other way around. The leading
+ * dimensions lda, ldb and ldc are the distances between the rows of the stored matrices. If beta is 0, C is only
+ * written to, so it may hold anything, NaNs included.
+ *
+ * Blocks of A and B are packed into panels that stay in the caches and fed to the tile kernel of the best instruction
+ * set (see Kernels). Products with a single row or column go through matrix-vector loops instead. Large products are
+ * split across a pool of threads, which is created on first use.
+ */
+class Gemm {
+  private:
+    // Block sizes of the depth, of the rows of A and of the columns of B, which keep a packed panel of B in L1, a block
+    // of A in L2 and a block of B in L3.
+    inline static const size_t depthBlock = 256;
+    inline static const size_t rowBlock = 20 * kernels::tileRows;
+    inline static const size_t columnBlock = 4096;
+
+    // Products smaller than this many multiply-adds per thread are not worth waking up the workers for.
+    inline static const size_t minParallelWork = 1 << 18;
+
+    inline static std::mutex poolMutex;
+    inline static std::shared_ptr<ThreadPool> pool = nullptr;
+    inline static size_t threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    static std::shared_ptr<ThreadPool> threadPool();
+    template <typename T> static void scale(size_t m, size_t n, T beta, T *c, size_t ldc);
+
+    template <typename T>
+    static void split(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                      const T *b, size_t ldb, T beta, T *c, size_t ldc);
+    template <typename T>
+    static void blocked(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a,
+                        size_t lda, const T *b, size_t ldb, T *c, size_t ldc);
+    template <typename T>
+    static void naive(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                      const T *b, size_t ldb, T *c, size_t ldc);
+
+  public:
+    static void setThreads(size_t threads);
+    static size_t threads();
+
+    template <typename T>
+    static void multiply(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a,
+                         size_t lda, const T *b, size_t ldb, T beta, T *c, size_t ldc);
+
+    template <typename T>
+    static void multiplyVector(bool transposeA, size_t m, size_t n, T alpha, const T *a, size_t lda, const T *x, T beta,
+                               T *y);
+};
+
+// With 1 thread, no pool is ever created.
+inline void Gemm::setThreads(size_t threads) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    threadCount = std::max<size_t>(1, threads);
+    pool = nullptr;
+}
+
+inline size_t Gemm::threads() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return threadCount;
+}
+
+inline std::shared_ptr<ThreadPool> Gemm::threadPool() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!pool && threadCount > 1)
+        pool = std::make_shared<ThreadPool>(threadCount);
+    return pool;
+}
+
+template <typename T> void Gemm::scale(size_t m, size_t n, T beta, T *c, size_t ldc) {
+    if (beta == T(1))
+        return;
+
+    for (size_t i = 0; i < m; ++i) {
+        T *row = c + i * ldc;
+        if (beta == T(0))
+            std::fill(row, row + n, T(0));
+        else
+            for (size_t j = 0; j < n; ++j)
+                row[j] *= beta;
+    }
+}
+
+template <typename T>
+void Gemm::multiply(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                    const T *b, size_t ldb, T beta, T *c, size_t ldc) {
+    if (m == 0 || n == 0)
+        return;
+
+    if constexpr (!Kernels::covers<T>) {
+        scale(m, n, beta, c, ldc);
+        naive(transposeA, transposeB, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    } else {
+        split(transposeA, transposeB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+    }
+}
+
+// Picks the matrix-vector loops or the blocked product, and shares large products between the workers.
+template <typename T>
+void Gemm::split(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                 const T *b, size_t ldb, T beta, T *c, size_t ldc) {
+    // A single row of C is op(B)^T times that row of A, and a single column is op(A) times that column of B.
+    if (m == 1 && (!transposeA || lda == 1)) {
+        multiplyVector(!transposeB, n, k, alpha, b, ldb, a, beta, c);
+        return;
+    }
+    if (n == 1 && ldc == 1 && (transposeB || ldb == 1)) {
+        multiplyVector(transposeA, m, k, alpha, a, lda, b, beta, c);
+        return;
+    }
+
+    scale(m, n, beta, c, ldc);
+    if (k == 0 || alpha == T(0))
+        return;
+
+    // With a depth of 1, every row of C adds a multiple of the single row of op(B).
+    if (k == 1 && (!transposeB || ldb == 1)) {
+        for (size_t i = 0; i < m; ++i)
+            Kernels::axpy(T(alpha * a[i * (transposeA ? 1 : lda)]), b, c + i * ldc, n);
+        return;
+    }
+
+    std::shared_ptr<ThreadPool> workers = m * n * k >= 2 * minParallelWork ? threadPool() : nullptr;
+    size_t count = workers ? std::min(workers->size(), m * n * k / minParallelWork) : 1;
+    if (count <= 1 || ThreadPool::isInsideWorker()) {
+        blocked(transposeA, transposeB, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+        return;
+    }
+
+    // Every worker computes a slice of C on its own, along the longer side, packing its own panels.
+    const bool byColumns = n >= m;
+    const size_t length = byColumns ? n : m;
+    const size_t unit = byColumns ? Kernels::table<T>().tileColumns : kernels::tileRows;
+    const size_t units = (length + unit - 1) / unit;
+    count = std::min(count, units);
+
+    workers->run(count, [&](size_t worker) {
+        size_t begin = std::min(length, units * worker / count * unit);
+        size_t end = std::min(length, units * (worker + 1) / count * unit);
+        if (begin == end)
+            return;
+
+        if (byColumns) {
+            const T *bSlice = transposeB ? b + begin * ldb : b + begin;
+            blocked(transposeA, transposeB, m, end - begin, k, alpha, a, lda, bSlice, ldb, c + begin, ldc);
+        } else {
+            const T *aSlice = transposeA ? a + begin : a + begin * lda;
+            blocked(transposeA, transposeB, end - begin, n, k, alpha, aSlice, lda, b, ldb, c + begin * ldc, ldc);
+        }
+    });
+}
+
+// Adds alpha * op(A) * op(B) to C. The depth is split into blocks, for each of which a block of op(B) is packed into
+// panels of tileColumns, and then blocks of op(A) into panels of tileRows, scaled by alpha. Panels are padded with
+// zeros, and the tiles that stick out of C are computed in a buffer. Full panels of a B that isn't transposed are read
+// in place, since its rows already hold them, which saves packing when A has few rows.
+template <typename T>
+void Gemm::blocked(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                   const T *b, size_t ldb, T *c, size_t ldc) {
+    const kernels::Table<T> &table = Kernels::table<T>();
+    const size_t rows = kernels::tileRows;
+    const size_t columns = table.tileColumns;
+
+    // Buffers only grow, so that repeated products of the same shapes don't allocate.
+    thread_local utils::AlignedVector<T> packedA;
+    thread_local utils::AlignedVector<T> packedB;
+    const size_t depth = std::min(k, depthBlock);
+    packedA.resize(std::max(packedA.size(), ((std::min(m, rowBlock) + rows - 1) / rows) * rows * depth));
+    packedB.resize(std::max(packedB.size(), ((std::min(n, columnBlock) + columns - 1) / columns) * columns * depth));
+
+    T edge[kernels::tileRows * kernels::maxTileColumns];
+
+    for (size_t jc = 0; jc < n; jc += columnBlock) {
+        const size_t nc = std::min(columnBlock, n - jc);
+        const size_t panelsB = (nc + columns - 1) / columns;
+
+        for (size_t pc = 0; pc < k; pc += depthBlock) {
+            const size_t kc = std::min(depthBlock, k - pc);
+
+            for (size_t s = 0; s < panelsB; ++s) {
+                T *panel = packedB.data() + s * kc * columns;
+                const size_t j0 = jc + s * columns;
+                const size_t width = std::min(columns, n - j0);
+                if (!transposeB && width == columns)
+                    continue;
+
+                for (size_t p = 0; p < kc; ++p) {
+                    T *out = panel + p * columns;
+                    if (transposeB) {
+                        for (size_t j = 0; j < width; ++j)
+                            out[j] = b[(j0 + j) * ldb + pc + p];
+                    } else {
+                        std::copy(b + (pc + p) * ldb + j0, b + (pc + p) * ldb + j0 + width, out);
+                    }
+                    std::fill(out + width, out + columns, T(0));
+                }
+            }
+
+            for (size_t ic = 0; ic < m; ic += rowBlock) {
+                const size_t mc = std::min(rowBlock, m - ic);
+                const size_t panelsA = (mc + rows - 1) / rows;
+
+                for (size_t s = 0; s < panelsA; ++s) {
+                    T *panel = packedA.data() + s * kc * rows;
+                    const size_t i0 = ic + s * rows;
+                    const size_t height = std::min(rows, m - i0);
+                    for (size_t p = 0; p < kc; ++p) {
+                        T *out = panel + p * rows;
+                        for (size_t i = 0; i < height; ++i)
+                            out[i] = alpha * (transposeA ? a[(pc + p) * lda + i0 + i] : a[(i0 + i) * lda + pc + p]);
+                        std::fill(out + height, out + rows, T(0));
+                    }
+                }
+
+                for (size_t sb = 0; sb < panelsB; ++sb) {
+                    const size_t j0 = jc + sb * columns;
+                    const size_t width = std::min(columns, n - j0);
+                    const bool inPlace = !transposeB && width == columns;
+                    const T *panelB = inPlace ? b + pc * ldb + j0 : packedB.data() + sb * kc * columns;
+                    const size_t stride = inPlace ? ldb : columns;
+
+                    for (size_t sa = 0; sa < panelsA; ++sa) {
+                        const size_t i0 = ic + sa * rows;
+                        const size_t height = std::min(rows, m - i0);
+                        const T *panelA = packedA.data() + sa * kc * rows;
+                        T *tile = c + i0 * ldc + j0;
+
+                        if (height == rows && width == columns) {
+                            table.tile(kc, panelA, panelB, stride, tile, ldc);
+                            continue;
+                        }
+
+                        std::fill(edge, edge + rows * columns, T(0));
+                        table.tile(kc, panelA, panelB, stride, edge, columns);
+                        for (size_t i = 0; i < height; ++i)
+                            for (size_t j = 0; j < width; ++j)
+                                tile[i * ldc + j] += edge[i * columns + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Types without kernels, accumulated in their accumulator type.
+template <typename T>
+void Gemm::naive(bool transposeA, bool transposeB, size_t m, size_t n, size_t k, T alpha, const T *a, size_t lda,
+                 const T *b, size_t ldb, T *c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i)
+        for (size_t j = 0; j < n; ++j) {
+            Type::Accumulator<T> total = 0;
+            for (size_t p = 0; p < k; ++p) {
+                Type::Accumulator<T> x = transposeA ? a[p * lda + i] : a[i * lda + p];
+                Type::Accumulator<T> y = transposeB ? b[j * ldb + p] : b[p * ldb + j];
+                total += x * y;
+            }
+            c[i * ldc + j] = c[i * ldc + j] + static_cast<Type::Accumulator<T>>(alpha) * total;
+        }
+}
+
+// y = alpha * op(A) * x + beta * y, where op(A) is m x n. Without the transposition, every element of y is a dot
+// product with a row of A, and with it, y sums the rows of A scaled by x. Either way, workers get slices of y.
+template <typename T>
+void Gemm::multiplyVector(bool transposeA, size_t m, size_t n, T alpha, const T *a, size_t lda, const T *x, T beta,
+                          T *y) {
+    scale(1, m, beta, y, m);
+    if (m == 0 || n == 0 || alpha == T(0))
+        return;
+
+    auto compute = [&](size_t begin, size_t end) {
+        if (!transposeA) {
+            for (size_t i = begin; i < end; ++i)
+                y[i] += alpha * Kernels::dot(a + i * lda, x, n);
+        } else {
+            for (size_t p = 0; p < n; ++p)
+                Kernels::axpy(T(alpha * x[p]), a + p * lda + begin, y + begin, end - begin);
+        }
+    };
+
+    std::shared_ptr<ThreadPool> workers = m * n >= 2 * minParallelWork ? threadPool() : nullptr;
+    size_t count = workers ? std::min(workers->size(), m * n / minParallelWork) : 1;
+    if (count <= 1 || ThreadPool::isInsideWorker()) {
+        compute(0, m);
+        return;
+    }
+
+    workers->run(count, [&](size_t worker) { compute(m * worker / count, m * (worker + 1) / count); });
+}
+
+} // namespace shkyera
@@ -0,0 +1,259 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ModuleScope.hpp"
+#include "Operation.hpp"
+#include "Type.hpp"
+#include "Value.hpp"
+
+namespace shkyera {
+
+template <typename T> class Graph;
+
+using Graph32 = Graph<Type::float32>;
+using Graph64 = Graph<Type::float64>;
+
+// Shape of a graph. Fan-in is the number of children of a node and fan-out the number of its parents, and both
+// histograms map a degree to the number of nodes with it. Depth is the longest path from the root to a leaf.
+struct GraphSummary {
+    size_t nodes = 0;
+    size_t leaves = 0;
+    size_t constants = 0;
+    size_t edges = 0;
+    size_t depth = 0;
+    std::array<size_t, operationCount> nodesByOperation{};
+    std::map<size_t, size_t> fanIn;
+    std::map<size_t, size_t> fanOut;
+    std::map<std::string, size_t> nodesByModule;
+
+    // Which of the parameters passed to Graph::inspect() the gradient reaches.
+    std::vector<bool> reachedParameters;
+    size_t parametersReached = 0;
+};
+
+/**
+ * Walks the graph built from a root Value, e.g. the loss returned by Loss::compute(). The graph is only there until
+ * backward() releases it, and Values recorded on a tape have no graph at all, so inspect it before calling backward()
+ * and without a tape attached.
+ */
+template <typename T> class Graph {
+  private:
+    static std::vector<Value<T> *> collect(const ValuePtr<T> &root);
+    static std::string moduleName(uint16_t module);
+
+  public:
+    static GraphSummary inspect(const ValuePtr<T> &root, const std::vector<ValuePtr<T>> &parameters = {});
+    static void saveDot(const ValuePtr<T> &root, const std::string &path, bool collapseModules = true);
+};
+
+// Nodes in topological order, children before their parents.
+template <typename T> std::vector<Value<T> *> Graph<T>::collect(const ValuePtr<T> &root) {
+    std::vector<Value<T> *> sorted;
+    std::unordered_set<Value<T> *> visited;
+    std::stack<std::pair<Value<T> *, size_t>> stack;
+
+    stack.push({root.get(), 0});
+    visited.insert(root.get());
+    while (!stack.empty()) {
+        auto &[node, next] = stack.top();
+        if (next < node->_children.size()) {
+            Value<T> *child = node->_children[next++].get();
+            if (visited.insert(child).second)
+                stack.push({child, 0});
+        } else {
+            sorted.push_back(node);
+            stack.pop();
+        }
+    }
+
+    return sorted;
+}
+
+template <typename T> std::string Graph<T>::moduleName(uint16_t module) {
+    std::string name = ModuleScope::name(module);
+    return name.empty() ? "(no module)" : name;
+}
+
+template <typename T>
+GraphSummary Graph<T>::inspect(const ValuePtr<T> &root, const std::vector<ValuePtr<T>> &parameters) {
+    std::vector<Value<T> *> sorted = collect(root);
+
+    GraphSummary summary;
+    std::unordered_map<Value<T> *, size_t> depth;
+    std::unordered_map<Value<T> *, size_t> parents;
+    for (Value<T> *node : sorted) {
+        summary.nodes++;
+        summary.leaves += node->_children.empty();
+        summary.constants += node->_constant;
+        summary.edges += node->_children.size();
+        summary.nodesByOperation[static_cast<size_t>(node->_operation)]++;
+        summary.nodesByModule[moduleName(node->_module)]++;
+        summary.fanIn[node->_children.size()]++;
+
+        size_t nodeDepth = 0;
+        for (const ValuePtr<T> &child : node->_children) {
+            nodeDepth = std::max(nodeDepth, depth[child.get()] + 1);
+            parents[child.get()]++;
+        }
+        depth[node] = nodeDepth;
+    }
+
+    for (Value<T> *node : sorted)
+        summary.fanOut[parents[node]]++;
+    summary.depth = depth[root.get()];
+
+    summary.reachedParameters.resize(parameters.size());
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        summary.reachedParameters[i] = depth.find(parameters[i].get()) != depth.end();
+        summary.parametersReached += summary.reachedParameters[i];
+    }
+
+    return summary;
+}
+
+// Writes the graph in the Graphviz format. With collapseModules, the nodes created by a module become a single box
+// with their counts, its leaves, e.g. the parameters, another one, and parallel edges are merged into one with a count.
+// Otherwise, every node is drawn, grouped in a cluster per module.
+template <typename T> void Graph<T>::saveDot(const ValuePtr<T> &root, const std::string &path, bool collapseModules) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::invalid_argument("Could not open the file " + path + " to save the graph.");
+    }
+
+    std::vector<Value<T> *> sorted = collect(root);
+    file << "digraph {\n  rankdir=BT;\n  node [fontname=\"Helvetica\"];\n";
+
+    if (!collapseModules) {
+        std::unordered_map<Value<T> *, size_t> ids;
+        std::map<uint16_t, std::vector<Value<T> *>> byModule;
+        for (Value<T> *node : sorted) {
+            ids[node] = ids.size();
+            byModule[node->_module].push_back(node);
+        }
+
+        for (const auto &[module, nodes] : byModule) {
+            if (module != 0)
+                file << "  subgraph cluster_" << module << " {\n    label=\"" << moduleName(module) << "\";\n";
+            for (Value<T> *node : nodes) {
+                file << "    n" << ids[node] << " [shape=" << (node->_children.empty() ? "ellipse" : "box")
+                     << ", label=\"" << operationName(node->_operation) << "\\n" << static_cast<double>(node->_data)
+                     << "\"];\n";
+            }
+            if (module != 0)
+                file << "  }\n";
+        }
+
+        for (Value<T> *node : sorted)
+            for (const ValuePtr<T> &child : node->_children)
+                file << "  n" << ids[child.get()] << " -> n" << ids[node] << ";\n";
+
+        file << "}\n";
+        return;
+    }
+
+    // Leaves are grouped with the module of the first node that uses them, other nodes outside of modules stay apart.
+    struct Group {
+        std::string label;
+        bool leaves;
+        std::array<size_t, operationCount> counts{};
+        size_t nodes = 0;
+    };
+    std::vector<Group> groups;
+    std::map<std::pair<uint16_t, bool>, size_t> moduleGroups;
+    std::unordered_map<Value<T> *, size_t> groupOf;
+
+    auto moduleGroup = [&](uint16_t module, bool leaves) {
+        auto [it, inserted] = moduleGroups.emplace(std::make_pair(module, leaves), groups.size());
+        if (inserted)
+            groups.push_back({moduleName(module) + (leaves ? " leaves" : ""), leaves});
+        return it->second;
+    };
+
+    for (auto node = sorted.rbegin(); node != sorted.rend(); ++node) {
+        if (!(*node)->_children.empty()) {
+            groupOf[*node] = (*node)->_module != 0 ? moduleGroup((*node)->_module, false) : groups.size();
+            if ((*node)->_module == 0)
+                groups.push_back({operationName((*node)->_operation), false});
+        }
+        for (const ValuePtr<T> &child : (*node)->_children)
+            if (child->_children.empty() && groupOf.find(child.get()) == groupOf.end())
+                groupOf[child.get()] = moduleGroup((*node)->_module, true);
+    }
+    if (sorted.size() == 1)
+        groupOf[root.get()] = moduleGroup(root->_module, true);
+
+    std::map<std::pair<size_t, size_t>, size_t> edges;
+    for (Value<T> *node : sorted) {
+        Group &group = groups[groupOf[node]];
+        group.nodes++;
+        group.counts[static_cast<size_t>(node->_operation)]++;
+        for (const ValuePtr<T> &child : node->_children)
+            if (groupOf[child.get()] != groupOf[node])
+                edges[{groupOf[child.get()], groupOf[node]}]++;
+    }
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        file << "  g" << g << " [shape=" << (groups[g].leaves ? "ellipse" : "box") << ", label=\"" << groups[g].label;
+        if (groups[g].nodes > 1) {
+            file << "\\n" << groups[g].nodes << " nodes";
+            for (size_t op = 0; op < operationCount; ++op)
+                if (groups[g].counts[op] > 0)
+                    file << "\\n" << operationName(static_cast<Operation>(op)) << ": " << groups[g].counts[op];
+        }
+        file << "\"];\n";
+    }
+
+    for (const auto &[edge, count] : edges) {
+        file << "  g" << edge.first << " -> g" << edge.second;
+        if (count > 1)
+            file << " [label=\"" << count << "\"]";
+        file << ";\n";
+    }
+
+    file << "}\n";
+}
+
+inline std::ostream &operator<<(std::ostream &os, const GraphSummary &summary) {
+    os << "Graph(nodes=" << summary.nodes << ", leaves=" << summary.leaves << ", constants=" << summary.constants
+       << ", edges=" << summary.edges << ", depth=" << summary.depth << ")\n";
+
+    for (size_t op = 0; op < operationCount; ++op)
+        if (summary.nodesByOperation[op] > 0)
+            os << "  " << operationName(static_cast<Operation>(op)) << ": " << summary.nodesByOperation[op] << '\n';
+
+    os << "  modules:";
+    for (const auto &[name, count] : summary.nodesByModule)
+        os << " [" << name << "] " << count;
+
+    os << "\n  fan-in:";
+    for (const auto &[degree, count] : summary.fanIn)
+        os << ' ' << degree << ':' << count;
+
+    os << "\n  fan-out:";
+    for (const auto &[degree, count] : summary.fanOut)
+        os << ' ' << degree << ':' << count;
+
+    if (!summary.reachedParameters.empty())
+        os << "\n  parameters reached: " << summary.parametersReached << " of " << summary.reachedParameters.size();
+
+    return os << '\n';
+}
+
+} // namespace shkyera
@@ -0,0 +1,185 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace shkyera {
+
+/**
+ * Bump allocator for graph nodes. While an arena is current on a thread (see GraphArena::Scope or
+ * Optimizer::attach), every Value created on that thread, together with its control block and list of children, is
+ * carved out of reusable slabs. Once the last node allocated from the arena is destroyed, all slabs are rewound in
+ * O(1) and reused by the next step.
+ *
+ * The arena is not thread-safe and has to outlive every node allocated from it.
+ */
+class GraphArena {
+  public:
+    struct Statistics {
+        size_t slabs;
+        size_t bytesReserved;
+        size_t bytesInUse;
+        size_t peakBytesInUse;
+        size_t bytesAllocated;
+        size_t bytesReclaimed;
+        size_t allocations;
+        size_t releases;
+    };
+
+    class Scope {
+      private:
+        GraphArena *_previous;
+
+      public:
+        Scope(GraphArena &arena);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+  private:
+    struct Slab {
+        std::unique_ptr<std::byte[]> memory;
+        size_t size;
+    };
+
+    std::vector<Slab> _slabs;
+    size_t _slabSize;
+    size_t _currentSlab = 0;
+    size_t _offset = 0;
+
+    size_t _bytesInUse = 0;
+    size_t _bytesUsedSinceRelease = 0;
+    Statistics _statistics = {};
+
+    inline static thread_local GraphArena *_current = nullptr;
+
+    void release();
+
+  public:
+    GraphArena(size_t slabSize = 1 << 20);
+
+    GraphArena(const GraphArena &) = delete;
+    GraphArena &operator=(const GraphArena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment);
+    void deallocate(void *ptr, size_t bytes);
+
+    Statistics getStatistics() const;
+
+    static GraphArena *current();
+    static GraphArena *setCurrent(GraphArena *arena);
+};
+
+/**
+ * Allocator that takes memory from the given arena, or from the global heap if the arena is a nullptr.
+ */
+template <typename U> class ArenaAllocator {
+  private:
+    GraphArena *_arena;
+
+    template <typename V> friend class ArenaAllocator;
+
+  public:
+    using value_type = U;
+
+    ArenaAllocator(GraphArena *arena = GraphArena::current()) : _arena(arena) {}
+    template <typename V> ArenaAllocator(const ArenaAllocator<V> &other) : _arena(other._arena) {}
+
+    U *allocate(size_t n) {
+        if (_arena == nullptr)
+            return std::allocator<U>().allocate(n);
+        return static_cast<U *>(_arena->allocate(n * sizeof(U), alignof(U)));
+    }
+
+    void deallocate(U *ptr, size_t n) {
+        if (_arena == nullptr)
+            std::allocator<U>().deallocate(ptr, n);
+        else
+            _arena->deallocate(ptr, n * sizeof(U));
+    }
+
+    template <typename V> bool operator==(const ArenaAllocator<V> &other) const { return _arena == other._arena; }
+    template <typename V> bool operator!=(const ArenaAllocator<V> &other) const { return _arena != other._arena; }
+};
+
+inline GraphArena::GraphArena(size_t slabSize) : _slabSize(slabSize) {}
+
+inline GraphArena::Scope::Scope(GraphArena &arena) : _previous(GraphArena::setCurrent(&arena)) {}
+
+inline GraphArena::Scope::~Scope() { GraphArena::setCurrent(_previous); }
+
+inline GraphArena *GraphArena::current() { return _current; }
+
+inline GraphArena *GraphArena::setCurrent(GraphArena *arena) {
+    GraphArena *previous = _current;
+    _current = arena;
+    return previous;
+}
+
+inline void *GraphArena::allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        if (_currentSlab < _slabs.size()) {
+            Slab &slab = _slabs[_currentSlab];
+            uintptr_t base = reinterpret_cast<uintptr_t>(slab.memory.get());
+            size_t aligned = ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+
+            if (aligned + bytes <= slab.size) {
+                size_t consumed = aligned + bytes - _offset;
+                _offset = aligned + bytes;
+
+                _bytesInUse += bytes;
+                _bytesUsedSinceRelease += consumed;
+                _statistics.bytesAllocated += bytes;
+                _statistics.peakBytesInUse = std::max(_statistics.peakBytesInUse, _bytesInUse);
+                _statistics.allocations++;
+
+                return slab.memory.get() + aligned;
+            }
+
+            _currentSlab++;
+            _offset = 0;
+            continue;
+        }
+
+        size_t size = std::max(_slabSize, bytes + alignment);
+        _slabs.push_back({std::make_unique<std::byte[]>(size), size});
+        _statistics.slabs++;
+        _statistics.bytesReserved += size;
+    }
+}
+
+inline void GraphArena::deallocate(void *, size_t bytes) {
+    _bytesInUse -= bytes;
+    if (_bytesInUse == 0)
+        release();
+}
+
+inline void GraphArena::release() {
+    _statistics.bytesReclaimed += _bytesUsedSinceRelease;
+    _statistics.releases++;
+
+    _bytesUsedSinceRelease = 0;
+    _currentSlab = 0;
+    _offset = 0;
+}
+
+inline GraphArena::Statistics GraphArena::getStatistics() const {
+    Statistics statistics = _statistics;
+    statistics.bytesInUse = _bytesInUse;
+    return statistics;
+}
+
+} // namespace shkyera
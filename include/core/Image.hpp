@@ -10,9 +10,21 @@
 #include <string>
 #include <vector>
 
+// The compiled library holds the only copy of stb_image. Without it, every translation unit gets a private one.
+#ifndef SHKYERA_COMPILED_LIBRARY
+#define STB_IMAGE_STATIC
 #define STB_IMAGE_IMPLEMENTATION
+#endif
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
 #include "../external/stb_image.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
 
+#include "ImageShape.hpp"
 #include "Vector.hpp"
 
 namespace shkyera {
@@ -20,15 +32,19 @@ namespace shkyera {
 class Image {
   private:
     std::vector<uint8_t> _data;
+    ImageShape _shape;
 
   public:
     Image() = default;
     Image(std::string filename, bool grayscale = true);
 
+    ImageShape shape() const;
+
     template <typename T> Vector<T> flatten(size_t takeEvery = 1) const;
+    template <typename T> Vector<T> planes() const;
 };
 
-Image::Image(std::string filename, bool grayscale) {
+inline Image::Image(std::string filename, bool grayscale) {
     int width, height, channels;
     uint8_t *imageData = nullptr;
 
@@ -47,9 +63,12 @@ Image::Image(std::string filename, bool grayscale) {
     else
         _data.assign(imageData, imageData + (width * height * 3));
 
+    _shape = {grayscale ? size_t(1) : size_t(3), static_cast<size_t>(height), static_cast<size_t>(width)};
     stbi_image_free(imageData);
 }
 
+inline ImageShape Image::shape() const { return _shape; }
+
 template <typename T> Vector<T> Image::flatten(size_t takeEvery) const {
     std::vector<T> converted;
     converted.reserve(_data.size());
@@ -58,4 +77,15 @@ template <typename T> Vector<T> Image::flatten(size_t takeEvery) const {
     return Vector<T>::of(converted);
 }
 
+// Pixels channel by channel, which is the layout expected by Conv2D and the pooling layers. flatten() keeps the
+// channels of a pixel next to each other instead.
+template <typename T> Vector<T> Image::planes() const {
+    const size_t pixels = _shape.height * _shape.width;
+    std::vector<T> converted(_data.size());
+    for (size_t p = 0; p < pixels; ++p)
+        for (size_t c = 0; c < _shape.channels; ++c)
+            converted[c * pixels + p] = static_cast<T>(_data[p * _shape.channels + c]);
+    return Vector<T>::of(converted);
+}
+
 } // namespace shkyera
@@ -0,0 +1,104 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace shkyera {
+
+/**
+ * Channels, height and width of an image whose pixels are stored channel by channel and row by row, which is how
+ * convolutions and pooling read a Vector or a row of a Tensor.
+ */
+struct ImageShape {
+    size_t channels = 1;
+    size_t height = 0;
+    size_t width = 0;
+
+    size_t size() const;
+    std::string toString() const;
+
+    ImageShape slide(size_t outputChannels, size_t kernel, size_t stride, size_t padding) const;
+
+    template <typename E>
+    void im2col(const E *image, size_t kernel, size_t stride, size_t padding, const E &fill, E *columns) const;
+    template <typename E> void col2im(const E *columns, size_t kernel, size_t stride, size_t padding, E *image) const;
+};
+
+inline size_t ImageShape::size() const { return channels * height * width; }
+
+inline std::string ImageShape::toString() const {
+    return "(" + std::to_string(channels) + ", " + std::to_string(height) + ", " + std::to_string(width) + ")";
+}
+
+// Shape of the output of a square window sliding over the image, which is padded with the given number of pixels on
+// every side.
+inline ImageShape ImageShape::slide(size_t outputChannels, size_t kernel, size_t stride, size_t padding) const {
+    if (stride == 0) {
+        throw std::invalid_argument("The stride of a window must be positive.");
+    }
+    if (kernel == 0 || kernel > height + 2 * padding || kernel > width + 2 * padding) {
+        throw std::invalid_argument("A window of size " + std::to_string(kernel) + " with padding " +
+                                    std::to_string(padding) + " does not fit into an image of shape " + toString() +
+                                    ".");
+    }
+
+    return {outputChannels, (height + 2 * padding - kernel) / stride + 1, (width + 2 * padding - kernel) / stride + 1};
+}
+
+// Lays the windows out as columns of a matrix, so that a convolution becomes a single matrix product. Row (c, ky, kx)
+// holds the pixel under that position of the window for every output pixel, or the fill where it covers the padding.
+template <typename E>
+void ImageShape::im2col(const E *image, size_t kernel, size_t stride, size_t padding, const E &fill,
+                        E *columns) const {
+    const ImageShape out = slide(channels, kernel, stride, padding);
+    const size_t positions = out.height * out.width;
+
+    for (size_t c = 0; c < channels; ++c)
+        for (size_t ky = 0; ky < kernel; ++ky)
+            for (size_t kx = 0; kx < kernel; ++kx) {
+                E *row = columns + ((c * kernel + ky) * kernel + kx) * positions;
+                for (size_t oy = 0; oy < out.height; ++oy) {
+                    const size_t y = oy * stride + ky;
+                    const bool insideRow = y >= padding && y < height + padding;
+                    for (size_t ox = 0; ox < out.width; ++ox) {
+                        const size_t x = ox * stride + kx;
+                        const bool inside = insideRow && x >= padding && x < width + padding;
+                        row[oy * out.width + ox] =
+                            inside ? image[(c * height + y - padding) * width + x - padding] : fill;
+                    }
+                }
+            }
+}
+
+// The reverse of im2col(), which adds every entry of the columns to the pixel it was taken from.
+template <typename E>
+void ImageShape::col2im(const E *columns, size_t kernel, size_t stride, size_t padding, E *image) const {
+    const ImageShape out = slide(channels, kernel, stride, padding);
+    const size_t positions = out.height * out.width;
+
+    for (size_t c = 0; c < channels; ++c)
+        for (size_t ky = 0; ky < kernel; ++ky)
+            for (size_t kx = 0; kx < kernel; ++kx) {
+                const E *row = columns + ((c * kernel + ky) * kernel + kx) * positions;
+                for (size_t oy = 0; oy < out.height; ++oy) {
+                    const size_t y = oy * stride + ky;
+                    if (y < padding || y >= height + padding)
+                        continue;
+                    for (size_t ox = 0; ox < out.width; ++ox) {
+                        const size_t x = ox * stride + kx;
+                        if (x >= padding && x < width + padding)
+                            image[(c * height + y - padding) * width + x - padding] += row[oy * out.width + ox];
+                    }
+                }
+            }
+}
+
+} // namespace shkyera
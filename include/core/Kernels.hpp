@@ -0,0 +1,203 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "Type.hpp"
+#include "kernels/AVX2.hpp"
+#include "kernels/AVX512.hpp"
+#include "kernels/Common.hpp"
+#include "kernels/SSE.hpp"
+#include "kernels/Scalar.hpp"
+
+namespace shkyera {
+
+class Gemm;
+
+/**
+ * Vectorized loops over contiguous arrays of floats and doubles. Every instruction set is compiled into the binary, and
+ * the best one the processor supports is picked at startup, so nothing has to be built with -march=native. An
+ * instruction set can also be forced, e.g. to compare them in benchmarks. Defining SHKYERA_DISABLE_SIMD leaves only the
+ * portable kernels.
+ *
+ * Other types, e.g. the 16-bit floats, are computed in their accumulator type. Sums are reordered across the lanes of a
+ * register, so results can differ in the last bits between instruction sets.
+ */
+class Kernels {
+  public:
+    using Isa = kernels::Isa;
+    using Activation = kernels::Activation;
+
+    template <typename T> static constexpr bool covers = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+    static Isa detect();
+    static bool isSupported(Isa isa);
+    static Isa current();
+    static void force(Isa isa);
+
+    static const char *name(Isa isa);
+    static Isa parse(const std::string &name);
+
+    template <typename T> static Type::Accumulator<T> dot(const T *a, const T *b, size_t size);
+    template <typename T> static void axpy(T alpha, const T *x, T *y, size_t size);
+    template <typename T> static Type::Accumulator<T> sum(const T *x, size_t size);
+    template <typename T> static size_t argMax(const T *x, size_t size);
+    template <typename T> static void activate(Activation activation, const T *x, T *y, size_t size);
+    template <typename T>
+    static void derivative(Activation activation, const T *y, const T *dy, T *dx, size_t size);
+
+  private:
+    friend class Gemm;
+
+    inline static const size_t chunkSize = 256;
+    inline static std::atomic<Isa> _isa{detect()};
+
+    template <typename T> static const kernels::Table<T> &table();
+};
+
+inline Kernels::Isa Kernels::detect() {
+#ifdef SHKYERA_X86_KERNELS
+    for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE})
+        if (isSupported(isa))
+            return isa;
+#endif
+    return Isa::Scalar;
+}
+
+inline bool Kernels::isSupported(Isa isa) {
+#ifdef SHKYERA_X86_KERNELS
+    __builtin_cpu_init();
+    switch (isa) {
+    case Isa::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::SSE:
+        return __builtin_cpu_supports("sse2");
+    default:
+        break;
+    }
+#endif
+    return isa == Isa::Scalar;
+}
+
+inline Kernels::Isa Kernels::current() { return _isa.load(std::memory_order_relaxed); }
+
+inline void Kernels::force(Isa isa) {
+    if (!isSupported(isa)) {
+        throw std::invalid_argument(std::string("The instruction set ") + name(isa) +
+                                    " is not supported by this processor or build.");
+    }
+    _isa.store(isa, std::memory_order_relaxed);
+}
+
+inline const char *Kernels::name(Isa isa) {
+    static const char *names[kernels::isaCount] = {"scalar", "sse", "avx2", "avx512"};
+    return names[static_cast<size_t>(isa)];
+}
+
+inline Kernels::Isa Kernels::parse(const std::string &name) {
+    for (size_t i = 0; i < kernels::isaCount; ++i)
+        if (name == Kernels::name(static_cast<Isa>(i)))
+            return static_cast<Isa>(i);
+
+    throw std::invalid_argument("Unknown instruction set " + name + ". Use one of scalar, sse, avx2 or avx512.");
+}
+
+template <typename T> const kernels::Table<T> &Kernels::table() {
+    static_assert(covers<T>, "Kernels are only provided for float and double.");
+
+    switch (current()) {
+#ifdef SHKYERA_X86_KERNELS
+    case Isa::AVX512:
+        return kernels::avx512::table<T>;
+    case Isa::AVX2:
+        return kernels::avx2::table<T>;
+    case Isa::SSE:
+        return kernels::sse::table<T>;
+#endif
+    default:
+        return kernels::scalar::table<T>;
+    }
+}
+
+template <typename T> Type::Accumulator<T> Kernels::dot(const T *a, const T *b, size_t size) {
+    if constexpr (covers<T>)
+        return table<T>().dot(a, b, size);
+
+    Type::Accumulator<T> total = 0;
+    for (size_t i = 0; i < size; ++i)
+        total += static_cast<Type::Accumulator<T>>(a[i]) * static_cast<Type::Accumulator<T>>(b[i]);
+    return total;
+}
+
+// y += alpha * x
+template <typename T> void Kernels::axpy(T alpha, const T *x, T *y, size_t size) {
+    if constexpr (covers<T>) {
+        table<T>().axpy(alpha, x, y, size);
+    } else {
+        Type::Accumulator<T> scale = alpha;
+        for (size_t i = 0; i < size; ++i)
+            y[i] = y[i] + scale * x[i];
+    }
+}
+
+template <typename T> Type::Accumulator<T> Kernels::sum(const T *x, size_t size) {
+    if constexpr (covers<T>)
+        return table<T>().sum(x, size);
+
+    Type::Accumulator<T> total = 0;
+    for (size_t i = 0; i < size; ++i)
+        total += x[i];
+    return total;
+}
+
+template <typename T> size_t Kernels::argMax(const T *x, size_t size) {
+    if constexpr (covers<T>)
+        return table<T>().argMax(x, size);
+    return std::max_element(x, x + size) - x;
+}
+
+// y = f(x), where x and y may be the same array.
+template <typename T> void Kernels::activate(Activation activation, const T *x, T *y, size_t size) {
+    if constexpr (covers<T>) {
+        table<T>().activate[static_cast<size_t>(activation)](x, y, size);
+    } else {
+        Type::Accumulator<T> buffer[chunkSize];
+        for (size_t begin = 0; begin < size; begin += chunkSize) {
+            size_t count = std::min(chunkSize, size - begin);
+            std::copy(x + begin, x + begin + count, buffer);
+            activate(activation, buffer, buffer, count);
+            std::copy(buffer, buffer + count, y + begin);
+        }
+    }
+}
+
+// dx += dy * f'(x), given y = f(x).
+template <typename T> void Kernels::derivative(Activation activation, const T *y, const T *dy, T *dx, size_t size) {
+    if constexpr (covers<T>) {
+        table<T>().derivative[static_cast<size_t>(activation)](y, dy, dx, size);
+    } else {
+        Type::Accumulator<T> buffers[3][chunkSize];
+        for (size_t begin = 0; begin < size; begin += chunkSize) {
+            size_t count = std::min(chunkSize, size - begin);
+            std::copy(y + begin, y + begin + count, buffers[0]);
+            std::copy(dy + begin, dy + begin + count, buffers[1]);
+            std::copy(dx + begin, dx + begin + count, buffers[2]);
+            derivative(activation, buffers[0], buffers[1], buffers[2], count);
+            std::copy(buffers[2], buffers[2] + count, dx + begin);
+        }
+    }
+}
+
+} // namespace shkyera
@@ -0,0 +1,34 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+namespace shkyera {
+
+/**
+ * Gradient with which Value::backward() and Tensor::backward() seed the root on the current thread, 1 by default.
+ * Optimizers with loss scaling make their scale current on every reset() and divide it out of the gradients in step(),
+ * so that small gradients stored in 16-bit types are not flushed to zero on the way back.
+ */
+class LossScale {
+  private:
+    inline static thread_local double _current = 1;
+
+  public:
+    static double current();
+    static double setCurrent(double scale);
+};
+
+inline double LossScale::current() { return _current; }
+
+inline double LossScale::setCurrent(double scale) {
+    double previous = _current;
+    _current = scale;
+    return previous;
+}
+
+} // namespace shkyera
@@ -0,0 +1,84 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace shkyera {
+
+/**
+ * Tags the Values created on the same thread while the scope is alive with the module that created them, so that the
+ * graph can be inspected per module (see Graph). Sequential opens a scope for each of its layers, and Loss::compute for
+ * the loss. Modules are identified by names interned with ModuleScope::intern(). Scopes can be nested.
+ */
+class ModuleScope {
+  private:
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::string> names = {""};
+        std::unordered_map<std::string, uint16_t> ids;
+    };
+
+    uint16_t _previous;
+
+    inline static thread_local uint16_t _current = 0;
+
+    static Registry &registry();
+
+  public:
+    explicit ModuleScope(uint16_t module);
+    ~ModuleScope();
+
+    ModuleScope(const ModuleScope &) = delete;
+    ModuleScope &operator=(const ModuleScope &) = delete;
+
+    static uint16_t current();
+    static uint16_t intern(const std::string &name);
+    static std::string name(uint16_t module);
+};
+
+inline ModuleScope::ModuleScope(uint16_t module) : _previous(_current) { _current = module; }
+
+inline ModuleScope::~ModuleScope() { _current = _previous; }
+
+// Never destroyed, so that the names stay valid during static destruction.
+inline ModuleScope::Registry &ModuleScope::registry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+inline uint16_t ModuleScope::current() { return _current; }
+
+// Returns the same identifier for the same name. Once all of them are taken, new names get 0, i.e. no module.
+inline uint16_t ModuleScope::intern(const std::string &name) {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    auto it = shared.ids.find(name);
+    if (it != shared.ids.end())
+        return it->second;
+    if (shared.names.size() > UINT16_MAX)
+        return 0;
+
+    uint16_t module = static_cast<uint16_t>(shared.names.size());
+    shared.names.push_back(name);
+    shared.ids.emplace(name, module);
+    return module;
+}
+
+inline std::string ModuleScope::name(uint16_t module) {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return module < shared.names.size() ? shared.names[module] : "";
+}
+
+} // namespace shkyera
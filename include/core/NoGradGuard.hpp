@@ -0,0 +1,47 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+namespace shkyera {
+
+/**
+ * While a guard is alive, every operation on Values and Tensors created on the same thread only computes its result.
+ * No children, closures or tape records are kept, so the results cannot be differentiated, but inference and
+ * validation run faster and release their memory as soon as the results go out of scope. Guards can be nested, and
+ * other threads keep building graphs as usual.
+ */
+class NoGradGuard {
+  private:
+    bool _previous;
+
+    inline static thread_local bool _active = false;
+
+  public:
+    NoGradGuard();
+    ~NoGradGuard();
+
+    NoGradGuard(const NoGradGuard &) = delete;
+    NoGradGuard &operator=(const NoGradGuard &) = delete;
+
+    static bool isActive();
+    static bool setActive(bool active);
+};
+
+inline NoGradGuard::NoGradGuard() : _previous(NoGradGuard::setActive(true)) {}
+
+inline NoGradGuard::~NoGradGuard() { NoGradGuard::setActive(_previous); }
+
+inline bool NoGradGuard::isActive() { return _active; }
+
+inline bool NoGradGuard::setActive(bool active) {
+    bool previous = _active;
+    _active = active;
+    return previous;
+}
+
+} // namespace shkyera
@@ -0,0 +1,201 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Operation.hpp"
+
+namespace shkyera {
+
+/**
+ * Process-wide accounting of the Value nodes of all types. Every thread counts into a block of its own with plain
+ * stores, so the counters stay on in production at the cost of a few additions per node, and snapshot() sums the
+ * blocks of all threads, including the ones that already exited.
+ *
+ * A node is leaked if it is destroyed while still holding its children, i.e. its graph was built, but never released
+ * by backward(). This usually means that an evaluation loop should run under a NoGradGuard.
+ */
+class NodeStatistics {
+  public:
+    struct Snapshot {
+        size_t liveNodes;
+        size_t peakNodes;
+        size_t createdNodes;
+        size_t leakedNodes;
+        size_t nodeBytes;
+        size_t childrenBytes;
+        std::array<size_t, operationCount> createdByOperation;
+    };
+
+  private:
+    struct Block {
+        std::atomic<int64_t> created{0};
+        std::atomic<int64_t> destroyed{0};
+        std::atomic<int64_t> leaked{0};
+        std::atomic<int64_t> nodeBytes{0};
+        std::atomic<int64_t> childrenBytes{0};
+        std::atomic<int64_t> peak{0};
+        std::atomic<uint64_t> epoch{0};
+        std::array<std::atomic<int64_t>, operationCount> byOperation{};
+        bool owned = false;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Block>> blocks;
+        std::atomic<uint64_t> epoch{1};
+    };
+
+    // Hands the block of an exiting thread over to the next new thread. The counts stay, since they only add up.
+    struct Release {
+        ~Release();
+    };
+
+    inline static thread_local Block *_block = nullptr;
+    inline static thread_local bool _exiting = false;
+
+    static Registry &registry();
+    static Block &block();
+    static void add(std::atomic<int64_t> &counter, int64_t amount);
+
+  public:
+    static void created(Operation operation, size_t bytes);
+    static void destroyed(size_t bytes, bool leaked);
+    static void allocatedChildren(size_t bytes);
+    static void releasedChildren(size_t bytes);
+
+    static Snapshot snapshot();
+    static void resetPeak();
+};
+
+// Never destroyed, so that nodes released during static destruction can still be counted.
+inline NodeStatistics::Registry &NodeStatistics::registry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+inline NodeStatistics::Block &NodeStatistics::block() {
+    if (_block != nullptr)
+        return *_block;
+
+    Registry &shared = registry();
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (std::unique_ptr<Block> &candidate : shared.blocks) {
+            if (!candidate->owned) {
+                _block = candidate.get();
+                break;
+            }
+        }
+        if (_block == nullptr) {
+            shared.blocks.push_back(std::make_unique<Block>());
+            _block = shared.blocks.back().get();
+        }
+        _block->owned = true;
+    }
+
+    // After the thread started exiting, the block is kept until the end of the process instead.
+    if (!_exiting) {
+        thread_local Release release;
+    }
+
+    return *_block;
+}
+
+inline NodeStatistics::Release::~Release() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    _block->owned = false;
+    _block = nullptr;
+    _exiting = true;
+}
+
+inline void NodeStatistics::add(std::atomic<int64_t> &counter, int64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void NodeStatistics::created(Operation operation, size_t bytes) {
+    Block &counts = block();
+    add(counts.created, 1);
+    add(counts.nodeBytes, bytes);
+    add(counts.byOperation[static_cast<size_t>(operation)], 1);
+
+    int64_t live = counts.created.load(std::memory_order_relaxed) - counts.destroyed.load(std::memory_order_relaxed);
+    uint64_t epoch = registry().epoch.load(std::memory_order_relaxed);
+    if (counts.epoch.load(std::memory_order_relaxed) != epoch) {
+        counts.epoch.store(epoch, std::memory_order_relaxed);
+        counts.peak.store(live, std::memory_order_relaxed);
+    } else if (live > counts.peak.load(std::memory_order_relaxed)) {
+        counts.peak.store(live, std::memory_order_relaxed);
+    }
+}
+
+inline void NodeStatistics::destroyed(size_t bytes, bool leaked) {
+    Block &counts = block();
+    add(counts.destroyed, 1);
+    add(counts.nodeBytes, -static_cast<int64_t>(bytes));
+    if (leaked)
+        add(counts.leaked, 1);
+}
+
+inline void NodeStatistics::allocatedChildren(size_t bytes) { add(block().childrenBytes, bytes); }
+
+inline void NodeStatistics::releasedChildren(size_t bytes) { add(block().childrenBytes, -static_cast<int64_t>(bytes)); }
+
+// The peak is exact when each graph is built and released on a single thread. Otherwise, it is the sum of the peaks
+// seen by every thread, which is an upper bound.
+inline NodeStatistics::Snapshot NodeStatistics::snapshot() {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    uint64_t epoch = shared.epoch.load(std::memory_order_relaxed);
+
+    int64_t created = 0, destroyed = 0, leaked = 0, nodeBytes = 0, childrenBytes = 0, peak = 0;
+    std::array<int64_t, operationCount> byOperation{};
+    for (const std::unique_ptr<Block> &counts : shared.blocks) {
+        int64_t blockCreated = counts->created.load(std::memory_order_relaxed);
+        int64_t blockDestroyed = counts->destroyed.load(std::memory_order_relaxed);
+
+        created += blockCreated;
+        destroyed += blockDestroyed;
+        leaked += counts->leaked.load(std::memory_order_relaxed);
+        nodeBytes += counts->nodeBytes.load(std::memory_order_relaxed);
+        childrenBytes += counts->childrenBytes.load(std::memory_order_relaxed);
+
+        int64_t blockPeak = counts->epoch.load(std::memory_order_relaxed) == epoch
+                                ? counts->peak.load(std::memory_order_relaxed)
+                                : blockCreated - blockDestroyed;
+        peak += std::max<int64_t>(blockPeak, 0);
+
+        for (size_t i = 0; i < operationCount; ++i)
+            byOperation[i] += counts->byOperation[i].load(std::memory_order_relaxed);
+    }
+
+    Snapshot result;
+    result.liveNodes = static_cast<size_t>(std::max<int64_t>(created - destroyed, 0));
+    result.peakNodes = std::max(static_cast<size_t>(peak), result.liveNodes);
+    result.createdNodes = static_cast<size_t>(created);
+    result.leakedNodes = static_cast<size_t>(leaked);
+    result.nodeBytes = static_cast<size_t>(std::max<int64_t>(nodeBytes, 0));
+    result.childrenBytes = static_cast<size_t>(std::max<int64_t>(childrenBytes, 0));
+    for (size_t i = 0; i < operationCount; ++i)
+        result.createdByOperation[i] = static_cast<size_t>(byOperation[i]);
+
+    return result;
+}
+
+// Starts a new period for peakNodes. Optimizers call it on every reset(), which makes it the peak of a step.
+inline void NodeStatistics::resetPeak() { registry().epoch.fetch_add(1, std::memory_order_relaxed); }
+
+} // namespace shkyera
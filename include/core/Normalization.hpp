@@ -0,0 +1,127 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace shkyera {
+
+/**
+ * Kernels of batch and layer normalization on a matrix of shape (rows, features), which compute
+ * y = gamma * (x - mean) / sqrt(variance + epsilon) + beta with gamma and beta given per feature. The statistics are
+ * measured in a single pass with Welford's algorithm, and the backward pass is computed in closed form instead of
+ * through a graph of the operations above.
+ */
+class Normalization {
+  public:
+    // Batch normalization takes the statistics of every feature over the rows, layer normalization those of every row.
+    enum class Axis { Batch, Features };
+
+    // Statistics of every group, either measured on the input or given, e.g. running statistics during evaluation.
+    // Given statistics are constants for the backward pass. The variance is the biased one.
+    template <typename T> struct Statistics {
+        std::vector<T> mean;
+        std::vector<T> variance;
+        bool measured = true;
+    };
+
+    static size_t groups(Axis axis, size_t rows, size_t features);
+
+    template <typename A>
+    static void measure(Axis axis, const A *x, size_t rows, size_t features, A *mean, A *variance);
+    template <typename A>
+    static void forward(Axis axis, const A *x, size_t rows, size_t features, const A *mean, const A *variance,
+                        A epsilon, const A *gamma, const A *beta, A *normalized, A *inverseDeviation, A *y);
+    template <typename A>
+    static void backward(Axis axis, bool measured, const A *normalized, const A *inverseDeviation, const A *gamma,
+                         const A *dy, size_t rows, size_t features, A *dx, A *dgamma, A *dbeta);
+};
+
+inline size_t Normalization::groups(Axis axis, size_t rows, size_t features) {
+    return axis == Axis::Batch ? features : rows;
+}
+
+template <typename A>
+void Normalization::measure(Axis axis, const A *x, size_t rows, size_t features, A *mean, A *variance) {
+    const size_t count = groups(axis, rows, features);
+    std::vector<A> squares(count, 0);
+    std::fill(mean, mean + count, A(0));
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t f = 0; f < features; ++f) {
+            const size_t g = axis == Axis::Batch ? f : r;
+            const A seen = static_cast<A>(axis == Axis::Batch ? r + 1 : f + 1);
+            const A value = x[r * features + f];
+            const A delta = value - mean[g];
+            mean[g] += delta / seen;
+            squares[g] += delta * (value - mean[g]);
+        }
+
+    const A size = static_cast<A>(axis == Axis::Batch ? rows : features);
+    for (size_t g = 0; g < count; ++g)
+        variance[g] = squares[g] / size;
+}
+
+template <typename A>
+void Normalization::forward(Axis axis, const A *x, size_t rows, size_t features, const A *mean, const A *variance,
+                            A epsilon, const A *gamma, const A *beta, A *normalized, A *inverseDeviation, A *y) {
+    const size_t count = groups(axis, rows, features);
+    for (size_t g = 0; g < count; ++g)
+        inverseDeviation[g] = A(1) / std::sqrt(variance[g] + epsilon);
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t f = 0; f < features; ++f) {
+            const size_t g = axis == Axis::Batch ? f : r;
+            const size_t i = r * features + f;
+            normalized[i] = (x[i] - mean[g]) * inverseDeviation[g];
+            y[i] = gamma[f] * normalized[i] + beta[f];
+        }
+}
+
+// Accumulates the gradients into dx, dgamma and dbeta. Through measured statistics, the gradient of a normalized
+// entry is dx = (dn - mean(dn) - n * mean(dn * n)) / deviation, where dn = dy * gamma and the means are over its group.
+template <typename A>
+void Normalization::backward(Axis axis, bool measured, const A *normalized, const A *inverseDeviation, const A *gamma,
+                             const A *dy, size_t rows, size_t features, A *dx, A *dgamma, A *dbeta) {
+    const size_t count = groups(axis, rows, features);
+    std::vector<A> sum(count, 0);
+    std::vector<A> projection(count, 0);
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t f = 0; f < features; ++f) {
+            const size_t g = axis == Axis::Batch ? f : r;
+            const size_t i = r * features + f;
+            const A dn = dy[i] * gamma[f];
+            dgamma[f] += dy[i] * normalized[i];
+            dbeta[f] += dy[i];
+            sum[g] += dn;
+            projection[g] += dn * normalized[i];
+        }
+
+    const A size = static_cast<A>(axis == Axis::Batch ? rows : features);
+    for (size_t g = 0; g < count; ++g) {
+        sum[g] /= size;
+        projection[g] /= size;
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t f = 0; f < features; ++f) {
+            const size_t g = axis == Axis::Batch ? f : r;
+            const size_t i = r * features + f;
+            const A dn = dy[i] * gamma[f];
+            if (measured)
+                dx[i] += (dn - sum[g] - normalized[i] * projection[g]) * inverseDeviation[g];
+            else
+                dx[i] += dn * inverseDeviation[g];
+        }
+}
+
+} // namespace shkyera
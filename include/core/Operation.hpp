@@ -0,0 +1,55 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shkyera {
+
+// Operation that produced a Value. Leaves are created by the user, and the operations after Max have no tape record.
+enum class Operation : uint8_t {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Negate,
+    Square,
+    Scale,
+    Tanh,
+    Sigmoid,
+    ReLU,
+    Exp,
+    Log,
+    Pow,
+    Abs,
+    Sum,
+    Dot,
+    Affine,
+    Max,
+    Leaf,
+    Constant,
+    Checkpoint,
+    Fused,
+    MatMul,
+    Normalize,
+    CrossEntropy
+};
+
+inline constexpr size_t operationCount = static_cast<size_t>(Operation::CrossEntropy) + 1;
+
+inline const char *operationName(Operation operation) {
+    static const char *names[operationCount] = {"Add",  "Subtract", "Multiply", "Divide", "Negate",   "Square",
+                                                "Scale", "Tanh",    "Sigmoid",  "ReLU",   "Exp",      "Log",
+                                                "Pow",  "Abs",      "Sum",      "Dot",    "Affine",   "Max",
+                                                "Leaf", "Constant", "Checkpoint", "Fused", "MatMul",
+                                                "Normalize", "CrossEntropy"};
+    return names[static_cast<size_t>(operation)];
+}
+
+} // namespace shkyera
@@ -0,0 +1,302 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+#include "NodeStatistics.hpp"
+#include "Operation.hpp"
+
+namespace shkyera {
+
+/**
+ * Records where the time of a training step goes. While enabled, the layers of a Sequential, the loss functions, the
+ * topological sort, the backward sweep and the optimizer steps are recorded as spans, and the backward closures are
+ * timed per operation. The spans can be saved in the Chrome trace format and opened in Perfetto or chrome://tracing.
+ *
+ * When disabled, which is the default, a span costs a single load of a flag. Defining SHKYERA_DISABLE_PROFILER removes
+ * the profiler at compile time.
+ */
+class Profiler {
+  public:
+    struct SpanStatistics {
+        std::string name;
+        std::string category;
+        size_t count = 0;
+        double seconds = 0;
+    };
+
+    struct OperationStatistics {
+        size_t forwardCount = 0;
+        size_t backwardCount = 0;
+        double backwardSeconds = 0;
+    };
+
+    // Times of the backward closures, gathered by a thread and added to the profiler at once.
+    struct OperationTimes {
+        std::array<uint64_t, operationCount> count{};
+        std::array<int64_t, operationCount> nanoseconds{};
+
+        void add(Operation operation, int64_t duration);
+    };
+
+    class Span {
+      private:
+        const char *_name;
+        const char *_category;
+        int64_t _start;
+
+      public:
+        Span(const char *name, const char *category);
+        ~Span();
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+    };
+
+  private:
+    struct Event {
+        std::string name;
+        const char *category;
+        uint32_t thread;
+        int64_t start;
+        int64_t duration;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::vector<Event> events;
+        OperationTimes backward;
+        std::array<size_t, operationCount> createdAtStart{};
+        std::atomic<uint32_t> threads{0};
+    };
+
+    inline static std::atomic<bool> _enabled = false;
+
+    static State &state();
+    static uint32_t threadId();
+    static std::string escape(const std::string &text);
+
+  public:
+    static void enable();
+    static void disable();
+    static bool isEnabled();
+    static void clear();
+
+    static int64_t now();
+    static void record(const char *name, const char *category, int64_t start, int64_t end);
+    static void addOperations(const OperationTimes &times);
+
+    static std::vector<SpanStatistics> spans();
+    static std::array<OperationStatistics, operationCount> operations();
+
+    static void printSummary(std::ostream &os);
+    static void saveChromeTrace(const std::string &path);
+
+    template <typename M> static std::string moduleName(const M &module);
+};
+
+inline void Profiler::OperationTimes::add(Operation operation, int64_t duration) {
+    count[static_cast<size_t>(operation)]++;
+    nanoseconds[static_cast<size_t>(operation)] += duration;
+}
+
+inline Profiler::Span::Span(const char *name, const char *category)
+    : _name(name), _category(category), _start(isEnabled() ? now() : -1) {}
+
+inline Profiler::Span::~Span() {
+    if (_start >= 0)
+        record(_name, _category, _start, now());
+}
+
+// Never destroyed, so that spans ending during static destruction can still be recorded.
+inline Profiler::State &Profiler::state() {
+    static State *state = new State();
+    return *state;
+}
+
+inline uint32_t Profiler::threadId() {
+    thread_local uint32_t id = state().threads.fetch_add(1, std::memory_order_relaxed) + 1;
+    return id;
+}
+
+inline std::string Profiler::escape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Operation counts start from zero on every enable(), spans and times keep adding up until clear().
+inline void Profiler::enable() {
+#ifndef SHKYERA_DISABLE_PROFILER
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.createdAtStart = NodeStatistics::snapshot().createdByOperation;
+    _enabled.store(true, std::memory_order_relaxed);
+#endif
+}
+
+inline void Profiler::disable() { _enabled.store(false, std::memory_order_relaxed); }
+
+inline bool Profiler::isEnabled() {
+#ifdef SHKYERA_DISABLE_PROFILER
+    return false;
+#else
+    return _enabled.load(std::memory_order_relaxed);
+#endif
+}
+
+inline void Profiler::clear() {
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.events.clear();
+    shared.backward = OperationTimes();
+    shared.createdAtStart = NodeStatistics::snapshot().createdByOperation;
+}
+
+inline int64_t Profiler::now() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void Profiler::record(const char *name, const char *category, int64_t start, int64_t end) {
+    uint32_t thread = threadId();
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.events.push_back({name, category, thread, start, end - start});
+}
+
+inline void Profiler::addOperations(const OperationTimes &times) {
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (size_t i = 0; i < operationCount; ++i) {
+        shared.backward.count[i] += times.count[i];
+        shared.backward.nanoseconds[i] += times.nanoseconds[i];
+    }
+}
+
+// Nested spans are counted in full, e.g. a checkpointed segment also shows up in the backward sweep around it.
+inline std::vector<Profiler::SpanStatistics> Profiler::spans() {
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    std::map<std::pair<std::string, std::string>, SpanStatistics> byName;
+    for (const Event &event : shared.events) {
+        SpanStatistics &statistics = byName[{event.category, event.name}];
+        statistics.name = event.name;
+        statistics.category = event.category;
+        statistics.count++;
+        statistics.seconds += event.duration / 1e9;
+    }
+
+    std::vector<SpanStatistics> result;
+    for (const auto &[key, statistics] : byName)
+        result.push_back(statistics);
+    return result;
+}
+
+// The forward operations are not timed one by one, since most of them take nanoseconds. Their time is a part of the
+// spans of the modules and losses.
+inline std::array<Profiler::OperationStatistics, operationCount> Profiler::operations() {
+    std::array<size_t, operationCount> created = NodeStatistics::snapshot().createdByOperation;
+
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    std::array<OperationStatistics, operationCount> result;
+    for (size_t i = 0; i < operationCount; ++i) {
+        result[i].forwardCount = created[i] - shared.createdAtStart[i];
+        result[i].backwardCount = shared.backward.count[i];
+        result[i].backwardSeconds = shared.backward.nanoseconds[i] / 1e9;
+    }
+    return result;
+}
+
+inline void Profiler::printSummary(std::ostream &os) {
+    for (const SpanStatistics &span : spans())
+        os << span.category << ' ' << span.name << ": " << span.count << " calls, " << span.seconds << "s\n";
+
+    std::array<OperationStatistics, operationCount> operationStatistics = operations();
+    for (size_t i = 0; i < operationCount; ++i) {
+        const OperationStatistics &op = operationStatistics[i];
+        if (op.forwardCount == 0 && op.backwardCount == 0)
+            continue;
+        os << operationName(static_cast<Operation>(i)) << ": " << op.forwardCount << " created, " << op.backwardCount
+           << " backward in " << op.backwardSeconds << "s\n";
+    }
+}
+
+// Writes the spans as complete events of the Chrome trace format, with the totals of the operations as its metadata.
+inline void Profiler::saveChromeTrace(const std::string &path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::invalid_argument("Could not open the file " + path + " to save the trace.");
+    }
+
+    std::array<OperationStatistics, operationCount> operationStatistics = operations();
+
+    State &shared = state();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (size_t i = 0; i < shared.events.size(); ++i) {
+        const Event &event = shared.events[i];
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << event.category
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start / 1e3
+             << ",\"dur\":" << event.duration / 1e3 << "}";
+    }
+
+    file << "\n],\"otherData\":{";
+    bool first = true;
+    for (size_t i = 0; i < operationCount; ++i) {
+        const OperationStatistics &op = operationStatistics[i];
+        if (op.forwardCount == 0 && op.backwardCount == 0)
+            continue;
+        file << (first ? "\n" : ",\n") << "\"" << operationName(static_cast<Operation>(i)) << "\":\"" << op.forwardCount
+             << " created, " << op.backwardCount << " backward in " << op.backwardSeconds << "s\"";
+        first = false;
+    }
+    file << "\n}}\n";
+}
+
+// Name of the class of a module without its namespace and template arguments, e.g. "Linear".
+template <typename M> std::string Profiler::moduleName(const M &module) {
+    std::string name = typeid(module).name();
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status == 0 && demangled != nullptr)
+        name = demangled;
+    std::free(demangled);
+#endif
+
+    name = name.substr(0, name.find('<'));
+    size_t separator = name.rfind("::");
+    return separator == std::string::npos ? name : name.substr(separator + 2);
+}
+
+} // namespace shkyera
@@ -0,0 +1,46 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+namespace shkyera {
+
+/**
+ * Alive while Value::checkpoint recomputes a segment during backward(). The segment already ran once in the forward
+ * pass, so layers with side effects beyond their results, like the running statistics of BatchNorm1d, skip them while
+ * a guard is alive on their thread.
+ */
+class RecomputeGuard {
+  private:
+    bool _previous;
+
+    inline static thread_local bool _active = false;
+
+  public:
+    RecomputeGuard();
+    ~RecomputeGuard();
+
+    RecomputeGuard(const RecomputeGuard &) = delete;
+    RecomputeGuard &operator=(const RecomputeGuard &) = delete;
+
+    static bool isActive();
+    static bool setActive(bool active);
+};
+
+inline RecomputeGuard::RecomputeGuard() : _previous(RecomputeGuard::setActive(true)) {}
+
+inline RecomputeGuard::~RecomputeGuard() { RecomputeGuard::setActive(_previous); }
+
+inline bool RecomputeGuard::isActive() { return _active; }
+
+inline bool RecomputeGuard::setActive(bool active) {
+    bool previous = _active;
+    _active = active;
+    return previous;
+}
+
+} // namespace shkyera
@@ -0,0 +1,210 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "LossScale.hpp"
+#include "Tape.hpp"
+#include "Type.hpp"
+#include "Value.hpp"
+#include "Vector.hpp"
+
+namespace shkyera {
+
+template <typename T> class StaticGraph;
+using StaticGraph32 = StaticGraph<Type::float32>;
+using StaticGraph64 = StaticGraph<Type::float64>;
+
+/**
+ * Captures a training step once and replays it afterwards. The first call runs the step while recording it on a
+ * private tape. Later calls with batches of the same shape only bind the new inputs and targets, re-evaluate the
+ * recorded operations in place and propagate the gradients to the parameters, without allocating anything. Batches of
+ * a different shape are run eagerly.
+ *
+ * Parameters are read again on every replay, so the step can be combined with Optimizer::reset() and
+ * Optimizer::step(). Everything else is frozen at capture time: the step has to perform the same operations for every
+ * batch of a given shape, which rules out branching on compared Values and random layers such as Dropout. State kept
+ * outside of the Values, like the running statistics of BatchNorm1d, is not replayed either, so such layers refuse to
+ * be captured in training.
+ */
+template <typename T> class StaticGraph {
+  public:
+    using Step = std::function<ValuePtr<T>(const Batch<T> &inputs, const Batch<T> &targets)>;
+
+  private:
+    Step _step;
+    Tape<T> _tape;
+
+    bool _captured = false;
+    size_t _inputCount = 0;
+    size_t _targetCount = 0;
+    size_t _inputSize = 0;
+    size_t _targetSize = 0;
+
+    std::vector<uint32_t> _inputSlots;
+    std::vector<uint32_t> _leafSlots;
+    uint32_t _outputSlot = 0;
+
+    size_t _replays = 0;
+    size_t _eagerRuns = 0;
+
+    inline static thread_local bool _capturing = false;
+
+    bool matches(const Batch<T> &inputs, const Batch<T> &targets) const;
+    T capture(const Batch<T> &inputs, const Batch<T> &targets);
+    T replay(const Batch<T> &inputs, const Batch<T> &targets);
+
+  public:
+    StaticGraph(Step step);
+
+    StaticGraph(const StaticGraph &) = delete;
+    StaticGraph &operator=(const StaticGraph &) = delete;
+
+    T operator()(const Batch<T> &inputs, const Batch<T> &targets);
+    void invalidate();
+
+    bool isCaptured() const;
+    size_t getReplays() const;
+    size_t getEagerRuns() const;
+
+    static bool isCapturing();
+};
+
+template <typename T> StaticGraph<T>::StaticGraph(Step step) : _step(step) {}
+
+template <typename T> T StaticGraph<T>::operator()(const Batch<T> &inputs, const Batch<T> &targets) {
+    if (!_captured)
+        return capture(inputs, targets);
+
+    if (!matches(inputs, targets)) {
+        _eagerRuns++;
+        return _step(inputs, targets)->getValue();
+    }
+
+    _replays++;
+    return replay(inputs, targets);
+}
+
+template <typename T> void StaticGraph<T>::invalidate() {
+    _captured = false;
+    _tape.clear();
+}
+
+template <typename T> bool StaticGraph<T>::isCaptured() const { return _captured; }
+template <typename T> size_t StaticGraph<T>::getReplays() const { return _replays; }
+template <typename T> size_t StaticGraph<T>::getEagerRuns() const { return _eagerRuns; }
+
+// True while a step is being captured on this thread.
+template <typename T> bool StaticGraph<T>::isCapturing() { return _capturing; }
+
+template <typename T> bool StaticGraph<T>::matches(const Batch<T> &inputs, const Batch<T> &targets) const {
+    if (inputs.size() != _inputCount || targets.size() != _targetCount)
+        return false;
+
+    for (const Vector<T> &input : inputs)
+        if (input.size() != _inputSize)
+            return false;
+    for (const Vector<T> &target : targets)
+        if (target.size() != _targetSize)
+            return false;
+
+    return true;
+}
+
+template <typename T> T StaticGraph<T>::capture(const Batch<T> &inputs, const Batch<T> &targets) {
+    _tape.clear();
+    _inputSlots.clear();
+    _leafSlots.clear();
+
+    // Fresh copies make sure that every position in the batch gets its own slot on the tape.
+    auto copy = [](const Batch<T> &batch) {
+        Batch<T> copied;
+        copied.reserve(batch.size());
+        for (const Vector<T> &vector : batch) {
+            std::vector<T> values;
+            values.reserve(vector.size());
+            for (const ValuePtr<T> &val : vector)
+                values.push_back(val->getValue());
+            copied.push_back(Vector<T>::of(values));
+        }
+        return copied;
+    };
+
+    Batch<T> x = copy(inputs);
+    Batch<T> y = copy(targets);
+
+    ValuePtr<T> output;
+    {
+        typename Tape<T>::Scope scope(_tape);
+        struct Capturing {
+            bool previous = std::exchange(_capturing, true);
+            ~Capturing() { _capturing = previous; }
+        } capturing;
+
+        for (const Batch<T> *batch : {&x, &y})
+            for (const Vector<T> &vector : *batch)
+                for (const ValuePtr<T> &val : vector)
+                    _inputSlots.push_back(_tape.slot(val));
+
+        output = _step(x, y);
+    }
+
+    if (output->_tapeId != _tape._id) {
+        throw std::invalid_argument("The captured step has to return a Value computed from its inputs.");
+    }
+    _outputSlot = output->_tapeSlot;
+
+    std::vector<bool> isLeaf(_tape._nodes.size(), true);
+    for (uint32_t slot : _inputSlots)
+        isLeaf[slot] = false;
+    for (uint32_t slot = 0; slot < isLeaf.size(); ++slot)
+        if (isLeaf[slot] && _tape._producers[slot] == Tape<T>::noProducer && !_tape._nodes[slot]->_constant)
+            _leafSlots.push_back(slot);
+
+    _inputCount = inputs.size();
+    _targetCount = targets.size();
+    _inputSize = inputs.empty() ? 0 : inputs[0].size();
+    _targetSize = targets.empty() ? 0 : targets[0].size();
+    _captured = matches(inputs, targets);
+
+    return output->getValue();
+}
+
+template <typename T> T StaticGraph<T>::replay(const Batch<T> &inputs, const Batch<T> &targets) {
+    size_t index = 0;
+    for (const Batch<T> *batch : {&inputs, &targets})
+        for (const Vector<T> &vector : *batch)
+            for (const ValuePtr<T> &val : vector)
+                _tape._values[_inputSlots[index++]] = val->getValue();
+
+    for (uint32_t slot : _leafSlots)
+        _tape._values[slot] = _tape._nodes[slot]->_data;
+
+    _tape.evaluate();
+
+    // The sweeps of the capture run again in their order, with the gradients that the slots had in between them.
+    std::fill(_tape._gradients.begin(), _tape._gradients.end(), 0);
+    for (uint32_t slot : _leafSlots)
+        _tape._gradients[slot] = _tape._nodes[slot]->_gradient;
+
+    for (const typename Tape<T>::Sweep &sweep : _tape._sweeps) {
+        _tape._gradients[sweep.root] = LossScale::current();
+        _tape.propagate(sweep);
+    }
+
+    for (uint32_t slot : _leafSlots)
+        _tape._nodes[slot]->_gradient = _tape._gradients[slot];
+
+    return _tape._values[_outputSlot];
+}
+
+} // namespace shkyera
@@ -0,0 +1,586 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Gemm.hpp"
+#include "LossScale.hpp"
+#include "Operation.hpp"
+#include "Profiler.hpp"
+#include "Type.hpp"
+
+namespace shkyera {
+
+template <typename T> class Value;
+template <typename T> class StaticGraph;
+
+/**
+ * Alternative reverse-mode engine. While a tape is current on a thread (see Tape::Scope or Optimizer::attach), the
+ * operators on Values do not build the graph of children and closures. Instead, each operation is appended to the
+ * tape as a compact record, and Value::backward() becomes a single reverse sweep over the records, with no sorting.
+ *
+ * The graph engine runs its closures in the reverse order of creation too, so both engines add up the gradients in the
+ * same order and agree to the last bit, as long as the operations are recorded ones. A backward() sweeps the records
+ * from its root down to the root of the previous one and releases them, so the gradients flow through them only once.
+ * Records created before that previous root are therefore not reached by a later backward().
+ */
+template <typename T> class Tape {
+  public:
+    using Operation = shkyera::Operation;
+
+    class Scope {
+      private:
+        Tape<T> *_previous;
+
+      public:
+        Scope(Tape<T> &tape);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+  private:
+    using Accumulator = Type::Accumulator<T>;
+
+    // N-ary operations store their operands in _operands, starting at index left, with right of them in total. The
+    // hub of Value::linear keeps the index of its Linear in left instead.
+    struct Record {
+        Operation operation;
+        uint32_t result;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    // Operands {x, weights, biases} of Value::linear start at index operands of _operands. The outputs take the slots
+    // after firstOutput, one row after another, and are produced by the record of the hub.
+    struct Linear {
+        uint32_t operands;
+        uint32_t rows;
+        uint32_t inputs;
+        uint32_t outputs;
+        uint32_t firstOutput;
+    };
+
+    // One backward(), which propagates the records [begin, end) in reverse order.
+    struct Sweep {
+        uint32_t root;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct LinearBuffers {
+        std::vector<Accumulator> input;
+        std::vector<Accumulator> weight;
+        std::vector<Accumulator> transposed;
+        std::vector<Accumulator> product;
+        std::vector<Accumulator> gradient;
+        std::vector<Accumulator> inputGradient;
+        std::vector<Accumulator> weightGradient;
+    };
+
+    inline static const uint32_t noProducer = UINT32_MAX;
+
+    uint64_t _id;
+    std::vector<Record> _records;
+    std::vector<uint32_t> _operands;
+    std::vector<Linear> _linears;
+    std::vector<T> _values;
+    std::vector<Accumulator> _gradients;
+    std::vector<std::shared_ptr<Value<T>>> _nodes;
+    std::vector<uint32_t> _producers;
+    uint32_t _swept = 0;
+    std::vector<Sweep> _sweeps;
+    LinearBuffers _buffers;
+
+    inline static std::atomic<uint64_t> _nextId = 1;
+    inline static thread_local Tape<T> *_current = nullptr;
+
+    uint32_t slot(const std::shared_ptr<Value<T>> &value);
+    void produce(uint32_t resultSlot, const Record &record);
+
+    static bool isManyOperation(Operation operation);
+    template <typename F> void forEachSlot(const Sweep &sweep, F visit) const;
+
+    void gather(const Linear &linear);
+    void evaluate();
+    void evaluateMany(const Record &record);
+    void evaluateLinear(const Linear &linear);
+    void propagate(const Sweep &sweep);
+    void propagateMany(const Record &record, Accumulator gradient);
+    void propagateLinear(const Linear &linear);
+
+  public:
+    friend class StaticGraph<T>;
+
+    Tape();
+
+    Tape(const Tape &) = delete;
+    Tape &operator=(const Tape &) = delete;
+
+    void clear();
+    size_t size() const;
+
+    static bool record(Operation operation, const std::shared_ptr<Value<T>> &result,
+                       const std::shared_ptr<Value<T>> &left, const std::shared_ptr<Value<T>> &right = nullptr);
+    static bool record(Operation operation, const std::shared_ptr<Value<T>> &result,
+                       const std::vector<std::shared_ptr<Value<T>>> &operands);
+    static bool recordLinear(const std::shared_ptr<Value<T>> &hub, const std::vector<std::shared_ptr<Value<T>>> &x,
+                             const std::vector<std::shared_ptr<Value<T>>> &weights,
+                             const std::vector<std::shared_ptr<Value<T>>> &biases,
+                             const std::vector<std::shared_ptr<Value<T>>> &outputs);
+    static void backward(Value<T> *root);
+
+    static Tape<T> *current();
+    static Tape<T> *setCurrent(Tape<T> *tape);
+};
+
+template <typename T> Tape<T>::Scope::Scope(Tape<T> &tape) : _previous(Tape<T>::setCurrent(&tape)) {}
+
+template <typename T> Tape<T>::Scope::~Scope() { Tape<T>::setCurrent(_previous); }
+
+template <typename T> Tape<T>::Tape() : _id(_nextId++) {}
+
+template <typename T> Tape<T> *Tape<T>::current() { return _current; }
+
+template <typename T> Tape<T> *Tape<T>::setCurrent(Tape<T> *tape) {
+    Tape<T> *previous = _current;
+    _current = tape;
+    return previous;
+}
+
+template <typename T> void Tape<T>::clear() {
+    _id = _nextId++;
+    _records.clear();
+    _operands.clear();
+    _linears.clear();
+    _values.clear();
+    _gradients.clear();
+    _nodes.clear();
+    _producers.clear();
+    _swept = 0;
+    _sweeps.clear();
+}
+
+template <typename T> size_t Tape<T>::size() const { return _records.size(); }
+
+template <typename T> uint32_t Tape<T>::slot(const std::shared_ptr<Value<T>> &value) {
+    if (value->_tapeId != _id) {
+        value->_tapeId = _id;
+        value->_tapeSlot = static_cast<uint32_t>(_nodes.size());
+
+        _nodes.push_back(value);
+        _values.push_back(value->_data);
+        _gradients.push_back(0);
+        _producers.push_back(noProducer);
+    }
+    return value->_tapeSlot;
+}
+
+template <typename T> void Tape<T>::produce(uint32_t resultSlot, const Record &record) {
+    _producers[resultSlot] = static_cast<uint32_t>(_records.size());
+    _records.push_back(record);
+}
+
+template <typename T>
+bool Tape<T>::record(Operation operation, const std::shared_ptr<Value<T>> &result,
+                     const std::shared_ptr<Value<T>> &left, const std::shared_ptr<Value<T>> &right) {
+    Tape<T> *tape = _current;
+    if (tape == nullptr)
+        return false;
+
+    uint32_t leftSlot = tape->slot(left);
+    uint32_t rightSlot = right ? tape->slot(right) : leftSlot;
+    uint32_t resultSlot = tape->slot(result);
+
+    tape->produce(resultSlot, {operation, resultSlot, leftSlot, rightSlot});
+    return true;
+}
+
+template <typename T>
+bool Tape<T>::record(Operation operation, const std::shared_ptr<Value<T>> &result,
+                     const std::vector<std::shared_ptr<Value<T>>> &operands) {
+    Tape<T> *tape = _current;
+    if (tape == nullptr)
+        return false;
+
+    uint32_t offset = static_cast<uint32_t>(tape->_operands.size());
+    for (const std::shared_ptr<Value<T>> &operand : operands)
+        tape->_operands.push_back(tape->slot(operand));
+    uint32_t resultSlot = tape->slot(result);
+
+    tape->produce(resultSlot, {operation, resultSlot, offset, static_cast<uint32_t>(operands.size())});
+    return true;
+}
+
+// Records the hub of Value::linear, whose outputs are fresh Values computed from x, the weights and the biases.
+template <typename T>
+bool Tape<T>::recordLinear(const std::shared_ptr<Value<T>> &hub, const std::vector<std::shared_ptr<Value<T>>> &x,
+                           const std::vector<std::shared_ptr<Value<T>>> &weights,
+                           const std::vector<std::shared_ptr<Value<T>>> &biases,
+                           const std::vector<std::shared_ptr<Value<T>>> &outputs) {
+    Tape<T> *tape = _current;
+    if (tape == nullptr)
+        return false;
+
+    Linear linear;
+    linear.operands = static_cast<uint32_t>(tape->_operands.size());
+    linear.outputs = static_cast<uint32_t>(biases.size());
+    linear.inputs = biases.empty() ? 0 : static_cast<uint32_t>(weights.size() / biases.size());
+    linear.rows = linear.inputs == 0 ? 0 : static_cast<uint32_t>(x.size() / linear.inputs);
+    for (const std::vector<std::shared_ptr<Value<T>>> *operands : {&x, &weights, &biases})
+        for (const std::shared_ptr<Value<T>> &operand : *operands)
+            tape->_operands.push_back(tape->slot(operand));
+
+    uint32_t hubSlot = tape->slot(hub);
+    linear.firstOutput = static_cast<uint32_t>(tape->_nodes.size());
+    for (const std::shared_ptr<Value<T>> &output : outputs)
+        tape->_producers[tape->slot(output)] = static_cast<uint32_t>(tape->_records.size());
+
+    tape->produce(hubSlot, {Operation::MatMul, hubSlot, static_cast<uint32_t>(tape->_linears.size()), 0});
+    tape->_linears.push_back(linear);
+    return true;
+}
+
+// The slots of the swept records start from the gradients of their Values, except for the root, and the gradients are
+// written back to the Values afterwards, just like the graph engine accumulates them in the Values.
+template <typename T> void Tape<T>::backward(Value<T> *root) {
+    Profiler::Span span("Tape::backward", "Backward");
+    Tape<T> *tape = _current;
+    if (tape == nullptr || tape->_id != root->_tapeId) {
+        throw std::logic_error("Cannot compute the gradients of a Value recorded on a tape that is no longer active.");
+    }
+
+    const uint32_t rootSlot = root->_tapeSlot;
+    const uint32_t producer = tape->_producers[rootSlot];
+    if (producer == noProducer || producer < tape->_swept) {
+        if (!root->_constant)
+            root->_gradient = LossScale::current();
+        return;
+    }
+
+    const Sweep sweep = {rootSlot, tape->_swept, producer + 1};
+    tape->forEachSlot(sweep, [tape](uint32_t slot) { tape->_gradients[slot] = tape->_nodes[slot]->_gradient; });
+    tape->_gradients[rootSlot] = LossScale::current();
+    tape->propagate(sweep);
+
+    tape->forEachSlot(sweep, [tape](uint32_t slot) {
+        if (!tape->_nodes[slot]->_constant)
+            tape->_nodes[slot]->_gradient = tape->_gradients[slot];
+    });
+    tape->_swept = sweep.end;
+    tape->_sweeps.push_back(sweep);
+}
+
+template <typename T> bool Tape<T>::isManyOperation(Operation operation) {
+    return operation == Operation::Sum || operation == Operation::Dot || operation == Operation::Affine ||
+           operation == Operation::Max;
+}
+
+// Calls visit(slot) for the results and the operands of the records of a sweep, some of them more than once.
+template <typename T> template <typename F> void Tape<T>::forEachSlot(const Sweep &sweep, F visit) const {
+    for (uint32_t r = sweep.begin; r < sweep.end; ++r) {
+        const Record &record = _records[r];
+        visit(record.result);
+
+        if (record.operation == Operation::MatMul) {
+            const Linear &linear = _linears[record.left];
+            const uint32_t count = linear.rows * linear.inputs + linear.outputs * (linear.inputs + 1);
+            for (uint32_t i = 0; i < count; ++i)
+                visit(_operands[linear.operands + i]);
+            for (uint32_t k = 0; k < linear.rows * linear.outputs; ++k)
+                visit(linear.firstOutput + k);
+        } else if (isManyOperation(record.operation)) {
+            for (uint32_t i = 0; i < record.right; ++i)
+                visit(_operands[record.left + i]);
+        } else {
+            visit(record.left);
+            visit(record.right);
+        }
+    }
+}
+
+// Recomputes every recorded result from the current values of the leaves, in the order of recording.
+template <typename T> void Tape<T>::evaluate() {
+    for (const Record &record : _records) {
+        if (record.operation == Operation::MatMul) {
+            evaluateLinear(_linears[record.left]);
+            continue;
+        }
+        if (isManyOperation(record.operation)) {
+            evaluateMany(record);
+            continue;
+        }
+
+        const Accumulator left = _values[record.left];
+        const Accumulator right = _values[record.right];
+        T &result = _values[record.result];
+
+        switch (record.operation) {
+        case Operation::Add:
+            result = left + right;
+            break;
+        case Operation::Subtract:
+            result = left - right;
+            break;
+        case Operation::Multiply:
+        case Operation::Scale:
+            result = left * right;
+            break;
+        case Operation::Divide:
+            result = left / right;
+            break;
+        case Operation::Negate:
+            result = -left;
+            break;
+        case Operation::Square:
+            result = left * left;
+            break;
+        case Operation::Tanh:
+            result = (std::exp(2 * left) - 1) / (std::exp(2 * left) + 1);
+            break;
+        case Operation::Sigmoid:
+            result = 1 / (std::exp(-left) + 1);
+            break;
+        case Operation::ReLU:
+            result = left > 0 ? left : 0;
+            break;
+        case Operation::Exp:
+            result = std::exp(left);
+            break;
+        case Operation::Log:
+            result = std::log(left);
+            break;
+        case Operation::Pow:
+            result = std::pow(left, right);
+            break;
+        case Operation::Abs:
+            result = left < 0 ? -left : left;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+template <typename T> void Tape<T>::evaluateMany(const Record &record) {
+    const uint32_t *operands = _operands.data() + record.left;
+    T &result = _values[record.result];
+
+    Accumulator total = 0;
+    switch (record.operation) {
+    case Operation::Sum:
+        for (uint32_t i = 0; i < record.right; ++i)
+            total += _values[operands[i]];
+        result = total;
+        break;
+    case Operation::Dot:
+        for (uint32_t i = 0; i < record.right / 2; ++i)
+            total += _values[operands[i]] * _values[operands[record.right / 2 + i]];
+        result = total;
+        break;
+    case Operation::Affine:
+        for (uint32_t i = 0; i < record.right / 2; ++i)
+            total += _values[operands[i]] * _values[operands[record.right / 2 + i]];
+        result = _values[operands[record.right - 1]] + total;
+        break;
+    case Operation::Max:
+        result = _values[operands[0]];
+        for (uint32_t i = 1; i < record.right; ++i)
+            result = std::max(result, _values[operands[i]]);
+        break;
+    default:
+        break;
+    }
+}
+
+// Multiplies the inputs by the transposed weights like Value::linear does, so that the outputs match to the last bit.
+template <typename T> void Tape<T>::evaluateLinear(const Linear &linear) {
+    gather(linear);
+
+    const size_t rows = linear.rows, inputs = linear.inputs, outputs = linear.outputs;
+    const uint32_t *biases = _operands.data() + linear.operands + (rows + outputs) * inputs;
+    _buffers.product.resize(rows * outputs);
+    if (rows == 1) {
+        Gemm::multiplyVector(false, outputs, inputs, Accumulator(1), _buffers.weight.data(), inputs,
+                             _buffers.input.data(), Accumulator(0), _buffers.product.data());
+    } else {
+        _buffers.transposed.resize(outputs * inputs);
+        for (size_t o = 0; o < outputs; ++o)
+            for (size_t i = 0; i < inputs; ++i)
+                _buffers.transposed[i * outputs + o] = _buffers.weight[o * inputs + i];
+
+        Gemm::multiply(false, false, rows, outputs, inputs, Accumulator(1), _buffers.input.data(), inputs,
+                       _buffers.transposed.data(), outputs, Accumulator(0), _buffers.product.data(), outputs);
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t o = 0; o < outputs; ++o)
+            _values[linear.firstOutput + r * outputs + o] = _values[biases[o]] + _buffers.product[r * outputs + o];
+}
+
+// Copies the current values of x and of the weights of Value::linear into the buffers.
+template <typename T> void Tape<T>::gather(const Linear &linear) {
+    const uint32_t *x = _operands.data() + linear.operands;
+    const uint32_t *weights = x + linear.rows * linear.inputs;
+
+    _buffers.input.resize(linear.rows * linear.inputs);
+    for (size_t i = 0; i < _buffers.input.size(); ++i)
+        _buffers.input[i] = _values[x[i]];
+    _buffers.weight.resize(linear.outputs * linear.inputs);
+    for (size_t i = 0; i < _buffers.weight.size(); ++i)
+        _buffers.weight[i] = _values[weights[i]];
+}
+
+// Runs the records of a sweep in reverse order, each with the same arithmetic as the closure of its Value in the graph
+// engine. Only the gradients of the slots change, not those of the Values themselves.
+template <typename T> void Tape<T>::propagate(const Sweep &sweep) {
+    for (uint32_t r = sweep.end; r-- > sweep.begin;) {
+        const Record *record = &_records[r];
+        Accumulator gradient = _gradients[record->result];
+        if (record->operation == Operation::MatMul) {
+            propagateLinear(_linears[record->left]);
+            continue;
+        }
+        if (isManyOperation(record->operation)) {
+            propagateMany(*record, gradient);
+            continue;
+        }
+
+        const Accumulator left = _values[record->left];
+        const Accumulator right = _values[record->right];
+        const Accumulator result = _values[record->result];
+
+        switch (record->operation) {
+        case Operation::Add:
+            _gradients[record->left] += gradient;
+            _gradients[record->right] += gradient;
+            break;
+        case Operation::Subtract:
+            _gradients[record->left] += gradient;
+            _gradients[record->right] -= gradient;
+            break;
+        case Operation::Multiply:
+            _gradients[record->left] += right * gradient;
+            _gradients[record->right] += left * gradient;
+            break;
+        case Operation::Divide:
+            _gradients[record->left] += gradient / right;
+            _gradients[record->right] -= gradient * result / right;
+            break;
+        case Operation::Negate:
+            _gradients[record->left] -= gradient;
+            break;
+        case Operation::Square:
+            _gradients[record->left] += 2 * left * gradient;
+            break;
+        case Operation::Scale:
+            _gradients[record->left] += right * gradient;
+            break;
+        case Operation::Tanh:
+            _gradients[record->left] += (1 - (result * result)) * gradient;
+            break;
+        case Operation::Sigmoid:
+            _gradients[record->left] += result * (1 - result) * gradient;
+            break;
+        case Operation::ReLU:
+            _gradients[record->left] += (result > 0 ? 1 : 0) * gradient;
+            break;
+        case Operation::Exp:
+            _gradients[record->left] += result * gradient;
+            break;
+        case Operation::Log:
+            _gradients[record->left] += (1 / left) * gradient;
+            break;
+        case Operation::Pow:
+            _gradients[record->left] += (right * std::pow(left, right - 1)) * gradient;
+            _gradients[record->right] += (result * std::log(left)) * gradient;
+            break;
+        case Operation::Abs:
+            _gradients[record->left] += (left < 0 ? -1 : 1) * gradient;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+template <typename T> void Tape<T>::propagateMany(const Record &record, Accumulator gradient) {
+    const uint32_t *operands = _operands.data() + record.left;
+
+    if (record.operation == Operation::Sum) {
+        for (uint32_t i = 0; i < record.right; ++i)
+            _gradients[operands[i]] += gradient;
+        return;
+    }
+
+    if (record.operation == Operation::Max) {
+        for (uint32_t i = 0; i < record.right; ++i) {
+            if (_values[operands[i]] == _values[record.result]) {
+                _gradients[operands[i]] += gradient;
+                return;
+            }
+        }
+        return;
+    }
+
+    uint32_t n = record.right / 2;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t left = operands[i];
+        uint32_t right = operands[n + i];
+        _gradients[left] += _values[right] * gradient;
+        _gradients[right] += _values[left] * gradient;
+    }
+
+    if (record.operation == Operation::Affine)
+        _gradients[operands[record.right - 1]] += gradient;
+}
+
+// The outputs of Value::linear have nothing to do on their own, their gradients are read by the hub, which computes
+// dX = dY * W, dW = dY^T * X and the column sums of dY.
+template <typename T> void Tape<T>::propagateLinear(const Linear &linear) {
+    gather(linear);
+
+    const size_t rows = linear.rows, inputs = linear.inputs, outputs = linear.outputs;
+    const uint32_t *x = _operands.data() + linear.operands;
+    const uint32_t *weights = x + rows * inputs;
+    const uint32_t *biases = weights + outputs * inputs;
+
+    _buffers.gradient.resize(rows * outputs);
+    for (size_t k = 0; k < _buffers.gradient.size(); ++k)
+        _buffers.gradient[k] = _gradients[linear.firstOutput + k];
+    const Accumulator *dY = _buffers.gradient.data();
+
+    _buffers.inputGradient.resize(rows * inputs);
+    Gemm::multiply(false, false, rows, inputs, outputs, Accumulator(1), dY, outputs, _buffers.weight.data(), inputs,
+                   Accumulator(0), _buffers.inputGradient.data(), inputs);
+    for (size_t i = 0; i < _buffers.inputGradient.size(); ++i)
+        _gradients[x[i]] += _buffers.inputGradient[i];
+
+    _buffers.weightGradient.resize(outputs * inputs);
+    Gemm::multiply(true, false, outputs, inputs, rows, Accumulator(1), dY, outputs, _buffers.input.data(), inputs,
+                   Accumulator(0), _buffers.weightGradient.data(), inputs);
+    for (size_t i = 0; i < _buffers.weightGradient.size(); ++i)
+        _gradients[weights[i]] += _buffers.weightGradient[i];
+
+    for (size_t o = 0; o < outputs; ++o) {
+        Accumulator bias = 0;
+        for (size_t r = 0; r < rows; ++r)
+            bias += dY[r * outputs + o];
+        _gradients[biases[o]] += bias;
+    }
+}
+
+} // namespace shkyera
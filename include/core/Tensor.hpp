@@ -0,0 +1,949 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stack>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Gemm.hpp"
+#include "ImageShape.hpp"
+#include "Kernels.hpp"
+#include "LossScale.hpp"
+#include "Profiler.hpp"
+#include "Type.hpp"
+#include "Utils.hpp"
+#include "Value.hpp"
+#include "Vector.hpp"
+
+namespace shkyera {
+
+template <typename T> class Tensor;
+template <typename T> using TensorPtr = std::shared_ptr<Tensor<T>>;
+
+using Tensor32 = Tensor<Type::float32>;
+using Tensor64 = Tensor<Type::float64>;
+
+/**
+ * A contiguous, row-major block of scalars that takes part in the computational graph as a single node.
+ * Every operation on tensors creates exactly one new node, no matter how many elements it touches. Gradients are kept
+ * in the accumulator type, float32 for the 16-bit types, like those of Values.
+ */
+template <typename T> class Tensor : public std::enable_shared_from_this<Tensor<T>> {
+  private:
+    using Gradient = Type::Accumulator<T>;
+
+    std::vector<size_t> _shape;
+    std::vector<size_t> _strides;
+    utils::AlignedVector<T> _data;
+    utils::AlignedVector<Gradient> _gradient;
+    std::vector<TensorPtr<T>> _children = {};
+    std::function<void()> _backward = []() {};
+
+    Tensor(const std::vector<size_t> &shape, T fill);
+
+    Gradient *gradient();
+    size_t rows() const;
+    std::vector<TensorPtr<T>> topologicalSort();
+
+    static const Gradient *widen(const T *data, size_t size, utils::AlignedVector<Gradient> &buffer);
+
+    template <typename Forward, typename Derivative> TensorPtr<T> map(Forward forward, Derivative derivative);
+    TensorPtr<T> activate(Kernels::Activation activation);
+
+  public:
+    friend class Optimizer<T>;
+
+    static TensorPtr<T> create(const std::vector<size_t> &shape, T fill = 0);
+    static TensorPtr<T> of(const std::vector<size_t> &shape, const std::vector<T> &values);
+    static TensorPtr<T> of(const Vector<T> &vector);
+    static TensorPtr<T> of(const Batch<T> &batch);
+    static TensorPtr<T> fromValues(const std::vector<ValuePtr<T>> &values, const std::vector<size_t> &shape);
+
+    static TensorPtr<T> affine(const TensorPtr<T> &x, const TensorPtr<T> &weights, const TensorPtr<T> &bias);
+    static TensorPtr<T> conv2d(const TensorPtr<T> &x, const ImageShape &shape, const TensorPtr<T> &weights,
+                               const TensorPtr<T> &bias, size_t stride = 1, size_t padding = 0);
+    static TensorPtr<T> normalize(const TensorPtr<T> &x, const TensorPtr<T> &gamma, const TensorPtr<T> &beta,
+                                  Normalization::Axis axis, T epsilon, Normalization::Statistics<T> &statistics);
+
+    void backward();
+
+    const std::vector<size_t> &shape() const;
+    const std::vector<size_t> &strides() const;
+    size_t size() const;
+    const T *data() const;
+
+    T getValue(size_t index = 0) const;
+    Type::Accumulator<T> getGradient(size_t index = 0) const;
+    T at(const std::vector<size_t> &index) const;
+    std::vector<size_t> argMax() const;
+
+    Vector<T> toVector() const;
+    Batch<T> toBatch() const;
+
+    TensorPtr<T> tanh();
+    TensorPtr<T> relu();
+    TensorPtr<T> sigmoid();
+    TensorPtr<T> exp();
+    TensorPtr<T> log();
+    TensorPtr<T> abs();
+    TensorPtr<T> pow(T exponent);
+    TensorPtr<T> clamp(T low, T high);
+    TensorPtr<T> softmax();
+    TensorPtr<T> softmaxCrossEntropy(const TensorPtr<T> &targets);
+    TensorPtr<T> sum();
+    TensorPtr<T> mean();
+    TensorPtr<T> matmul(const TensorPtr<T> &other);
+    TensorPtr<T> maxPool2d(const ImageShape &shape, size_t size, size_t stride, size_t padding = 0);
+    TensorPtr<T> avgPool2d(const ImageShape &shape, size_t size, size_t stride, size_t padding = 0);
+
+    template <typename U> friend TensorPtr<U> operator+(TensorPtr<U> a, TensorPtr<U> b);
+    template <typename U> friend TensorPtr<U> operator-(TensorPtr<U> a, TensorPtr<U> b);
+    template <typename U> friend TensorPtr<U> operator*(TensorPtr<U> a, TensorPtr<U> b);
+    template <typename U> friend TensorPtr<U> operator*(TensorPtr<U> a, U scalar);
+    template <typename U> friend TensorPtr<U> operator/(TensorPtr<U> a, U scalar);
+    template <typename U> friend TensorPtr<U> operator-(TensorPtr<U> a);
+
+    template <typename U> friend std::ostream &operator<<(std::ostream &os, const TensorPtr<U> &tensor);
+};
+
+namespace detail {
+
+inline std::string shapeToString(const std::vector<size_t> &shape) {
+    std::string out = "(";
+    for (size_t i = 0; i < shape.size(); ++i)
+        out += (i > 0 ? ", " : "") + std::to_string(shape[i]);
+    return out + ")";
+}
+
+// Rows of a tensor hold one image each, so the last dimension has to match the shape of the image.
+inline void checkImage(const std::vector<size_t> &shape, const ImageShape &image) {
+    if (shape.empty() || shape.back() != image.size()) {
+        throw std::invalid_argument("Tensor of shape " + shapeToString(shape) + " does not hold images of shape " +
+                                    image.toString() + ".");
+    }
+}
+
+// Range of rows or columns of the image covered by a window starting at the given coordinate of the padded image.
+inline std::pair<size_t, size_t> windowRange(size_t start, size_t size, size_t padding, size_t length) {
+    return {std::max(start, padding) - padding, std::min(start + size, length + padding) - padding};
+}
+
+} // namespace detail
+
+template <typename T> Tensor<T>::Tensor(const std::vector<size_t> &shape, T fill) : _shape(shape) {
+    _strides.resize(_shape.size());
+    size_t stride = 1;
+    for (size_t i = _shape.size(); i-- > 0;) {
+        _strides[i] = stride;
+        stride *= _shape[i];
+    }
+    _data.assign(stride, fill);
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::create(const std::vector<size_t> &shape, T fill) {
+    return std::shared_ptr<Tensor<T>>(new Tensor<T>(shape, fill));
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::of(const std::vector<size_t> &shape, const std::vector<T> &values) {
+    TensorPtr<T> result = Tensor<T>::create(shape);
+    if (result->size() != values.size()) {
+        throw std::invalid_argument("Tensor of shape " + detail::shapeToString(shape) + " needs " +
+                                    std::to_string(result->size()) + " values, but " +
+                                    std::to_string(values.size()) + " were given.");
+    }
+    std::copy(values.begin(), values.end(), result->_data.begin());
+    return result;
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::of(const Vector<T> &vector) {
+    std::vector<ValuePtr<T>> values;
+    values.reserve(vector.size());
+    for (const ValuePtr<T> &val : vector)
+        values.push_back(val);
+
+    return fromValues(values, {vector.size()});
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::of(const Batch<T> &batch) {
+    size_t width = batch.empty() ? 0 : batch[0].size();
+
+    std::vector<ValuePtr<T>> values;
+    values.reserve(batch.size() * width);
+    for (const Vector<T> &sample : batch) {
+        if (sample.size() != width) {
+            throw std::invalid_argument("All vectors in a batch need to be of the same size to form a Tensor. Sizes "
+                                        "are " +
+                                        std::to_string(width) + " and " + std::to_string(sample.size()) + ".");
+        }
+        for (const ValuePtr<T> &val : sample)
+            values.push_back(val);
+    }
+
+    return fromValues(values, {batch.size(), width});
+}
+
+// The gradient of the returned tensor is passed on to the given values, which lets tensors reuse scalar parameters.
+template <typename T>
+TensorPtr<T> Tensor<T>::fromValues(const std::vector<ValuePtr<T>> &values, const std::vector<size_t> &shape) {
+    TensorPtr<T> result = Tensor<T>::create(shape);
+    if (result->size() != values.size()) {
+        throw std::invalid_argument("Tensor of shape " + detail::shapeToString(shape) + " needs " +
+                                    std::to_string(result->size()) + " values, but " +
+                                    std::to_string(values.size()) + " were given.");
+    }
+
+    for (size_t i = 0; i < values.size(); ++i)
+        result->_data[i] = values[i]->_data;
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *out = result.get();
+    result->_backward = [values, out]() {
+        const Gradient *outGradient = out->gradient();
+        for (size_t i = 0; i < values.size(); ++i)
+            if (!values[i]->_constant)
+                values[i]->_gradient += outGradient[i];
+    };
+
+    return result;
+}
+
+template <typename T> Type::Accumulator<T> *Tensor<T>::gradient() {
+    if (_gradient.size() != _data.size())
+        _gradient.assign(_data.size(), 0);
+    return _gradient.data();
+}
+
+// The data in the type of the gradients, which copies it into the buffer only for the 16-bit types.
+template <typename T>
+const Type::Accumulator<T> *Tensor<T>::widen(const T *data, size_t size, utils::AlignedVector<Gradient> &buffer) {
+    if constexpr (Type::isReduced<T>) {
+        buffer.assign(data, data + size);
+        return buffer.data();
+    } else {
+        return data;
+    }
+}
+
+template <typename T> size_t Tensor<T>::rows() const {
+    if (_shape.empty() || _shape.back() == 0)
+        return 1;
+    return size() / _shape.back();
+}
+
+template <typename T> const std::vector<size_t> &Tensor<T>::shape() const { return _shape; }
+template <typename T> const std::vector<size_t> &Tensor<T>::strides() const { return _strides; }
+template <typename T> size_t Tensor<T>::size() const { return _data.size(); }
+template <typename T> const T *Tensor<T>::data() const { return _data.data(); }
+
+template <typename T> T Tensor<T>::getValue(size_t index) const { return _data[index]; }
+
+template <typename T> Type::Accumulator<T> Tensor<T>::getGradient(size_t index) const {
+    return _gradient.empty() ? Gradient(0) : _gradient[index];
+}
+
+template <typename T> T Tensor<T>::at(const std::vector<size_t> &index) const {
+    if (index.size() != _shape.size()) {
+        throw std::invalid_argument("Tensor of shape " + detail::shapeToString(_shape) + " cannot be indexed with " +
+                                    std::to_string(index.size()) + " indices.");
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < index.size(); ++i) {
+        if (index[i] >= _shape[i]) {
+            throw std::out_of_range("Index " + detail::shapeToString(index) + " is out of range for a Tensor of shape " +
+                                    detail::shapeToString(_shape) + ".");
+        }
+        offset += index[i] * _strides[i];
+    }
+    return _data[offset];
+}
+
+template <typename T> std::vector<size_t> Tensor<T>::argMax() const {
+    size_t width = _shape.empty() ? 1 : _shape.back();
+
+    std::vector<size_t> indices(rows(), 0);
+    for (size_t r = 0; r < indices.size(); ++r) {
+        const T *row = _data.data() + r * width;
+        indices[r] = Kernels::argMax(row, width);
+    }
+    return indices;
+}
+
+template <typename T> Vector<T> Tensor<T>::toVector() const { return Vector<T>::of(std::vector<T>(_data.begin(), _data.end())); }
+
+template <typename T> Batch<T> Tensor<T>::toBatch() const {
+    size_t width = _shape.empty() ? 1 : _shape.back();
+
+    Batch<T> batch;
+    batch.reserve(rows());
+    for (size_t r = 0; r < rows(); ++r)
+        batch.push_back(Vector<T>::of(std::vector<T>(_data.begin() + r * width, _data.begin() + (r + 1) * width)));
+    return batch;
+}
+
+template <typename T>
+template <typename Forward, typename Derivative>
+TensorPtr<T> Tensor<T>::map(Forward forward, Derivative derivative) {
+    auto thisTensor = this->shared_from_this();
+
+    TensorPtr<T> result = Tensor<T>::create(_shape);
+    for (size_t i = 0; i < _data.size(); ++i)
+        result->_data[i] = forward(_data[i]);
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = thisTensor.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor};
+    result->_backward = [in, out, derivative]() {
+        Gradient *inGradient = in->gradient();
+        const Gradient *outGradient = out->gradient();
+        for (size_t i = 0; i < out->_data.size(); ++i)
+            inGradient[i] += derivative(in->_data[i], out->_data[i]) * outGradient[i];
+    };
+
+    return result;
+}
+
+// Like map(), for the activations the kernels vectorize. Their derivatives only need the output.
+template <typename T> TensorPtr<T> Tensor<T>::activate(Kernels::Activation activation) {
+    auto thisTensor = this->shared_from_this();
+
+    TensorPtr<T> result = Tensor<T>::create(_shape);
+    Kernels::activate(activation, _data.data(), result->_data.data(), _data.size());
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = thisTensor.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor};
+    result->_backward = [in, out, activation]() {
+        utils::AlignedVector<Gradient> buffer;
+        const Gradient *y = widen(out->_data.data(), out->size(), buffer);
+        Kernels::derivative(activation, y, out->gradient(), in->gradient(), out->size());
+    };
+
+    return result;
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::tanh() { return activate(Kernels::Activation::Tanh); }
+
+template <typename T> TensorPtr<T> Tensor<T>::sigmoid() { return activate(Kernels::Activation::Sigmoid); }
+
+template <typename T> TensorPtr<T> Tensor<T>::relu() { return activate(Kernels::Activation::ReLU); }
+
+template <typename T> TensorPtr<T> Tensor<T>::exp() { return activate(Kernels::Activation::Exp); }
+
+template <typename T> TensorPtr<T> Tensor<T>::log() {
+    return map([](T x) { return std::log(x); }, [](T x, T) { return 1 / x; });
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::abs() {
+    return map([](T x) { return x < 0 ? T(-x) : x; }, [](T x, T) { return x < 0 ? -1 : 1; });
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::pow(T exponent) {
+    return map([exponent](T x) { return std::pow(x, exponent); },
+               [exponent](T x, T) { return exponent * std::pow(x, exponent - 1); });
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::clamp(T low, T high) {
+    return map([low, high](T x) { return std::min(std::max(x, low), high); },
+               [low, high](T x, T) { return x >= low && x <= high ? 1 : 0; });
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::softmax() {
+    auto thisTensor = this->shared_from_this();
+
+    size_t width = _shape.empty() ? 1 : _shape.back();
+    TensorPtr<T> result = Tensor<T>::create(_shape);
+    for (size_t r = 0; r < rows(); ++r) {
+        const T *in = _data.data() + r * width;
+        T *out = result->_data.data() + r * width;
+
+        T maxValue = in[Kernels::argMax(in, width)];
+        for (size_t i = 0; i < width; ++i)
+            out[i] = in[i] - maxValue;
+        Kernels::activate(Kernels::Activation::Exp, out, out, width);
+
+        Type::Accumulator<T> sumExponentiated = Kernels::sum(out, width);
+        for (size_t i = 0; i < width; ++i)
+            out[i] /= sumExponentiated;
+    }
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = thisTensor.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor};
+    result->_backward = [in, out, width]() {
+        utils::AlignedVector<Gradient> buffer;
+        const Gradient *outData = widen(out->_data.data(), out->size(), buffer);
+        Gradient *inGradient = in->gradient();
+        const Gradient *outGradient = out->gradient();
+        for (size_t r = 0; r < out->rows(); ++r) {
+            const Gradient *y = outData + r * width;
+            const Gradient *dy = outGradient + r * width;
+
+            Gradient weighted = Kernels::dot(y, dy, width);
+            for (size_t i = 0; i < width; ++i)
+                inGradient[r * width + i] += y[i] * (dy[i] - weighted);
+        }
+    };
+
+    return result;
+}
+
+// Mean over the rows of the cross entropy between softmax(logits) and the targets, computed with a shifted
+// log-sum-exp as a single node (see Value::softmaxCrossEntropy).
+template <typename T> TensorPtr<T> Tensor<T>::softmaxCrossEntropy(const TensorPtr<T> &targets) {
+    if (_shape != targets->_shape || _data.empty()) {
+        throw std::invalid_argument("Logits and targets need to be of the same, non-empty shape to compute the Cross "
+                                    "Entropy loss. Shapes are " +
+                                    detail::shapeToString(_shape) + " and " + detail::shapeToString(targets->_shape) +
+                                    ".");
+    }
+
+    auto thisTensor = this->shared_from_this();
+    const size_t width = _shape.back();
+    const size_t samples = rows();
+
+    std::vector<T> probabilities(_data.size()), logSumExp(samples), targetSums(samples);
+    Type::Accumulator<T> loss = 0;
+    for (size_t r = 0; r < samples; ++r) {
+        const T *in = _data.data() + r * width;
+        const T *target = targets->_data.data() + r * width;
+        T *p = probabilities.data() + r * width;
+
+        T maxValue = in[Kernels::argMax(in, width)];
+        for (size_t i = 0; i < width; ++i)
+            p[i] = in[i] - maxValue;
+        Kernels::activate(Kernels::Activation::Exp, p, p, width);
+
+        Type::Accumulator<T> sumExponentiated = Kernels::sum(p, width);
+        for (size_t i = 0; i < width; ++i)
+            p[i] /= sumExponentiated;
+
+        logSumExp[r] = maxValue + static_cast<T>(std::log(sumExponentiated));
+        targetSums[r] = static_cast<T>(Kernels::sum(target, width));
+        loss += logSumExp[r] * targetSums[r] - Kernels::dot(target, in, width);
+    }
+
+    TensorPtr<T> result = Tensor<T>::create({1});
+    result->_data[0] = static_cast<T>(loss / samples);
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = thisTensor.get();
+    Tensor<T> *t = targets.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor, targets};
+    result->_backward = [in, t, out, width, samples, probabilities = std::move(probabilities),
+                         logSumExp = std::move(logSumExp), targetSums = std::move(targetSums)]() {
+        Gradient *inGradient = in->gradient();
+        Gradient *targetGradient = t->gradient();
+        const Gradient scale = out->gradient()[0] / static_cast<Gradient>(samples);
+        for (size_t r = 0; r < samples; ++r)
+            for (size_t i = r * width; i < (r + 1) * width; ++i) {
+                inGradient[i] += scale * (probabilities[i] * targetSums[r] - t->_data[i]);
+                targetGradient[i] += scale * (logSumExp[r] - in->_data[i]);
+            }
+    };
+
+    return result;
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::sum() {
+    auto thisTensor = this->shared_from_this();
+
+    TensorPtr<T> result = Tensor<T>::create({1});
+    result->_data[0] = Kernels::sum(_data.data(), _data.size());
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = thisTensor.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor};
+    result->_backward = [in, out]() {
+        Gradient *inGradient = in->gradient();
+        Gradient outGradient = out->gradient()[0];
+        for (size_t i = 0; i < in->_data.size(); ++i)
+            inGradient[i] += outGradient;
+    };
+
+    return result;
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::mean() {
+    T scale = _data.empty() ? 0 : static_cast<T>(1) / static_cast<T>(_data.size());
+    return sum() * scale;
+}
+
+template <typename T> TensorPtr<T> Tensor<T>::matmul(const TensorPtr<T> &other) {
+    if (_shape.size() != 2 || other->_shape.size() != 2 || _shape[1] != other->_shape[0]) {
+        throw std::invalid_argument("Tensors of shapes " + detail::shapeToString(_shape) + " and " +
+                                    detail::shapeToString(other->_shape) + " cannot be multiplied.");
+    }
+
+    auto thisTensor = this->shared_from_this();
+    size_t m = _shape[0], k = _shape[1], n = other->_shape[1];
+
+    TensorPtr<T> result = Tensor<T>::create({m, n});
+    Gemm::multiply(false, false, m, n, k, T(1), _data.data(), k, other->_data.data(), n, T(0), result->_data.data(), n);
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *a = thisTensor.get();
+    Tensor<T> *b = other.get();
+    Tensor<T> *out = result.get();
+    result->_children = {thisTensor, other};
+    result->_backward = [a, b, out, m, k, n]() {
+        utils::AlignedVector<Gradient> aBuffer, bBuffer;
+        const Gradient *aData = widen(a->_data.data(), a->size(), aBuffer);
+        const Gradient *bData = widen(b->_data.data(), b->size(), bBuffer);
+        const Gradient *outGradient = out->gradient();
+        Gemm::multiply(false, true, m, k, n, Gradient(1), outGradient, n, bData, n, Gradient(1), a->gradient(), k);
+        Gemm::multiply(true, false, k, n, m, Gradient(1), aData, k, outGradient, n, Gradient(1), b->gradient(), n);
+    };
+
+    return result;
+}
+
+template <typename T>
+TensorPtr<T> Tensor<T>::affine(const TensorPtr<T> &x, const TensorPtr<T> &weights, const TensorPtr<T> &bias) {
+    size_t input = x->_shape.empty() ? 1 : x->_shape.back();
+    if (weights->_shape.size() != 2 || weights->_shape[1] != input || bias->size() != weights->_shape[0]) {
+        throw std::invalid_argument("Cannot apply weights of shape " + detail::shapeToString(weights->_shape) +
+                                    " and bias of shape " + detail::shapeToString(bias->_shape) +
+                                    " to a Tensor of shape " + detail::shapeToString(x->_shape) + ".");
+    }
+
+    size_t output = weights->_shape[0];
+    size_t rows = x->rows();
+
+    std::vector<size_t> shape = x->_shape.empty() ? std::vector<size_t>{1} : x->_shape;
+    shape.back() = output;
+
+    TensorPtr<T> result = Tensor<T>::create(shape);
+    for (size_t r = 0; r < rows; ++r)
+        std::copy(bias->_data.begin(), bias->_data.end(), result->_data.begin() + r * output);
+    Gemm::multiply(false, true, rows, output, input, T(1), x->_data.data(), input, weights->_data.data(), input, T(1),
+                   result->_data.data(), output);
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = x.get();
+    Tensor<T> *w = weights.get();
+    Tensor<T> *b = bias.get();
+    Tensor<T> *out = result.get();
+    result->_children = {x, weights, bias};
+    result->_backward = [in, w, b, out, rows, input, output]() {
+        utils::AlignedVector<Gradient> inBuffer, wBuffer;
+        const Gradient *inData = widen(in->_data.data(), in->size(), inBuffer);
+        const Gradient *wData = widen(w->_data.data(), w->size(), wBuffer);
+        Gradient *bGradient = b->gradient();
+        const Gradient *outGradient = out->gradient();
+        Gemm::multiply(false, false, rows, input, output, Gradient(1), outGradient, output, wData, input, Gradient(1),
+                       in->gradient(), input);
+        Gemm::multiply(true, false, output, input, rows, Gradient(1), outGradient, output, inData, input, Gradient(1),
+                       w->gradient(), input);
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t o = 0; o < output; ++o)
+                bGradient[o] += outGradient[r * output + o];
+    };
+
+    return result;
+}
+
+// Convolves every row of x, holding an image of the given shape, with the filters stored in weights of shape
+// (filters, channels, kernel, kernel). Each image is unfolded with im2col, so that the convolution becomes a product of
+// the filters with the columns. The backward pass unfolds the image again rather than keeping the columns around.
+template <typename T>
+TensorPtr<T> Tensor<T>::conv2d(const TensorPtr<T> &x, const ImageShape &shape, const TensorPtr<T> &weights,
+                               const TensorPtr<T> &bias, size_t stride, size_t padding) {
+    detail::checkImage(x->_shape, shape);
+    const std::vector<size_t> &w = weights->_shape;
+    if (w.size() != 4 || w[1] != shape.channels || w[2] != w[3] || bias->size() != w[0]) {
+        throw std::invalid_argument("Cannot convolve images of shape " + shape.toString() + " with weights of shape " +
+                                    detail::shapeToString(w) + " and bias of shape " +
+                                    detail::shapeToString(bias->_shape) + ".");
+    }
+
+    const size_t kernel = w[2];
+    const ImageShape outShape = shape.slide(w[0], kernel, stride, padding);
+    const size_t filters = outShape.channels;
+    const size_t positions = outShape.height * outShape.width;
+    const size_t depth = shape.channels * kernel * kernel;
+    const size_t rows = x->rows();
+
+    std::vector<size_t> resultShape = x->_shape;
+    resultShape.back() = outShape.size();
+    TensorPtr<T> result = Tensor<T>::create(resultShape);
+
+    utils::AlignedVector<T> columns(depth * positions);
+    for (size_t r = 0; r < rows; ++r) {
+        T *out = result->_data.data() + r * outShape.size();
+        shape.im2col(x->_data.data() + r * shape.size(), kernel, stride, padding, T(0), columns.data());
+        for (size_t f = 0; f < filters; ++f)
+            std::fill(out + f * positions, out + (f + 1) * positions, bias->_data[f]);
+        Gemm::multiply(false, false, filters, positions, depth, T(1), weights->_data.data(), depth, columns.data(),
+                       positions, T(1), out, positions);
+    }
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = x.get();
+    Tensor<T> *wt = weights.get();
+    Tensor<T> *b = bias.get();
+    Tensor<T> *out = result.get();
+    result->_children = {x, weights, bias};
+    result->_backward = [in, wt, b, out, shape, outShape, kernel, stride, padding, rows]() {
+        const size_t filters = outShape.channels;
+        const size_t positions = outShape.height * outShape.width;
+        const size_t depth = shape.channels * kernel * kernel;
+
+        utils::AlignedVector<Gradient> inBuffer, wBuffer;
+        const Gradient *inData = widen(in->_data.data(), in->size(), inBuffer);
+        const Gradient *wData = widen(wt->_data.data(), wt->size(), wBuffer);
+        Gradient *inGradient = in->gradient();
+        Gradient *wGradient = wt->gradient();
+        Gradient *bGradient = b->gradient();
+        utils::AlignedVector<Gradient> columns(depth * positions);
+        for (size_t r = 0; r < rows; ++r) {
+            const Gradient *outGradient = out->gradient() + r * outShape.size();
+
+            // dW += dY * columns^T and db += the sums of dY over the positions.
+            shape.im2col(inData + r * shape.size(), kernel, stride, padding, Gradient(0), columns.data());
+            Gemm::multiply(false, true, filters, depth, positions, Gradient(1), outGradient, positions, columns.data(),
+                           positions, Gradient(1), wGradient, depth);
+            for (size_t f = 0; f < filters; ++f)
+                bGradient[f] += Kernels::sum(outGradient + f * positions, positions);
+
+            // dX += col2im(W^T * dY).
+            Gemm::multiply(true, false, depth, positions, filters, Gradient(1), wData, depth, outGradient, positions,
+                           Gradient(0), columns.data(), positions);
+            shape.col2im(columns.data(), kernel, stride, padding, inGradient + r * shape.size());
+        }
+    };
+
+    return result;
+}
+
+// Normalizes the rows of x, holding one entry per entry of gamma, along the given axis (see Normalization). Measured
+// statistics are written to the given ones.
+template <typename T>
+TensorPtr<T> Tensor<T>::normalize(const TensorPtr<T> &x, const TensorPtr<T> &gamma, const TensorPtr<T> &beta,
+                                  Normalization::Axis axis, T epsilon, Normalization::Statistics<T> &statistics) {
+    const size_t features = gamma->size();
+    if (x->_shape.empty() || x->_shape.back() != features || beta->size() != features) {
+        throw std::invalid_argument("Cannot normalize a Tensor of shape " + detail::shapeToString(x->_shape) +
+                                    " with gamma of shape " + detail::shapeToString(gamma->_shape) +
+                                    " and beta of shape " + detail::shapeToString(beta->_shape) + ".");
+    }
+
+    const size_t rows = x->rows();
+    const size_t groups = Normalization::groups(axis, rows, features);
+    if (!statistics.measured && (statistics.mean.size() != groups || statistics.variance.size() != groups)) {
+        throw std::invalid_argument("Normalization needs " + std::to_string(groups) +
+                                    " means and variances. Sizes are " + std::to_string(statistics.mean.size()) +
+                                    " and " + std::to_string(statistics.variance.size()) + ".");
+    }
+    if (statistics.measured) {
+        statistics.mean.resize(groups);
+        statistics.variance.resize(groups);
+        Normalization::measure(axis, x->_data.data(), rows, features, statistics.mean.data(),
+                               statistics.variance.data());
+    }
+
+    TensorPtr<T> result = Tensor<T>::create(x->_shape);
+    std::vector<T> normalized(x->size()), inverseDeviation(groups);
+    Normalization::forward(axis, x->_data.data(), rows, features, statistics.mean.data(), statistics.variance.data(),
+                           epsilon, gamma->_data.data(), beta->_data.data(), normalized.data(),
+                           inverseDeviation.data(), result->_data.data());
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = x.get();
+    Tensor<T> *g = gamma.get();
+    Tensor<T> *b = beta.get();
+    Tensor<T> *out = result.get();
+    result->_children = {x, gamma, beta};
+    result->_backward = [in, g, b, out, axis, measured = statistics.measured, rows, features,
+                         normalized = std::move(normalized), inverseDeviation = std::move(inverseDeviation)]() {
+        utils::AlignedVector<Gradient> normalizedBuffer, deviationBuffer, gammaBuffer;
+        Normalization::backward(axis, measured, widen(normalized.data(), normalized.size(), normalizedBuffer),
+                                widen(inverseDeviation.data(), inverseDeviation.size(), deviationBuffer),
+                                widen(g->_data.data(), g->size(), gammaBuffer), out->gradient(), rows, features,
+                                in->gradient(), g->gradient(), b->gradient());
+    };
+
+    return result;
+}
+
+// Takes the largest pixel in every window of every channel. Padding is never picked, and the gradient flows only to the
+// first of the largest pixels.
+template <typename T>
+TensorPtr<T> Tensor<T>::maxPool2d(const ImageShape &shape, size_t size, size_t stride, size_t padding) {
+    detail::checkImage(_shape, shape);
+    if (padding >= size) {
+        throw std::invalid_argument("Padding of a pooling window must be smaller than the window. Sizes are " +
+                                    std::to_string(padding) + " and " + std::to_string(size) + ".");
+    }
+
+    const ImageShape outShape = shape.slide(shape.channels, size, stride, padding);
+    std::vector<size_t> resultShape = _shape;
+    resultShape.back() = outShape.size();
+    TensorPtr<T> result = Tensor<T>::create(resultShape);
+
+    std::vector<size_t> sources(result->size());
+    for (size_t r = 0; r < rows(); ++r)
+        for (size_t c = 0; c < shape.channels; ++c) {
+            const size_t plane = r * shape.size() + c * shape.height * shape.width;
+            for (size_t oy = 0; oy < outShape.height; ++oy) {
+                auto [yBegin, yEnd] = detail::windowRange(oy * stride, size, padding, shape.height);
+                for (size_t ox = 0; ox < outShape.width; ++ox) {
+                    auto [xBegin, xEnd] = detail::windowRange(ox * stride, size, padding, shape.width);
+                    size_t best = plane + yBegin * shape.width + xBegin;
+                    for (size_t y = yBegin; y < yEnd; ++y)
+                        for (size_t x = xBegin; x < xEnd; ++x)
+                            if (_data[plane + y * shape.width + x] > _data[best])
+                                best = plane + y * shape.width + x;
+
+                    const size_t index = r * outShape.size() + (c * outShape.height + oy) * outShape.width + ox;
+                    sources[index] = best;
+                    result->_data[index] = _data[best];
+                }
+            }
+        }
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = this;
+    Tensor<T> *out = result.get();
+    result->_children = {this->shared_from_this()};
+    result->_backward = [in, out, sources = std::move(sources)]() {
+        Gradient *inGradient = in->gradient();
+        const Gradient *outGradient = out->gradient();
+        for (size_t i = 0; i < sources.size(); ++i)
+            inGradient[sources[i]] += outGradient[i];
+    };
+
+    return result;
+}
+
+// Averages every window of every channel over the pixels of the image it covers, leaving out the padding.
+template <typename T>
+TensorPtr<T> Tensor<T>::avgPool2d(const ImageShape &shape, size_t size, size_t stride, size_t padding) {
+    detail::checkImage(_shape, shape);
+    if (padding >= size) {
+        throw std::invalid_argument("Padding of a pooling window must be smaller than the window. Sizes are " +
+                                    std::to_string(padding) + " and " + std::to_string(size) + ".");
+    }
+
+    const ImageShape outShape = shape.slide(shape.channels, size, stride, padding);
+    std::vector<size_t> resultShape = _shape;
+    resultShape.back() = outShape.size();
+    TensorPtr<T> result = Tensor<T>::create(resultShape);
+
+    const size_t planes = rows() * shape.channels;
+    for (size_t p = 0; p < planes; ++p) {
+        const T *plane = _data.data() + p * shape.height * shape.width;
+        T *outPlane = result->_data.data() + p * outShape.height * outShape.width;
+        for (size_t oy = 0; oy < outShape.height; ++oy) {
+            auto [yBegin, yEnd] = detail::windowRange(oy * stride, size, padding, shape.height);
+            for (size_t ox = 0; ox < outShape.width; ++ox) {
+                auto [xBegin, xEnd] = detail::windowRange(ox * stride, size, padding, shape.width);
+                Type::Accumulator<T> total = 0;
+                for (size_t y = yBegin; y < yEnd; ++y)
+                    total += Kernels::sum(plane + y * shape.width + xBegin, xEnd - xBegin);
+                outPlane[oy * outShape.width + ox] = static_cast<T>(total / ((yEnd - yBegin) * (xEnd - xBegin)));
+            }
+        }
+    }
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<T> *in = this;
+    Tensor<T> *out = result.get();
+    result->_children = {this->shared_from_this()};
+    result->_backward = [in, out, shape, outShape, size, stride, padding, planes]() {
+        Gradient *inGradient = in->gradient();
+        const Gradient *outGradient = out->gradient();
+        for (size_t p = 0; p < planes; ++p) {
+            Gradient *plane = inGradient + p * shape.height * shape.width;
+            const Gradient *outPlane = outGradient + p * outShape.height * outShape.width;
+            for (size_t oy = 0; oy < outShape.height; ++oy) {
+                auto [yBegin, yEnd] = detail::windowRange(oy * stride, size, padding, shape.height);
+                for (size_t ox = 0; ox < outShape.width; ++ox) {
+                    auto [xBegin, xEnd] = detail::windowRange(ox * stride, size, padding, shape.width);
+                    Gradient share =
+                        outPlane[oy * outShape.width + ox] / static_cast<Gradient>((yEnd - yBegin) * (xEnd - xBegin));
+                    for (size_t y = yBegin; y < yEnd; ++y)
+                        for (size_t x = xBegin; x < xEnd; ++x)
+                            plane[y * shape.width + x] += share;
+                }
+            }
+        }
+    };
+
+    return result;
+}
+
+template <typename U> TensorPtr<U> operator+(TensorPtr<U> a, TensorPtr<U> b) {
+    if (a->_shape != b->_shape) {
+        throw std::invalid_argument("Tensors need to be of the same shape to be added. Shapes are " +
+                                    detail::shapeToString(a->_shape) + " and " + detail::shapeToString(b->_shape) +
+                                    ".");
+    }
+
+    TensorPtr<U> result = Tensor<U>::create(a->_shape);
+    for (size_t i = 0; i < result->size(); ++i)
+        result->_data[i] = a->_data[i] + b->_data[i];
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<U> *left = a.get();
+    Tensor<U> *right = b.get();
+    Tensor<U> *out = result.get();
+    result->_children = {a, b};
+    result->_backward = [left, right, out]() {
+        Type::Accumulator<U> *leftGradient = left->gradient();
+        Type::Accumulator<U> *rightGradient = right->gradient();
+        const Type::Accumulator<U> *outGradient = out->gradient();
+        for (size_t i = 0; i < out->size(); ++i) {
+            leftGradient[i] += outGradient[i];
+            rightGradient[i] += outGradient[i];
+        }
+    };
+
+    return result;
+}
+
+template <typename U> TensorPtr<U> operator-(TensorPtr<U> a, TensorPtr<U> b) { return a + (-b); }
+
+template <typename U> TensorPtr<U> operator*(TensorPtr<U> a, TensorPtr<U> b) {
+    if (a->_shape != b->_shape) {
+        throw std::invalid_argument("Tensors need to be of the same shape to be multiplied element-wise. Shapes are " +
+                                    detail::shapeToString(a->_shape) + " and " + detail::shapeToString(b->_shape) +
+                                    ".");
+    }
+
+    TensorPtr<U> result = Tensor<U>::create(a->_shape);
+    for (size_t i = 0; i < result->size(); ++i)
+        result->_data[i] = a->_data[i] * b->_data[i];
+
+    if (NoGradGuard::isActive())
+        return result;
+
+    Tensor<U> *left = a.get();
+    Tensor<U> *right = b.get();
+    Tensor<U> *out = result.get();
+    result->_children = {a, b};
+    result->_backward = [left, right, out]() {
+        Type::Accumulator<U> *leftGradient = left->gradient();
+        Type::Accumulator<U> *rightGradient = right->gradient();
+        const Type::Accumulator<U> *outGradient = out->gradient();
+        for (size_t i = 0; i < out->size(); ++i) {
+            leftGradient[i] += right->_data[i] * outGradient[i];
+            rightGradient[i] += left->_data[i] * outGradient[i];
+        }
+    };
+
+    return result;
+}
+
+template <typename U> TensorPtr<U> operator*(TensorPtr<U> a, U scalar) {
+    return a->map([scalar](U x) { return x * scalar; }, [scalar](U, U) { return scalar; });
+}
+
+template <typename U> TensorPtr<U> operator/(TensorPtr<U> a, U scalar) { return a * (static_cast<U>(1) / scalar); }
+
+template <typename U> TensorPtr<U> operator-(TensorPtr<U> a) { return a * static_cast<U>(-1); }
+
+template <typename T> std::vector<TensorPtr<T>> Tensor<T>::topologicalSort() {
+    std::vector<TensorPtr<T>> sorted;
+    std::unordered_set<Tensor<T> *> visited;
+
+    std::stack<Tensor<T> *> stack;
+    stack.push(this);
+
+    while (!stack.empty()) {
+        auto cur = stack.top();
+        if (visited.find(cur) == visited.end()) {
+            bool hasUnvisitedChildren = false;
+            for (auto &t : cur->_children) {
+                if (visited.find(t.get()) == visited.end()) {
+                    stack.push(t.get());
+                    hasUnvisitedChildren = true;
+                }
+            }
+
+            if (!hasUnvisitedChildren) {
+                stack.pop();
+                sorted.push_back(cur->shared_from_this());
+                visited.insert(cur);
+            }
+        } else {
+            stack.pop();
+        }
+    }
+
+    return sorted;
+}
+
+template <typename T> void Tensor<T>::backward() {
+    Profiler::Span span("Tensor::backward", "Backward");
+    Gradient *seed = gradient();
+    std::fill(seed, seed + size(), static_cast<Gradient>(LossScale::current()));
+
+    std::vector<TensorPtr<T>> sorted = topologicalSort();
+
+    for (auto t = sorted.rbegin(); t != sorted.rend(); t++) {
+        (*t)->_backward();
+    }
+
+    for (auto s : sorted) {
+        s->_children = {};
+        s->_backward = []() {};
+    }
+}
+
+template <typename T> std::ostream &operator<<(std::ostream &os, const TensorPtr<T> &tensor) {
+    os << "Tensor(shape=" << detail::shapeToString(tensor->_shape) << ", data={";
+
+    for (const T &val : tensor->_data)
+        os << val << ' ';
+
+    os << "})";
+    return os;
+}
+
+} // namespace shkyera
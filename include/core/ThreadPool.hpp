@@ -0,0 +1,129 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shkyera {
+
+/**
+ * Fixed set of worker threads that sleep between jobs. ThreadPool::run() hands the same job to a number of workers,
+ * one of which is the calling thread, and returns once all of them are done. Only one job runs at a time.
+ */
+class ThreadPool {
+  public:
+    using Job = std::function<void(size_t worker)>;
+
+  private:
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::mutex _runMutex;
+    std::condition_variable _wakeUp;
+    std::condition_variable _finished;
+
+    const Job *_job = nullptr;
+    size_t _workers = 0;
+    size_t _generation = 0;
+    size_t _remaining = 0;
+    bool _stopping = false;
+
+    inline static thread_local bool _insideWorker = false;
+
+    void work(size_t index);
+
+  public:
+    ThreadPool(size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const;
+    void run(size_t workers, const Job &job);
+
+    static bool isInsideWorker();
+};
+
+inline ThreadPool::ThreadPool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i)
+        _threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+
+    for (std::thread &thread : _threads)
+        thread.join();
+}
+
+inline size_t ThreadPool::size() const { return _threads.size() + 1; }
+
+inline bool ThreadPool::isInsideWorker() { return _insideWorker; }
+
+inline void ThreadPool::work(size_t index) {
+    _insideWorker = true;
+    size_t seenGeneration = 0;
+
+    while (true) {
+        const Job *job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeUp.wait(lock, [&]() { return _stopping || (_generation != seenGeneration && index < _workers); });
+            if (_stopping)
+                return;
+
+            seenGeneration = _generation;
+            job = _job;
+        }
+
+        (*job)(index);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_remaining == 0)
+            _finished.notify_one();
+    }
+}
+
+inline void ThreadPool::run(size_t workers, const Job &job) {
+    workers = std::min(std::max<size_t>(workers, 1), size());
+    if (workers == 1 || _insideWorker) {
+        for (size_t worker = 0; worker < workers; ++worker)
+            job(worker);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(_runMutex);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &job;
+        _workers = workers;
+        _remaining = workers - 1;
+        _generation++;
+    }
+    _wakeUp.notify_all();
+
+    bool wasInsideWorker = _insideWorker;
+    _insideWorker = true;
+    job(0);
+    _insideWorker = wasInsideWorker;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished.wait(lock, [&]() { return _remaining == 0; });
+}
+
+} // namespace shkyera
@@ -7,11 +7,181 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
 namespace shkyera::Type {
 
+namespace detail {
+
+// IEEE 754 binary16: 5 exponent bits and 10 mantissa bits.
+struct HalfFormat {
+    static constexpr uint16_t maxBits = 0x7BFF;
+    static constexpr uint16_t minBits = 0x0400;
+    static constexpr uint16_t epsilonBits = 0x1400;
+    static constexpr uint16_t infinityBits = 0x7C00;
+    static constexpr uint16_t nanBits = 0x7E00;
+    static constexpr int digits = 11;
+
+    static uint16_t encode(float value);
+    static float decode(uint16_t bits);
+};
+
+// Upper half of an IEEE 754 binary32: the exponent range of float with 7 mantissa bits.
+struct BrainFormat {
+    static constexpr uint16_t maxBits = 0x7F7F;
+    static constexpr uint16_t minBits = 0x0080;
+    static constexpr uint16_t epsilonBits = 0x3C00;
+    static constexpr uint16_t infinityBits = 0x7F80;
+    static constexpr uint16_t nanBits = 0x7FC0;
+    static constexpr int digits = 8;
+
+    static uint16_t encode(float value);
+    static float decode(uint16_t bits);
+};
+
+/**
+ * Storage-only floating-point number of 16 bits. It converts implicitly to and from float, so every arithmetic
+ * operation is carried out in float32 and only the result is rounded (to nearest, ties to even) when it is stored.
+ */
+template <typename Format> class ReducedFloat {
+  private:
+    uint16_t _bits = 0;
+
+  public:
+    ReducedFloat() = default;
+    ReducedFloat(float value) : _bits(Format::encode(value)) {}
+
+    operator float() const { return Format::decode(_bits); }
+
+    static ReducedFloat fromBits(uint16_t bits);
+    uint16_t bits() const { return _bits; }
+
+    ReducedFloat &operator+=(float value) { return *this = static_cast<float>(*this) + value; }
+    ReducedFloat &operator-=(float value) { return *this = static_cast<float>(*this) - value; }
+    ReducedFloat &operator*=(float value) { return *this = static_cast<float>(*this) * value; }
+    ReducedFloat &operator/=(float value) { return *this = static_cast<float>(*this) / value; }
+};
+
+template <typename T> struct AccumulatorOf {
+    using type = T;
+};
+
+template <typename Format> struct AccumulatorOf<ReducedFloat<Format>> {
+    using type = float;
+};
+
+inline uint16_t HalfFormat::encode(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude >= 0x7F800000)
+        return sign | (magnitude > 0x7F800000 ? nanBits : infinityBits);
+    if (magnitude >= 0x477FF000) // At least 65520, which rounds past the largest half
+        return sign | infinityBits;
+
+    if (magnitude < 0x38800000) { // Below 2^-14, where halves become subnormal with a step of 2^-24
+        float subnormal;
+        std::memcpy(&subnormal, &magnitude, sizeof(subnormal));
+        subnormal += 0.5f; // Makes float round to a multiple of 2^-24 in its lowest mantissa bits
+
+        uint32_t rounded;
+        std::memcpy(&rounded, &subnormal, sizeof(rounded));
+        return sign | static_cast<uint16_t>(rounded - 0x3F000000);
+    }
+
+    uint32_t odd = (magnitude >> 13) & 1;
+    magnitude += 0xC8000FFF + odd; // Rebias the exponent from 127 to 15 and round the 13 dropped bits
+    return sign | static_cast<uint16_t>(magnitude >> 13);
+}
+
+inline float HalfFormat::decode(uint16_t bits) {
+    uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+    uint32_t exponent = (bits >> 10) & 0x1F;
+    uint32_t mantissa = bits & 0x3FF;
+
+    uint32_t result;
+    if (exponent == 0x1F) {
+        result = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        float subnormal = static_cast<float>(mantissa) * 5.9604644775390625e-8f; // mantissa * 2^-24
+        std::memcpy(&result, &subnormal, sizeof(result));
+        result |= sign;
+    } else {
+        result = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &result, sizeof(value));
+    return value;
+}
+
+inline uint16_t BrainFormat::encode(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    if ((bits & 0x7FFFFFFF) > 0x7F800000)
+        return static_cast<uint16_t>(bits >> 16) | 0x0040;
+
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float BrainFormat::decode(uint16_t bits) {
+    uint32_t result = static_cast<uint32_t>(bits) << 16;
+
+    float value;
+    std::memcpy(&value, &result, sizeof(value));
+    return value;
+}
+
+template <typename Format> ReducedFloat<Format> ReducedFloat<Format>::fromBits(uint16_t bits) {
+    ReducedFloat value;
+    value._bits = bits;
+    return value;
+}
+
+} // namespace detail
+
 using float32 = float;
 using float64 = double;
+using float16 = detail::ReducedFloat<detail::HalfFormat>;
+using bfloat16 = detail::ReducedFloat<detail::BrainFormat>;
 using f32 = float;
 using f64 = double;
+using f16 = float16;
+using bf16 = bfloat16;
+
+// Type in which sums of values of type T are accumulated: float32 for the 16-bit types, T itself otherwise.
+template <typename T> using Accumulator = typename detail::AccumulatorOf<T>::type;
+
+template <typename T> constexpr bool isReduced = !std::is_same_v<T, Accumulator<T>>;
 
 } // namespace shkyera::Type
+
+template <typename Format> class std::numeric_limits<shkyera::Type::detail::ReducedFloat<Format>> {
+  private:
+    using R = shkyera::Type::detail::ReducedFloat<Format>;
+
+  public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr int digits = Format::digits;
+    static constexpr int radix = 2;
+
+    static R min() { return R::fromBits(Format::minBits); }
+    static R max() { return R::fromBits(Format::maxBits); }
+    static R lowest() { return R::fromBits(Format::maxBits | 0x8000); }
+    static R epsilon() { return R::fromBits(Format::epsilonBits); }
+    static R infinity() { return R::fromBits(Format::infinityBits); }
+    static R quiet_NaN() { return R::fromBits(Format::nanBits); }
+};
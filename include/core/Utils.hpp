@@ -9,21 +9,25 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <new>
 #include <random>
 #include <vector>
 
+#include "Type.hpp"
+
 namespace shkyera::utils {
 
-std::random_device rand_dev;
-std::mt19937 generator(rand_dev());
+inline std::random_device rand_dev;
+inline std::mt19937 generator(rand_dev());
 
 template <typename T> std::enable_if_t<!std::is_integral_v<T>, T> sample(T from, T to) {
-    std::uniform_real_distribution<T> distribution(from, to);
+    std::uniform_real_distribution<Type::Accumulator<T>> distribution(from, to);
     return distribution(generator);
 }
 
 template <typename T> std::enable_if_t<!std::is_integral_v<T>, std::vector<T>> sample(T from, T to, size_t size) {
-    std::uniform_real_distribution<T> distribution(from, to);
+    std::uniform_real_distribution<Type::Accumulator<T>> distribution(from, to);
 
     std::vector<T> sampled(size);
     for (size_t i = 0; i < size; i++) {
@@ -64,4 +68,23 @@ double stopTimer(const typename Clock::time_point &start) {
     return static_cast<double>(duration.count()) / 1e6;
 }
 
+template <typename T, size_t Alignment = 64> struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U> struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+template <typename T> using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
 } // namespace shkyera::utils
@@ -7,16 +7,36 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <memory>
-#include <stack>
+#include <unordered_map>
+#include <stdexcept>
 #include <unordered_set>
 #include <vector>
 
+#include "ForwardModeGuard.hpp"
+#include "Gemm.hpp"
+#include "GraphArena.hpp"
+#include "Kernels.hpp"
+#include "LossScale.hpp"
+#include "ModuleScope.hpp"
+#include "NoGradGuard.hpp"
+#include "NodeStatistics.hpp"
+#include "Normalization.hpp"
+#include "Operation.hpp"
+#include "Profiler.hpp"
+#include "RecomputeGuard.hpp"
+#include "Tape.hpp"
+#include "ThreadPool.hpp"
 #include "Type.hpp"
 #include "Utils.hpp"
+#include "WeightCache.hpp"
 
 namespace shkyera {
 
@@ -25,6 +45,9 @@ template <typename T> class Adam;
 template <typename T> class AdaMax;
 template <typename T> class SGD;
 template <typename T> class NAG;
+template <typename T> class Tensor;
+template <typename T> class StaticGraph;
+template <typename T> class Graph;
 
 template <typename T> class Value;
 template <typename T> using ValuePtr = std::shared_ptr<Value<T>>;
@@ -32,18 +55,66 @@ template <typename T> using ValuePtr = std::shared_ptr<Value<T>>;
 using Val32 = Value<Type::float32>;
 using Val64 = Value<Type::float64>;
 
+// Allocator of the lists of children, which accounts for their memory in NodeStatistics.
+template <typename U> class ChildrenAllocator : public ArenaAllocator<U> {
+  public:
+    ChildrenAllocator(GraphArena *arena = GraphArena::current()) : ArenaAllocator<U>(arena) {}
+    template <typename V> ChildrenAllocator(const ChildrenAllocator<V> &other) : ArenaAllocator<U>(other) {}
+
+    U *allocate(size_t n) {
+        NodeStatistics::allocatedChildren(n * sizeof(U));
+        return ArenaAllocator<U>::allocate(n);
+    }
+
+    void deallocate(U *ptr, size_t n) {
+        NodeStatistics::releasedChildren(n * sizeof(U));
+        ArenaAllocator<U>::deallocate(ptr, n);
+    }
+};
+
+namespace expr {
+template <typename T, typename Derived> class Expression;
+template <typename T> class Leaf;
+template <typename T, typename E> ValuePtr<T> fuse(const Expression<T, E> &expression);
+} // namespace expr
+
 template <typename T> class Value : public std::enable_shared_from_this<Value<T>> {
+  public:
+    using Children = std::vector<ValuePtr<T>, ChildrenAllocator<ValuePtr<T>>>;
+
   private:
     T _data = 0;
-    T _gradient = 0;
-    std::vector<ValuePtr<T>> _children = {};
+    Type::Accumulator<T> _gradient = 0;
+    Type::Accumulator<T> _tangent = 0;
+    Children _children;
     std::function<void()> _backward = []() {};
 
-    Value(T data);
+    uint64_t _sequence;
+    uint64_t _tapeId = 0;
+    uint32_t _tapeSlot = 0;
+    uint32_t _position = 0;
+    bool _constant = false;
+    bool _recomputes = false;
+    bool _batched = false;
+    Operation _operation;
+    uint16_t _module;
+
+    inline static const size_t constantPoolSize = 1024;
+    inline static const size_t minParallelNodes = 1024;
+    inline static const size_t maxTrunkDepth = 8;
+
+    Value(T data, GraphArena *arena, Operation operation);
+
+    static ValuePtr<T> create(T data, Operation operation);
 
     std::vector<ValuePtr<T>> topologicalSort();
+    bool parallelBackward(const std::vector<ValuePtr<T>> &sorted);
+    static void runBackward(Value<T> *node, Profiler::OperationTimes *times);
 
+    inline static std::atomic<uint64_t> nextSequence = 0;
     inline static double topoSortTime = 0;
+    inline static std::shared_ptr<ThreadPool> backwardPool = nullptr;
+    inline static bool deterministicBackward = false;
 
   public:
     friend class Optimizer<T>;
@@ -51,20 +122,51 @@ template <typename T> class Value : public std::enable_shared_from_this<Value<T>
     friend class AdaMax<T>;
     friend class SGD<T>;
     friend class NAG<T>;
+    friend class Tensor<T>;
+    friend class Tape<T>;
+    friend class StaticGraph<T>;
+    friend class Graph<T>;
+    friend class expr::Leaf<T>;
+    template <typename U, typename E> friend ValuePtr<U> expr::fuse(const expr::Expression<U, E> &expression);
+
+    ~Value();
 
     static ValuePtr<T> create(T data);
+    static ValuePtr<T> constant(T data);
+
+    static ValuePtr<T> sum(const std::vector<ValuePtr<T>> &values);
+    static ValuePtr<T> max(const std::vector<ValuePtr<T>> &values);
+    static ValuePtr<T> dot(const std::vector<ValuePtr<T>> &a, const std::vector<ValuePtr<T>> &b);
+    static ValuePtr<T> affine(const std::vector<ValuePtr<T>> &weights, const std::vector<ValuePtr<T>> &x,
+                              ValuePtr<T> bias);
+    static ValuePtr<T> softmaxCrossEntropy(const std::vector<ValuePtr<T>> &logits,
+                                           const std::vector<ValuePtr<T>> &targets);
+    static std::vector<ValuePtr<T>> linear(const std::vector<ValuePtr<T>> &x, const std::vector<ValuePtr<T>> &weights,
+                                           const std::vector<ValuePtr<T>> &biases,
+                                           const WeightCache<T> *cache = nullptr);
+    static std::vector<ValuePtr<T>> normalize(const std::vector<ValuePtr<T>> &x, const std::vector<ValuePtr<T>> &gamma,
+                                              const std::vector<ValuePtr<T>> &beta, Normalization::Axis axis,
+                                              T epsilon, Normalization::Statistics<T> &statistics);
+
+    using Segment = std::function<std::vector<ValuePtr<T>>(const std::vector<ValuePtr<T>> &inputs)>;
+    static std::vector<ValuePtr<T>> checkpoint(const std::vector<ValuePtr<T>> &inputs, const Segment &segment);
 
     void backward();
     T getValue();
-    T getGradient();
+    Type::Accumulator<T> getGradient();
+    Type::Accumulator<T> getTangent();
+    void setTangent(Type::Accumulator<T> tangent);
 
     static double getTopoTime() { return topoSortTime; }
+    static void setBackwardThreads(size_t threads, bool deterministic = false);
 
     ValuePtr<T> tanh();
     ValuePtr<T> relu();
     ValuePtr<T> sigmoid();
     ValuePtr<T> exp();
     ValuePtr<T> log();
+    ValuePtr<T> abs();
+    ValuePtr<T> square();
     ValuePtr<T> pow(ValuePtr<T> exponent);
 
     template <typename U> friend ValuePtr<U> operator+(ValuePtr<U> a, ValuePtr<U> b);
@@ -72,6 +174,8 @@ template <typename T> class Value : public std::enable_shared_from_this<Value<T>
     template <typename U> friend ValuePtr<U> operator*(ValuePtr<U> a, ValuePtr<U> b);
     template <typename U> friend ValuePtr<U> operator/(ValuePtr<U> a, ValuePtr<U> b);
     template <typename U> friend ValuePtr<U> operator-(ValuePtr<U> a);
+    template <typename U> friend ValuePtr<U> operator*(ValuePtr<U> a, U factor);
+    template <typename U> friend ValuePtr<U> operator*(U factor, ValuePtr<U> a);
 
     template <typename U> friend bool operator>(ValuePtr<U> a, ValuePtr<U> b);
     template <typename U> friend bool operator>=(ValuePtr<U> a, ValuePtr<U> b);
@@ -83,41 +187,187 @@ template <typename T> class Value : public std::enable_shared_from_this<Value<T>
     template <typename U> friend std::ostream &operator<<(std::ostream &os, const ValuePtr<U> &value);
 };
 
-template <typename T> Value<T>::Value(T data) : _data(data) {}
+template <typename T>
+Value<T>::Value(T data, GraphArena *arena, Operation operation)
+    : _data(data), _children(ChildrenAllocator<ValuePtr<T>>(arena)),
+      _sequence(nextSequence.fetch_add(1, std::memory_order_relaxed)), _operation(operation),
+      _module(ModuleScope::current()) {
+    NodeStatistics::created(operation, sizeof(Value<T>));
+}
+
+template <typename T> Value<T>::~Value() { NodeStatistics::destroyed(sizeof(Value<T>), !_children.empty()); }
+
+template <typename T> ValuePtr<T> Value<T>::create(T data) { return Value<T>::create(data, Operation::Leaf); }
 
-template <typename T> ValuePtr<T> Value<T>::create(T data) { return std::shared_ptr<Value<T>>(new Value<T>(data)); }
+template <typename T> ValuePtr<T> Value<T>::create(T data, Operation operation) {
+    GraphArena *arena = GraphArena::current();
+    if (arena == nullptr)
+        return std::shared_ptr<Value<T>>(new Value<T>(data, nullptr, operation));
+
+    Value<T> *value = new (arena->allocate(sizeof(Value<T>), alignof(Value<T>))) Value<T>(data, arena, operation);
+    auto deleter = [arena](Value<T> *v) {
+        v->~Value<T>();
+        arena->deallocate(v, sizeof(Value<T>));
+    };
+
+    return std::shared_ptr<Value<T>>(value, deleter, ArenaAllocator<Value<T>>(arena));
+}
+
+// Literals are shared between all the graphs built on a thread. They live outside of any arena, and the operations
+// defined below do not propagate gradients into them. The pool is keyed by the bits of the literal, so that -0.0 does
+// not share the entry of 0.0.
+template <typename T> ValuePtr<T> Value<T>::constant(T data) {
+    thread_local std::unordered_map<uint64_t, ValuePtr<T>> pool;
+
+    const double literal = static_cast<double>(data);
+    uint64_t key;
+    std::memcpy(&key, &literal, sizeof(key));
+
+    auto found = pool.find(key);
+    if (found != pool.end())
+        return found->second;
+
+    GraphArena *arena = GraphArena::setCurrent(nullptr);
+    ValuePtr<T> result = Value<T>::create(data, Operation::Constant);
+    GraphArena::setCurrent(arena);
+
+    result->_constant = true;
+    if (pool.size() < constantPoolSize)
+        pool.emplace(key, result);
+
+    return result;
+}
 
 template <typename T> T Value<T>::getValue() { return _data; }
 
-template <typename T> T Value<T>::getGradient() { return _gradient; }
+template <typename T> Type::Accumulator<T> Value<T>::getGradient() { return _gradient; }
+
+template <typename T> Type::Accumulator<T> Value<T>::getTangent() { return _tangent; }
+
+template <typename T> void Value<T>::setTangent(Type::Accumulator<T> tangent) { _tangent = tangent; }
 
 template <typename T> ValuePtr<T> operator+(ValuePtr<T> a, ValuePtr<T> b) {
-    ValuePtr<T> result = Value<T>::create(a->_data + b->_data);
+    ValuePtr<T> result = Value<T>::create(a->_data + b->_data, Operation::Add);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = a->_tangent + b->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Add, result, a, b))
+        return result;
+
     result->_children = {a, b};
-    result->_backward = [a, b, result]() {
-        a->_gradient += result->_gradient;
-        b->_gradient += result->_gradient;
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += node->_gradient;
+        if (!node->_children[1]->_constant)
+            node->_children[1]->_gradient += node->_gradient;
     };
 
     return result;
 }
 
-template <typename T> ValuePtr<T> operator-(ValuePtr<T> a, ValuePtr<T> b) { return a + (-b); }
+template <typename T> ValuePtr<T> operator-(ValuePtr<T> a, ValuePtr<T> b) {
+    ValuePtr<T> result = Value<T>::create(a->_data - b->_data, Operation::Subtract);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = a->_tangent - b->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Subtract, result, a, b))
+        return result;
+
+    result->_children = {a, b};
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += node->_gradient;
+        if (!node->_children[1]->_constant)
+            node->_children[1]->_gradient -= node->_gradient;
+    };
+
+    return result;
+}
 
 template <typename T> ValuePtr<T> operator*(ValuePtr<T> a, ValuePtr<T> b) {
-    ValuePtr<T> result = Value<T>::create(a->_data * b->_data);
+    ValuePtr<T> result = Value<T>::create(a->_data * b->_data, Operation::Multiply);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = a->_tangent * b->_data + a->_data * b->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Multiply, result, a, b))
+        return result;
+
     result->_children = {a, b};
-    result->_backward = [a, b, result]() {
-        a->_gradient += b->_data * result->_gradient;
-        b->_gradient += a->_data * result->_gradient;
+    result->_backward = [node = result.get()]() {
+        const ValuePtr<T> &a = node->_children[0];
+        const ValuePtr<T> &b = node->_children[1];
+        if (!a->_constant)
+            a->_gradient += b->_data * node->_gradient;
+        if (!b->_constant)
+            b->_gradient += a->_data * node->_gradient;
     };
 
     return result;
 }
 
-template <typename T> ValuePtr<T> operator/(ValuePtr<T> a, ValuePtr<T> b) { return a * (b->pow(Value<T>::create(-1))); }
+template <typename T> ValuePtr<T> operator/(ValuePtr<T> a, ValuePtr<T> b) {
+    ValuePtr<T> result = Value<T>::create(a->_data / b->_data, Operation::Divide);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = (a->_tangent - result->_data * b->_tangent) / b->_data;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Divide, result, a, b))
+        return result;
 
-template <typename T> ValuePtr<T> operator-(ValuePtr<T> a) { return Value<T>::create(-1) * a; }
+    result->_children = {a, b};
+    result->_backward = [node = result.get()]() {
+        const ValuePtr<T> &a = node->_children[0];
+        const ValuePtr<T> &b = node->_children[1];
+        if (!a->_constant)
+            a->_gradient += node->_gradient / b->_data;
+        if (!b->_constant)
+            b->_gradient -= node->_gradient * node->_data / b->_data;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> operator-(ValuePtr<T> a) {
+    ValuePtr<T> result = Value<T>::create(-a->_data, Operation::Negate);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = -a->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Negate, result, a))
+        return result;
+
+    result->_children = {a};
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient -= node->_gradient;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> operator*(ValuePtr<T> a, T factor) {
+    ValuePtr<T> result = Value<T>::create(a->_data * factor, Operation::Scale);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = factor * a->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() ||
+        Tape<T>::record(Tape<T>::Operation::Scale, result, a, Value<T>::constant(factor)))
+        return result;
+
+    result->_children = {a};
+    result->_backward = [node = result.get(), factor]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += factor * node->_gradient;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> operator*(T factor, ValuePtr<T> a) { return a * factor; }
 
 template <typename T> bool operator<(ValuePtr<T> a, ValuePtr<T> b) { return a->getValue() < b->getValue(); }
 template <typename T> bool operator<=(ValuePtr<T> a, ValuePtr<T> b) { return a->getValue() <= b->getValue(); }
@@ -129,10 +379,18 @@ template <typename T> bool operator!=(ValuePtr<T> a, ValuePtr<T> b) { return a->
 template <typename T> ValuePtr<T> Value<T>::tanh() {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create((std::exp(2 * thisValue->_data) - 1) / (std::exp(2 * thisValue->_data) + 1));
+    ValuePtr<T> result = Value<T>::create((std::exp(2 * thisValue->_data) - 1) / (std::exp(2 * thisValue->_data) + 1), Operation::Tanh);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = (1 - result->_data * result->_data) * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Tanh, result, thisValue))
+        return result;
+
     result->_children = {thisValue};
-    result->_backward = [thisValue, result]() {
-        thisValue->_gradient += (1 - (result->_data * result->_data)) * result->_gradient;
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += (1 - (node->_data * node->_data)) * node->_gradient;
     };
 
     return result;
@@ -141,10 +399,18 @@ template <typename T> ValuePtr<T> Value<T>::tanh() {
 template <typename T> ValuePtr<T> Value<T>::sigmoid() {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create(1 / (std::exp(-thisValue->_data) + 1));
+    ValuePtr<T> result = Value<T>::create(1 / (std::exp(-thisValue->_data) + 1), Operation::Sigmoid);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = result->_data * (1 - result->_data) * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Sigmoid, result, thisValue))
+        return result;
+
     result->_children = {thisValue};
-    result->_backward = [thisValue, result]() {
-        thisValue->_gradient += result->_data * (1 - result->_data) * result->_gradient;
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += node->_data * (1 - node->_data) * node->_gradient;
     };
 
     return result;
@@ -153,10 +419,18 @@ template <typename T> ValuePtr<T> Value<T>::sigmoid() {
 template <typename T> ValuePtr<T> Value<T>::relu() {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create(_data > 0 ? _data : 0);
+    ValuePtr<T> result = Value<T>::create(_data > 0 ? _data : T(0), Operation::ReLU);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = (result->_data > 0 ? 1 : 0) * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::ReLU, result, thisValue))
+        return result;
+
     result->_children = {thisValue};
-    result->_backward = [thisValue, result]() {
-        thisValue->_gradient += (result->_data > 0 ? 1 : 0) * result->_gradient;
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += (node->_data > 0 ? 1 : 0) * node->_gradient;
     };
 
     return result;
@@ -165,9 +439,19 @@ template <typename T> ValuePtr<T> Value<T>::relu() {
 template <typename T> ValuePtr<T> Value<T>::exp() {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create(std::exp(_data));
+    ValuePtr<T> result = Value<T>::create(std::exp(_data), Operation::Exp);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = result->_data * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Exp, result, thisValue))
+        return result;
+
     result->_children = {thisValue};
-    result->_backward = [thisValue, result]() { thisValue->_gradient += result->_data * result->_gradient; };
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += node->_data * node->_gradient;
+    };
 
     return result;
 }
@@ -175,9 +459,59 @@ template <typename T> ValuePtr<T> Value<T>::exp() {
 template <typename T> ValuePtr<T> Value<T>::log() {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create(std::log(_data));
+    ValuePtr<T> result = Value<T>::create(std::log(_data), Operation::Log);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = _tangent / _data;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Log, result, thisValue))
+        return result;
+
     result->_children = {thisValue};
-    result->_backward = [thisValue, result]() { thisValue->_gradient += (1 / thisValue->_data) * result->_gradient; };
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += (1 / node->_children[0]->_data) * node->_gradient;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> Value<T>::abs() {
+    auto thisValue = this->shared_from_this();
+
+    ValuePtr<T> result = Value<T>::create(_data < 0 ? -_data : _data, Operation::Abs);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = (_data < 0 ? -1 : 1) * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Abs, result, thisValue))
+        return result;
+
+    result->_children = {thisValue};
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += (node->_children[0]->_data < 0 ? -1 : 1) * node->_gradient;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> Value<T>::square() {
+    auto thisValue = this->shared_from_this();
+
+    ValuePtr<T> result = Value<T>::create(_data * _data, Operation::Square);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = 2 * _data * _tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Square, result, thisValue))
+        return result;
+
+    result->_children = {thisValue};
+    result->_backward = [node = result.get()]() {
+        if (!node->_children[0]->_constant)
+            node->_children[0]->_gradient += 2 * node->_children[0]->_data * node->_gradient;
+    };
 
     return result;
 }
@@ -185,62 +519,823 @@ template <typename T> ValuePtr<T> Value<T>::log() {
 template <typename T> ValuePtr<T> Value<T>::pow(ValuePtr<T> exponent) {
     auto thisValue = this->shared_from_this();
 
-    ValuePtr<T> result = Value<T>::create(std::pow(_data, exponent->_data));
+    ValuePtr<T> result = Value<T>::create(std::pow(_data, exponent->_data), Operation::Pow);
+    if (ForwardModeGuard::isActive()) {
+        result->_tangent = (exponent->_data * std::pow(_data, exponent->_data - 1)) * _tangent;
+        if (exponent->_tangent != 0)
+            result->_tangent += (result->_data * std::log(_data)) * exponent->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Pow, result, thisValue, exponent))
+        return result;
+
     result->_children = {thisValue, exponent};
-    result->_backward = [thisValue, exponent, result]() {
-        thisValue->_gradient += (exponent->_data * std::pow(thisValue->_data, exponent->_data - 1)) * result->_gradient;
-        exponent->_gradient +=
-            (std::pow(thisValue->_data, exponent->_data) * std::log(thisValue->_data)) * result->_gradient;
+    result->_backward = [node = result.get()]() {
+        const ValuePtr<T> &base = node->_children[0];
+        const ValuePtr<T> &exponent = node->_children[1];
+        if (!base->_constant)
+            base->_gradient += (exponent->_data * std::pow(base->_data, exponent->_data - 1)) * node->_gradient;
+        if (!exponent->_constant)
+            exponent->_gradient += (node->_data * std::log(base->_data)) * node->_gradient;
+    };
+
+    return result;
+}
+
+template <typename T> ValuePtr<T> Value<T>::sum(const std::vector<ValuePtr<T>> &values) {
+    Type::Accumulator<T> total = 0;
+    for (const ValuePtr<T> &val : values)
+        total += val->_data;
+
+    ValuePtr<T> result = Value<T>::create(total, Operation::Sum);
+    if (ForwardModeGuard::isActive()) {
+        for (const ValuePtr<T> &val : values)
+            result->_tangent += val->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Sum, result, values))
+        return result;
+
+    result->_children.assign(values.begin(), values.end());
+    result->_backward = [node = result.get()]() {
+        for (const ValuePtr<T> &child : node->_children)
+            if (!child->_constant)
+                child->_gradient += node->_gradient;
+    };
+
+    return result;
+}
+
+// The gradient flows only to the first of the largest values.
+template <typename T> ValuePtr<T> Value<T>::max(const std::vector<ValuePtr<T>> &values) {
+    if (values.empty()) {
+        throw std::invalid_argument("Cannot compute the maximum of an empty list of values.");
+    }
+
+    T largest = values[0]->_data;
+    for (const ValuePtr<T> &val : values)
+        largest = std::max(largest, val->_data);
+
+    ValuePtr<T> result = Value<T>::create(largest, Operation::Max);
+    if (ForwardModeGuard::isActive()) {
+        for (const ValuePtr<T> &val : values) {
+            if (val->_data == largest) {
+                result->_tangent = val->_tangent;
+                break;
+            }
+        }
+        return result;
+    }
+    if (NoGradGuard::isActive() || Tape<T>::record(Tape<T>::Operation::Max, result, values))
+        return result;
+
+    result->_children.assign(values.begin(), values.end());
+    result->_backward = [node = result.get()]() {
+        for (const ValuePtr<T> &child : node->_children) {
+            if (child->_data == node->_data) {
+                if (!child->_constant)
+                    child->_gradient += node->_gradient;
+                return;
+            }
+        }
     };
 
     return result;
 }
 
+// Children are laid out as {a_0, ..., a_n-1, b_0, ..., b_n-1}.
+template <typename T> ValuePtr<T> Value<T>::dot(const std::vector<ValuePtr<T>> &a, const std::vector<ValuePtr<T>> &b) {
+    Type::Accumulator<T> total = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        total += a[i]->_data * b[i]->_data;
+
+    ValuePtr<T> result = Value<T>::create(total, Operation::Dot);
+    if (ForwardModeGuard::isActive()) {
+        for (size_t i = 0; i < a.size(); ++i)
+            result->_tangent += a[i]->_tangent * b[i]->_data + a[i]->_data * b[i]->_tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive())
+        return result;
+
+    std::vector<ValuePtr<T>> operands;
+    operands.reserve(2 * a.size());
+    operands.insert(operands.end(), a.begin(), a.end());
+    operands.insert(operands.end(), b.begin(), b.end());
+
+    if (Tape<T>::record(Tape<T>::Operation::Dot, result, operands))
+        return result;
+
+    result->_children.assign(operands.begin(), operands.end());
+    result->_backward = [node = result.get()]() {
+        size_t n = node->_children.size() / 2;
+        for (size_t i = 0; i < n; ++i) {
+            const ValuePtr<T> &left = node->_children[i];
+            const ValuePtr<T> &right = node->_children[n + i];
+            if (!left->_constant)
+                left->_gradient += right->_data * node->_gradient;
+            if (!right->_constant)
+                right->_gradient += left->_data * node->_gradient;
+        }
+    };
+
+    return result;
+}
+
+// Children are laid out as {w_0, ..., w_n-1, x_0, ..., x_n-1, bias}.
+template <typename T>
+ValuePtr<T> Value<T>::affine(const std::vector<ValuePtr<T>> &weights, const std::vector<ValuePtr<T>> &x,
+                             ValuePtr<T> bias) {
+    Type::Accumulator<T> total = 0;
+    for (size_t i = 0; i < weights.size(); ++i)
+        total += weights[i]->_data * x[i]->_data;
+
+    ValuePtr<T> result = Value<T>::create(bias->_data + total, Operation::Affine);
+    if (ForwardModeGuard::isActive()) {
+        Type::Accumulator<T> tangent = 0;
+        for (size_t i = 0; i < weights.size(); ++i)
+            tangent += weights[i]->_tangent * x[i]->_data + weights[i]->_data * x[i]->_tangent;
+        result->_tangent = bias->_tangent + tangent;
+        return result;
+    }
+    if (NoGradGuard::isActive())
+        return result;
+
+    std::vector<ValuePtr<T>> operands;
+    operands.reserve(2 * weights.size() + 1);
+    operands.insert(operands.end(), weights.begin(), weights.end());
+    operands.insert(operands.end(), x.begin(), x.end());
+    operands.push_back(bias);
+
+    if (Tape<T>::record(Tape<T>::Operation::Affine, result, operands))
+        return result;
+
+    result->_children.assign(operands.begin(), operands.end());
+    result->_backward = [node = result.get()]() {
+        size_t n = node->_children.size() / 2;
+        for (size_t i = 0; i < n; ++i) {
+            const ValuePtr<T> &w = node->_children[i];
+            const ValuePtr<T> &in = node->_children[n + i];
+            if (!w->_constant)
+                w->_gradient += in->_data * node->_gradient;
+            if (!in->_constant)
+                in->_gradient += w->_data * node->_gradient;
+        }
+        if (!node->_children.back()->_constant)
+            node->_children.back()->_gradient += node->_gradient;
+    };
+
+    return result;
+}
+
+// Cross entropy between softmax(logits) and the targets, sum(t * (logsumexp(x) - x)), as a single node. The log-sum-exp
+// is shifted by the largest logit, so large logits neither overflow nor lose their precision, and the gradient of the
+// logits is softmax(x) * sum(t) - t. Forward mode and tapes fall back to the regular operations, where the shift is
+// itself an operation, so that replaying the tape shifts by the largest of the new logits.
+template <typename T>
+ValuePtr<T> Value<T>::softmaxCrossEntropy(const std::vector<ValuePtr<T>> &logits,
+                                          const std::vector<ValuePtr<T>> &targets) {
+    using Accumulator = Type::Accumulator<T>;
+
+    if (logits.size() != targets.size() || logits.empty()) {
+        throw std::invalid_argument("Logits and targets need to be of the same, positive size to compute the Cross "
+                                    "Entropy loss. Sizes are " +
+                                    std::to_string(logits.size()) + " and " + std::to_string(targets.size()) + ".");
+    }
+
+    if (ForwardModeGuard::isActive() || Tape<T>::current() != nullptr) {
+        ValuePtr<T> shift = Value<T>::max(logits);
+        std::vector<ValuePtr<T>> terms;
+        terms.reserve(logits.size());
+        for (const ValuePtr<T> &logit : logits)
+            terms.push_back((logit - shift)->exp());
+
+        ValuePtr<T> logSumExp = Value<T>::sum(terms)->log() + shift;
+        for (size_t i = 0; i < logits.size(); ++i)
+            terms[i] = logSumExp - logits[i];
+        return Value<T>::dot(targets, terms);
+    }
+
+    T largest = logits[0]->_data;
+    for (const ValuePtr<T> &logit : logits)
+        largest = std::max(largest, logit->_data);
+
+    std::vector<Accumulator> probabilities(logits.size());
+    Accumulator total = 0;
+    for (size_t i = 0; i < logits.size(); ++i) {
+        probabilities[i] = std::exp(Accumulator(logits[i]->_data) - Accumulator(largest));
+        total += probabilities[i];
+    }
+    const Accumulator logSumExp = Accumulator(largest) + std::log(total);
+
+    Accumulator loss = 0, targetSum = 0;
+    for (size_t i = 0; i < logits.size(); ++i) {
+        probabilities[i] /= total;
+        loss += targets[i]->_data * (logSumExp - logits[i]->_data);
+        targetSum += targets[i]->_data;
+    }
+
+    ValuePtr<T> result = Value<T>::create(loss, Operation::CrossEntropy);
+    if (NoGradGuard::isActive())
+        return result;
+
+    result->_children.reserve(2 * logits.size());
+    result->_children.insert(result->_children.end(), logits.begin(), logits.end());
+    result->_children.insert(result->_children.end(), targets.begin(), targets.end());
+    result->_backward = [node = result.get(), probabilities = std::move(probabilities), logSumExp, targetSum]() {
+        const size_t classes = probabilities.size();
+        const ValuePtr<T> *logits = node->_children.data();
+        const ValuePtr<T> *targets = logits + classes;
+        for (size_t i = 0; i < classes; ++i) {
+            if (!logits[i]->_constant)
+                logits[i]->_gradient += node->_gradient * (probabilities[i] * targetSum - targets[i]->_data);
+            if (!targets[i]->_constant)
+                targets[i]->_gradient += node->_gradient * (logSumExp - logits[i]->_data);
+        }
+    };
+
+    return result;
+}
+
+// Computes Y = X * W^T + b for a batch, where x holds the rows of X one after another and the weights hold the rows of
+// W, one per bias. All outputs depend on a single hidden node with the whole batch as its children, whose backward
+// computes dW = dY^T * X, db as the column sums of dY, and dX = dY * W. Its children are laid out as {x, weights,
+// biases}, and tapes record the same hub. Forward mode falls back to one affine node per output. Layers pass their
+// cache of the packed weights, which are otherwise gathered on every call.
+template <typename T>
+std::vector<ValuePtr<T>> Value<T>::linear(const std::vector<ValuePtr<T>> &x, const std::vector<ValuePtr<T>> &weights,
+                                          const std::vector<ValuePtr<T>> &biases, const WeightCache<T> *cache) {
+    using Accumulator = Type::Accumulator<T>;
+
+    const size_t outputs = biases.size();
+    const size_t inputs = outputs == 0 ? 0 : weights.size() / outputs;
+    const size_t rows = inputs == 0 ? 0 : x.size() / inputs;
+    if (inputs * outputs != weights.size() || rows * inputs != x.size()) {
+        throw std::invalid_argument("Weights of size " + std::to_string(weights.size()) + " and " +
+                                    std::to_string(outputs) + " biases cannot be applied to inputs of size " +
+                                    std::to_string(x.size()) + ".");
+    }
+
+    std::vector<ValuePtr<T>> result;
+    result.reserve(rows * outputs);
+
+    if (ForwardModeGuard::isActive()) {
+        std::vector<std::vector<ValuePtr<T>>> weightRows(outputs);
+        for (size_t o = 0; o < outputs; ++o)
+            weightRows[o].assign(weights.begin() + o * inputs, weights.begin() + (o + 1) * inputs);
+
+        for (size_t r = 0; r < rows; ++r) {
+            std::vector<ValuePtr<T>> row(x.begin() + r * inputs, x.begin() + (r + 1) * inputs);
+            for (size_t o = 0; o < outputs; ++o)
+                result.push_back(Value<T>::affine(weightRows[o], row, biases[o]));
+        }
+        return result;
+    }
+
+    struct Saved {
+        std::vector<Accumulator> input;
+        std::shared_ptr<const typename WeightCache<T>::Packed> weights;
+        std::vector<Accumulator> gradients;
+    };
+    auto saved = std::make_shared<Saved>();
+    saved->input.resize(x.size());
+    for (size_t i = 0; i < x.size(); ++i)
+        saved->input[i] = x[i]->_data;
+    saved->weights = cache != nullptr ? cache->get(weights, outputs) : WeightCache<T>::pack(weights, outputs, rows > 1);
+    const Accumulator *weight = saved->weights->weights.data();
+
+    // A single sample takes a dot product with every row of the weights. Batches are multiplied by the transposed
+    // weights instead, since transposed matrices are slower to pack.
+    std::vector<Accumulator> product(rows * outputs);
+    if (rows == 1) {
+        Gemm::multiplyVector(false, outputs, inputs, Accumulator(1), weight, inputs, saved->input.data(), Accumulator(0),
+                             product.data());
+    } else {
+        Gemm::multiply(false, false, rows, outputs, inputs, Accumulator(1), saved->input.data(), inputs,
+                       saved->weights->transposed.data(), outputs, Accumulator(0), product.data(), outputs);
+    }
+
+    // The hub is created before the outputs that depend on it, so that the order of creation stays a topological one.
+    ValuePtr<T> hub = NoGradGuard::isActive() ? nullptr : Value<T>::create(0, Operation::MatMul);
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t o = 0; o < outputs; ++o)
+            result.push_back(Value<T>::create(biases[o]->_data + product[r * outputs + o], Operation::MatMul));
+    if (!hub)
+        return result;
+
+    hub->_batched = rows > 1;
+    if (Tape<T>::recordLinear(hub, x, weights, biases, result))
+        return result;
+
+    saved->gradients.resize(result.size(), 0);
+    hub->_children.reserve(x.size() + weights.size() + biases.size());
+    hub->_children.insert(hub->_children.end(), x.begin(), x.end());
+    hub->_children.insert(hub->_children.end(), weights.begin(), weights.end());
+    hub->_children.insert(hub->_children.end(), biases.begin(), biases.end());
+    hub->_backward = [node = hub.get(), saved, rows, inputs, outputs]() {
+        const ValuePtr<T> *x = node->_children.data();
+        const ValuePtr<T> *weights = x + rows * inputs;
+        const ValuePtr<T> *biases = weights + outputs * inputs;
+        const Accumulator *dY = saved->gradients.data();
+
+        // dX = dY * W and dW = dY^T * X.
+        std::vector<Accumulator> dX(rows * inputs);
+        Gemm::multiply(false, false, rows, inputs, outputs, Accumulator(1), dY, outputs, saved->weights->weights.data(), inputs,
+                       Accumulator(0), dX.data(), inputs);
+        for (size_t i = 0; i < dX.size(); ++i)
+            if (!x[i]->_constant)
+                x[i]->_gradient += dX[i];
+
+        std::vector<Accumulator> dW(outputs * inputs);
+        Gemm::multiply(true, false, outputs, inputs, rows, Accumulator(1), dY, outputs, saved->input.data(), inputs,
+                       Accumulator(0), dW.data(), inputs);
+        for (size_t i = 0; i < dW.size(); ++i)
+            if (!weights[i]->_constant)
+                weights[i]->_gradient += dW[i];
+
+        for (size_t o = 0; o < outputs; ++o) {
+            Accumulator bias = 0;
+            for (size_t r = 0; r < rows; ++r)
+                bias += dY[r * outputs + o];
+            if (!biases[o]->_constant)
+                biases[o]->_gradient += bias;
+        }
+    };
+
+    // The hub keeps the saved gradients alive for as long as the outputs point to it, so that their closures fit in
+    // std::function without allocating.
+    for (size_t k = 0; k < result.size(); ++k) {
+        result[k]->_children = {hub};
+        result[k]->_backward = [node = result[k].get(), gradient = &saved->gradients[k]]() {
+            *gradient = node->_gradient;
+        };
+    }
+
+    return result;
+}
+
+// Normalizes x, holding rows of one value per entry of gamma, along the given axis (see Normalization). Measured
+// statistics are written to the given ones. All outputs depend on a single hidden node with the children {x, gamma,
+// beta}, whose backward runs the fused kernel. Forward mode and tapes fall back to the regular operations.
+template <typename T>
+std::vector<ValuePtr<T>> Value<T>::normalize(const std::vector<ValuePtr<T>> &x, const std::vector<ValuePtr<T>> &gamma,
+                                             const std::vector<ValuePtr<T>> &beta, Normalization::Axis axis,
+                                             T epsilon, Normalization::Statistics<T> &statistics) {
+    using Accumulator = Type::Accumulator<T>;
+    using Axis = Normalization::Axis;
+
+    const size_t features = gamma.size();
+    const size_t rows = features == 0 ? 0 : x.size() / features;
+    if (beta.size() != features || rows * features != x.size() || rows == 0) {
+        throw std::invalid_argument("Cannot normalize inputs of size " + std::to_string(x.size()) + " with " +
+                                    std::to_string(gamma.size()) + " scales and " + std::to_string(beta.size()) +
+                                    " shifts.");
+    }
+
+    const size_t groups = Normalization::groups(axis, rows, features);
+    const size_t size = axis == Axis::Batch ? rows : features;
+    if (!statistics.measured && (statistics.mean.size() != groups || statistics.variance.size() != groups)) {
+        throw std::invalid_argument("Normalization needs " + std::to_string(groups) +
+                                    " means and variances. Sizes are " + std::to_string(statistics.mean.size()) +
+                                    " and " +
+                                    std::to_string(statistics.variance.size()) + ".");
+    }
+    if (statistics.measured) {
+        statistics.mean.resize(groups);
+        statistics.variance.resize(groups);
+    }
+
+    std::vector<ValuePtr<T>> result(x.size());
+
+    if (ForwardModeGuard::isActive() || Tape<T>::current() != nullptr) {
+        const T scale = static_cast<T>(1) / static_cast<T>(size);
+        std::vector<ValuePtr<T>> group(size);
+        for (size_t g = 0; g < groups; ++g) {
+            auto index = [&](size_t i) { return axis == Axis::Batch ? i * features + g : g * features + i; };
+            for (size_t i = 0; i < size; ++i)
+                group[i] = x[index(i)];
+
+            ValuePtr<T> mean, inverseDeviation;
+            if (statistics.measured) {
+                mean = Value<T>::sum(group) * scale;
+                for (size_t i = 0; i < size; ++i)
+                    group[i] = (group[i] - mean)->square();
+                ValuePtr<T> variance = Value<T>::sum(group) * scale;
+                inverseDeviation = (variance + Value<T>::constant(epsilon))->pow(Value<T>::constant(-0.5));
+                statistics.mean[g] = mean->_data;
+                statistics.variance[g] = variance->_data;
+            } else {
+                mean = Value<T>::constant(statistics.mean[g]);
+                inverseDeviation =
+                    Value<T>::constant(static_cast<T>(1 / std::sqrt(Accumulator(statistics.variance[g]) + epsilon)));
+            }
+
+            for (size_t i = 0; i < size; ++i) {
+                const size_t f = axis == Axis::Batch ? g : i;
+                result[index(i)] = gamma[f] * ((x[index(i)] - mean) * inverseDeviation) + beta[f];
+            }
+        }
+        return result;
+    }
+
+    struct Saved {
+        std::vector<Accumulator> normalized;
+        std::vector<Accumulator> inverseDeviation;
+        std::vector<Accumulator> gamma;
+        std::vector<Accumulator> gradients;
+    };
+    auto saved = std::make_shared<Saved>();
+    saved->normalized.resize(x.size());
+    saved->inverseDeviation.resize(groups);
+    saved->gamma.resize(features);
+
+    std::vector<Accumulator> input(x.size()), shift(features), mean(groups), variance(groups), y(x.size());
+    for (size_t i = 0; i < x.size(); ++i)
+        input[i] = x[i]->_data;
+    for (size_t f = 0; f < features; ++f) {
+        saved->gamma[f] = gamma[f]->_data;
+        shift[f] = beta[f]->_data;
+    }
+
+    if (statistics.measured) {
+        Normalization::measure(axis, input.data(), rows, features, mean.data(), variance.data());
+        for (size_t g = 0; g < groups; ++g) {
+            statistics.mean[g] = static_cast<T>(mean[g]);
+            statistics.variance[g] = static_cast<T>(variance[g]);
+        }
+    } else {
+        std::copy(statistics.mean.begin(), statistics.mean.end(), mean.begin());
+        std::copy(statistics.variance.begin(), statistics.variance.end(), variance.begin());
+    }
+    Normalization::forward(axis, input.data(), rows, features, mean.data(), variance.data(), Accumulator(epsilon),
+                           saved->gamma.data(), shift.data(), saved->normalized.data(),
+                           saved->inverseDeviation.data(), y.data());
+
+    ValuePtr<T> hub = NoGradGuard::isActive() ? nullptr : Value<T>::create(0, Operation::Normalize);
+    for (size_t i = 0; i < x.size(); ++i)
+        result[i] = Value<T>::create(y[i], Operation::Normalize);
+    if (!hub)
+        return result;
+
+    saved->gradients.resize(result.size(), 0);
+
+    hub->_batched = rows > 1;
+    hub->_children.reserve(x.size() + 2 * features);
+    hub->_children.insert(hub->_children.end(), x.begin(), x.end());
+    hub->_children.insert(hub->_children.end(), gamma.begin(), gamma.end());
+    hub->_children.insert(hub->_children.end(), beta.begin(), beta.end());
+    hub->_backward = [node = hub.get(), saved, axis, measured = statistics.measured, rows, features]() {
+        const ValuePtr<T> *x = node->_children.data();
+        const ValuePtr<T> *gamma = x + rows * features;
+        const ValuePtr<T> *beta = gamma + features;
+
+        std::vector<Accumulator> dX(rows * features, 0), dGamma(features, 0), dBeta(features, 0);
+        Normalization::backward(axis, measured, saved->normalized.data(), saved->inverseDeviation.data(),
+                                saved->gamma.data(), saved->gradients.data(), rows, features, dX.data(),
+                                dGamma.data(), dBeta.data());
+
+        for (size_t i = 0; i < dX.size(); ++i)
+            if (!x[i]->_constant)
+                x[i]->_gradient += dX[i];
+        for (size_t f = 0; f < features; ++f) {
+            if (!gamma[f]->_constant)
+                gamma[f]->_gradient += dGamma[f];
+            if (!beta[f]->_constant)
+                beta[f]->_gradient += dBeta[f];
+        }
+    };
+
+    for (size_t k = 0; k < result.size(); ++k) {
+        result[k]->_children = {hub};
+        result[k]->_backward = [node = result[k].get(), saved, k]() { saved->gradients[k] = node->_gradient; };
+    }
+
+    return result;
+}
+
+// The segment is evaluated without keeping its graph. Instead, all outputs depend on a single hidden node, which
+// recomputes the segment from copies of the inputs during backward() and propagates the gradients of the outputs
+// through it. The random generator is rewound for the recomputation, so random layers make the same choices.
+template <typename T>
+std::vector<ValuePtr<T>> Value<T>::checkpoint(const std::vector<ValuePtr<T>> &inputs, const Segment &segment) {
+    if (NoGradGuard::isActive() || ForwardModeGuard::isActive() || Tape<T>::current() != nullptr)
+        return segment(inputs);
+
+    std::mt19937 generatorState = utils::generator;
+    std::vector<ValuePtr<T>> values;
+    {
+        NoGradGuard guard;
+        values = segment(inputs);
+    }
+
+    auto gradients = std::make_shared<std::vector<Type::Accumulator<T>>>(values.size(), 0);
+
+    ValuePtr<T> hub = Value<T>::create(0, Operation::Checkpoint);
+    hub->_recomputes = true;
+    hub->_children.assign(inputs.begin(), inputs.end());
+    hub->_backward = [node = hub.get(), segment, generatorState, gradients]() {
+        std::vector<ValuePtr<T>> copies;
+        copies.reserve(node->_children.size());
+        for (const ValuePtr<T> &input : node->_children)
+            copies.push_back(Value<T>::create(input->_data));
+
+        std::mt19937 currentState = utils::generator;
+        utils::generator = generatorState;
+        std::vector<ValuePtr<T>> recomputed;
+        {
+            RecomputeGuard guard;
+            recomputed = segment(copies);
+        }
+        utils::generator = currentState;
+
+        ValuePtr<T> root = Value<T>::create(0, Operation::Checkpoint);
+        root->_children.assign(recomputed.begin(), recomputed.end());
+        root->_backward = [root = root.get(), gradients]() {
+            for (size_t i = 0; i < gradients->size(); ++i)
+                if (!root->_children[i]->_constant)
+                    root->_children[i]->_gradient += (*gradients)[i];
+        };
+        root->backward();
+
+        for (size_t i = 0; i < copies.size(); ++i)
+            if (!node->_children[i]->_constant)
+                node->_children[i]->_gradient += copies[i]->_gradient;
+    };
+
+    std::vector<ValuePtr<T>> outputs;
+    outputs.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        ValuePtr<T> output = Value<T>::create(values[i]->_data, Operation::Checkpoint);
+        output->_children = {hub};
+        output->_backward = [node = output.get(), gradients, i]() { (*gradients)[i] = node->_gradient; };
+        outputs.push_back(output);
+    }
+
+    return outputs;
+}
+
 template <typename T> std::vector<ValuePtr<T>> Value<T>::topologicalSort() {
+    Profiler::Span span("Value::topologicalSort", "Backward");
     auto timer = utils::startTimer();
 
+    std::vector<std::pair<uint64_t, Value<T> *>> inner;
+    std::vector<Value<T> *> leaves;
+    std::unordered_set<Value<T> *> visited = {this};
+
+    std::vector<Value<T> *> stack = {this};
+    while (!stack.empty()) {
+        Value<T> *cur = stack.back();
+        stack.pop_back();
+        if (cur->_children.empty()) {
+            leaves.push_back(cur);
+            continue;
+        }
+
+        inner.emplace_back(cur->_sequence, cur);
+        for (const ValuePtr<T> &child : cur->_children)
+            if (visited.insert(child.get()).second)
+                stack.push_back(child.get());
+    }
+
+    // Children are created before their parents, so the order of creation is a topological order. It is also the order
+    // of the records of a Tape, which makes both engines add up the gradients in the same order. Leaves have nothing
+    // to run, so they only go first.
+    std::sort(inner.begin(), inner.end());
+
     std::vector<ValuePtr<T>> sorted;
-    std::unordered_set<Value<T> *> visited;
+    sorted.reserve(leaves.size() + inner.size());
+    for (Value<T> *leaf : leaves)
+        sorted.push_back(leaf->shared_from_this());
+    for (const auto &[sequence, node] : inner)
+        sorted.push_back(node->shared_from_this());
 
-    std::stack<Value<T> *> stack;
-    stack.push(this);
+    topoSortTime += utils::stopTimer(timer);
 
-    while (!stack.empty()) {
-        auto cur = stack.top();
-        if (visited.find(cur) == visited.end()) {
-            bool hasUnvisitedChildren = false;
-            for (auto v : cur->_children) {
-                if (visited.find(v.get()) == visited.end()) {
-                    stack.push(v.get());
-                    hasUnvisitedChildren = true;
-                }
+    return sorted;
+}
+
+// Runs the closure of a node, timing it for the profiler if times are given. Leaves have nothing to time.
+template <typename T> void Value<T>::runBackward(Value<T> *node, Profiler::OperationTimes *times) {
+    if (times == nullptr || node->_children.empty()) {
+        node->_backward();
+        return;
+    }
+
+    int64_t start = Profiler::now();
+    node->_backward();
+    times->add(node->_operation, Profiler::now() - start);
+}
+
+template <typename T> void Value<T>::setBackwardThreads(size_t threads, bool deterministic) {
+    backwardPool = threads > 1 ? std::make_shared<ThreadPool>(threads) : nullptr;
+    deterministicBackward = deterministic;
+}
+
+// Runs the closures of the sorted graph on the backward pool. Starting from the root, nodes are moved to a serial
+// trunk until the rest of the graph falls apart into independent components, e.g. one per sample of a batch. The
+// components only meet at leaves, such as the parameters, so each worker accumulates their gradients in its own copies,
+// which are added to the leaves in the order of the workers. In the deterministic mode, every worker gets a fixed range
+// of components, so the result depends only on the number of threads. Returns false if the graph was not processed.
+// The hubs of Value::linear and Value::normalize over several rows join all of them into one component, so graphs of
+// batches are not split at all and run on the calling thread.
+template <typename T> bool Value<T>::parallelBackward(const std::vector<ValuePtr<T>> &sorted) {
+    if (!backwardPool || ThreadPool::isInsideWorker() || sorted.size() < minParallelNodes)
+        return false;
+    for (const ValuePtr<T> &node : sorted)
+        if (node->_batched)
+            return false;
+
+    const uint32_t n = static_cast<uint32_t>(sorted.size());
+    const uint32_t root = n - 1;
+
+    for (uint32_t i = 0; i < n; ++i)
+        sorted[i]->_position = i;
+
+    std::vector<uint32_t> parents(n, 0);
+    std::vector<uint32_t> leafIndex(n, 0);
+    std::vector<Value<T> *> leaves;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (sorted[i]->_children.empty()) {
+            leafIndex[i] = static_cast<uint32_t>(leaves.size());
+            leaves.push_back(sorted[i].get());
+        }
+        for (const ValuePtr<T> &child : sorted[i]->_children)
+            parents[child->_position]++;
+    }
+    auto isLeaf = [&sorted](uint32_t i) { return sorted[i]->_children.empty(); };
+
+    std::vector<bool> inTrunk(n, false);
+    std::vector<uint32_t> parentsInTrunk(n, 0);
+    std::vector<uint32_t> frontier = {root};
+    inTrunk[root] = true;
+
+    std::vector<uint32_t> component(n);
+    std::vector<uint32_t> components;
+    for (size_t depth = 0; depth < maxTrunkDepth; ++depth) {
+        for (uint32_t i = 0; i < n; ++i)
+            component[i] = i;
+        auto find = [&component](uint32_t i) {
+            while (component[i] != i)
+                i = component[i] = component[component[i]];
+            return i;
+        };
+
+        for (uint32_t i = 0; i < n; ++i) {
+            if (inTrunk[i] || isLeaf(i))
+                continue;
+            for (const ValuePtr<T> &child : sorted[i]->_children) {
+                uint32_t c = child->_position;
+                if (!inTrunk[c] && !isLeaf(c))
+                    component[find(c)] = find(i);
             }
+        }
 
-            if (!hasUnvisitedChildren) {
-                stack.pop();
-                sorted.push_back(cur->shared_from_this());
-                visited.insert(cur);
+        components.clear();
+        for (uint32_t i = 0; i < n; ++i) {
+            component[i] = find(i);
+            if (!inTrunk[i] && !isLeaf(i) && component[i] == i)
+                components.push_back(i);
+        }
+        if (components.size() > 1)
+            break;
+
+        std::vector<uint32_t> next;
+        for (uint32_t f : frontier) {
+            for (const ValuePtr<T> &child : sorted[f]->_children) {
+                uint32_t c = child->_position;
+                if (++parentsInTrunk[c] == parents[c] && !isLeaf(c)) {
+                    inTrunk[c] = true;
+                    next.push_back(c);
+                }
             }
-        } else {
-            stack.pop();
         }
+        if (next.empty())
+            break;
+        frontier = std::move(next);
     }
 
-    topoSortTime += utils::stopTimer(timer);
+    if (components.size() < 2)
+        return false;
 
-    return sorted;
+    // Nodes of every component, in the order of execution, stored one component after another.
+    std::unordered_map<uint32_t, uint32_t> componentIndex;
+    std::vector<uint32_t> offsets(components.size() + 1, 0);
+    for (uint32_t i = n; i-- > 0;) {
+        if (inTrunk[i] || isLeaf(i))
+            continue;
+        auto [it, inserted] = componentIndex.emplace(component[i], static_cast<uint32_t>(componentIndex.size()));
+        offsets[it->second + 1]++;
+    }
+    for (size_t c = 0; c < components.size(); ++c)
+        offsets[c + 1] += offsets[c];
+
+    std::vector<uint32_t> order(offsets.back());
+    std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+    std::vector<bool> serial(components.size(), false);
+    for (uint32_t i = n; i-- > 0;) {
+        if (inTrunk[i] || isLeaf(i))
+            continue;
+        uint32_t c = componentIndex[component[i]];
+        order[filled[c]++] = i;
+        if (sorted[i]->_recomputes)
+            serial[c] = true;
+    }
+
+    bool profiling = Profiler::isEnabled();
+    Profiler::OperationTimes trunkTimes;
+    for (uint32_t i = n; i-- > 0;)
+        if (inTrunk[i])
+            runBackward(sorted[i].get(), profiling ? &trunkTimes : nullptr);
+
+    auto runComponent = [&](size_t c, std::vector<ValuePtr<T>> *shadows, Profiler::OperationTimes *times) {
+        for (uint32_t k = offsets[c]; k < offsets[c + 1]; ++k) {
+            Value<T> *node = sorted[order[k]].get();
+            if (shadows != nullptr) {
+                for (ValuePtr<T> &child : node->_children) {
+                    if (!child->_children.empty())
+                        continue;
+
+                    ValuePtr<T> &shadow = (*shadows)[leafIndex[child->_position]];
+                    if (!shadow) {
+                        shadow = Value<T>::create(child->_data);
+                        shadow->_constant = child->_constant;
+                    }
+                    child = shadow;
+                }
+            }
+            runBackward(node, times);
+        }
+    };
+
+    size_t workers = std::min(backwardPool->size(), components.size());
+    std::vector<std::vector<ValuePtr<T>>> shadows(workers);
+    std::atomic<size_t> nextComponent = 0;
+
+    std::vector<Profiler::OperationTimes> workerTimes(profiling ? workers : 0);
+
+    backwardPool->run(workers, [&](size_t worker) {
+        shadows[worker].resize(leaves.size());
+        Profiler::OperationTimes *times = profiling ? &workerTimes[worker] : nullptr;
+
+        if (deterministicBackward) {
+            size_t begin = worker * components.size() / workers;
+            size_t end = (worker + 1) * components.size() / workers;
+            for (size_t c = begin; c < end; ++c)
+                if (!serial[c])
+                    runComponent(c, &shadows[worker], times);
+            return;
+        }
+
+        for (size_t c = nextComponent++; c < components.size(); c = nextComponent++)
+            if (!serial[c])
+                runComponent(c, &shadows[worker], times);
+    });
+
+    for (size_t worker = 0; worker < workers; ++worker)
+        for (size_t l = 0; l < leaves.size(); ++l)
+            if (shadows[worker][l])
+                leaves[l]->_gradient += shadows[worker][l]->_gradient;
+
+    // Checkpointed segments recompute their graphs with the real parameters, so they run on this thread.
+    for (size_t c = 0; c < components.size(); ++c)
+        if (serial[c])
+            runComponent(c, nullptr, profiling ? &trunkTimes : nullptr);
+
+    if (profiling) {
+        Profiler::addOperations(trunkTimes);
+        for (const Profiler::OperationTimes &times : workerTimes)
+            Profiler::addOperations(times);
+    }
+
+    return true;
 }
 
 template <typename T> void Value<T>::backward() {
-    _gradient = 1;
+    if (_tapeId != 0) {
+        Tape<T>::backward(this);
+        return;
+    }
+
+    Profiler::Span span("Value::backward", "Backward");
+
+    _gradient = LossScale::current();
     std::vector<ValuePtr<T>> sorted = topologicalSort();
 
-    for (auto val = sorted.rbegin(); val != sorted.rend(); val++) {
-        (*val)->_backward();
+    if (!parallelBackward(sorted)) {
+        if (Profiler::isEnabled()) {
+            Profiler::OperationTimes times;
+            for (auto val = sorted.rbegin(); val != sorted.rend(); val++)
+                runBackward(val->get(), &times);
+            Profiler::addOperations(times);
+        } else {
+            for (auto val = sorted.rbegin(); val != sorted.rend(); val++) {
+                (*val)->_backward();
+            }
+        }
     }
 
     for (auto s : sorted) {
-        s->_children = {};
+        s->_children.clear();
         s->_backward = []() {};
     }
 }
@@ -250,4 +1345,20 @@ template <typename T> std::ostream &operator<<(std::ostream &os, const ValuePtr<
     return os;
 }
 
+// Instantiated by the compiled library, see src/ShkyeraGrad.cpp.
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Value<Type::float32>;
+extern template class Value<Type::float64>;
+extern template ValuePtr<Type::float32> operator+(ValuePtr<Type::float32> a, ValuePtr<Type::float32> b);
+extern template ValuePtr<Type::float32> operator-(ValuePtr<Type::float32> a, ValuePtr<Type::float32> b);
+extern template ValuePtr<Type::float32> operator*(ValuePtr<Type::float32> a, ValuePtr<Type::float32> b);
+extern template ValuePtr<Type::float32> operator/(ValuePtr<Type::float32> a, ValuePtr<Type::float32> b);
+extern template ValuePtr<Type::float32> operator-(ValuePtr<Type::float32> a);
+extern template ValuePtr<Type::float64> operator+(ValuePtr<Type::float64> a, ValuePtr<Type::float64> b);
+extern template ValuePtr<Type::float64> operator-(ValuePtr<Type::float64> a, ValuePtr<Type::float64> b);
+extern template ValuePtr<Type::float64> operator*(ValuePtr<Type::float64> a, ValuePtr<Type::float64> b);
+extern template ValuePtr<Type::float64> operator/(ValuePtr<Type::float64> a, ValuePtr<Type::float64> b);
+extern template ValuePtr<Type::float64> operator-(ValuePtr<Type::float64> a);
+#endif
+
 } // namespace shkyera
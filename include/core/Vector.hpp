@@ -21,10 +21,28 @@ using Vec32 = Vector<Type::float32>;
 using Vec64 = Vector<Type::float64>;
 template <typename T> using Batch = std::vector<Vector<T>>;
 
+template <typename T> class Neuron;
+template <typename T> class Linear;
+template <typename T> class Sequential;
+template <typename T> class Conv2D;
+template <typename T> class MaxPool2D;
+template <typename T> class AvgPool2D;
+template <typename T> class BatchNorm1d;
+template <typename T> class LayerNorm;
+
 template <typename T> class Vector {
   private:
     std::vector<ValuePtr<T>> _values;
 
+    friend class Neuron<T>;
+    friend class Linear<T>;
+    friend class Sequential<T>;
+    friend class Conv2D<T>;
+    friend class MaxPool2D<T>;
+    friend class AvgPool2D<T>;
+    friend class BatchNorm1d<T>;
+    friend class LayerNorm<T>;
+
   public:
     Vector() = default;
     Vector(std::vector<ValuePtr<T>> values);
@@ -121,27 +139,18 @@ template <typename T> ValuePtr<T> Vector<T>::dot(const Vector<T> &other) const {
                                     std::to_string(size()) + " and " + std::to_string(other.size()) + ".");
     }
 
-    ValuePtr<T> result = Value<T>::create(0);
-    for (size_t i = 0; i < size(); ++i)
-        result = result + (_values[i] * other[i]);
-
-    return result;
+    return Value<T>::dot(_values, other._values);
 }
 
-template <typename T> ValuePtr<T> Vector<T>::sum() const {
-    auto sum = Value<T>::create(0);
-    for (const auto &entry : _values)
-        sum = sum + entry;
-    return sum;
-}
+template <typename T> ValuePtr<T> Vector<T>::sum() const { return Value<T>::sum(_values); }
 
 template <typename T> Vector<T> operator/(Vector<T> x, T val) {
-    x *= Value<T>::create(val);
+    x /= val;
     return x;
 }
 
 template <typename T> Vector<T> operator*(Vector<T> x, T val) {
-    x *= Value<T>::create(val);
+    x *= val;
     return x;
 }
 
@@ -160,16 +169,15 @@ template <typename T> Vector<T> operator*(Vector<T> x, ValuePtr<T> val) {
 }
 
 template <typename T> Vector<T> &Vector<T>::operator/=(T val) {
-    auto divisor = Value<T>::create(val);
+    auto divisor = Value<T>::constant(val);
     for (size_t i = 0; i < _values.size(); ++i)
         _values[i] = _values[i] / divisor;
     return *this;
 }
 
 template <typename T> Vector<T> &Vector<T>::operator*=(T val) {
-    auto divisor = Value<T>::create(val);
     for (size_t i = 0; i < _values.size(); ++i)
-        _values[i] = _values[i] * divisor;
+        _values[i] = _values[i] * val;
     return *this;
 }
 
@@ -220,4 +228,9 @@ template <typename T> bool Vector<T>::ConstIterator::operator!=(const ConstItera
     return _index != other._index;
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Vector<Type::float32>;
+extern template class Vector<Type::float64>;
+#endif
+
 } // namespace shkyera
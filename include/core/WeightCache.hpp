@@ -0,0 +1,84 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Type.hpp"
+
+namespace shkyera {
+
+template <typename T> class Value;
+
+/**
+ * Weights of Value::linear gathered from their Values into one contiguous matrix, with one row per output, and its
+ * transpose. Layers keep a cache across calls, which gathers the weights again only after an optimizer has updated
+ * parameters, since optimizers are the only ones writing to existing Values. The packed weights are never modified,
+ * so graphs built on older ones keep them for their backward pass.
+ */
+template <typename T> class WeightCache {
+  public:
+    struct Packed {
+        uint64_t version;
+        std::vector<Type::Accumulator<T>> weights;
+        std::vector<Type::Accumulator<T>> transposed;
+    };
+
+  private:
+    mutable std::shared_ptr<const Packed> _packed;
+
+    inline static std::atomic<uint64_t> _version = 0;
+
+  public:
+    std::shared_ptr<const Packed> get(const std::vector<std::shared_ptr<Value<T>>> &weights, size_t outputs) const;
+
+    static std::shared_ptr<const Packed> pack(const std::vector<std::shared_ptr<Value<T>>> &weights, size_t outputs,
+                                              bool transpose);
+    static void invalidate();
+};
+
+// The cache is swapped atomically, so that layers can run on several threads at once.
+template <typename T>
+std::shared_ptr<const typename WeightCache<T>::Packed>
+WeightCache<T>::get(const std::vector<std::shared_ptr<Value<T>>> &weights, size_t outputs) const {
+    std::shared_ptr<const Packed> packed = std::atomic_load(&_packed);
+    if (packed && packed->version == _version.load() && packed->weights.size() == weights.size())
+        return packed;
+
+    packed = pack(weights, outputs, true);
+    std::atomic_store(&_packed, packed);
+    return packed;
+}
+
+template <typename T>
+std::shared_ptr<const typename WeightCache<T>::Packed>
+WeightCache<T>::pack(const std::vector<std::shared_ptr<Value<T>>> &weights, size_t outputs, bool transpose) {
+    auto packed = std::make_shared<Packed>();
+    packed->version = _version.load();
+    packed->weights.resize(weights.size());
+    for (size_t i = 0; i < weights.size(); ++i)
+        packed->weights[i] = weights[i]->getValue();
+
+    if (transpose && outputs != 0) {
+        const size_t inputs = weights.size() / outputs;
+        packed->transposed.resize(weights.size());
+        for (size_t o = 0; o < outputs; ++o)
+            for (size_t i = 0; i < inputs; ++i)
+                packed->transposed[i * outputs + o] = packed->weights[o * inputs + i];
+    }
+
+    return packed;
+}
+
+// Called by optimizers before they update parameters, which makes every cache gather its weights again.
+template <typename T> void WeightCache<T>::invalidate() { _version++; }
+
+} // namespace shkyera
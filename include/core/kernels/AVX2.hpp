@@ -0,0 +1,96 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "Common.hpp"
+
+#ifdef SHKYERA_X86_KERNELS
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace shkyera::kernels::avx2 {
+
+// AVX2 with FMA, with registers of 256 bits.
+template <typename T> struct Traits;
+
+template <> struct Traits<float> {
+    using Register = __m256;
+    static constexpr size_t width = 8;
+
+    static Register zero() { return _mm256_setzero_ps(); }
+    static Register set(float value) { return _mm256_set1_ps(value); }
+    static Register load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, Register r) { _mm256_storeu_ps(p, r); }
+
+    static Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+    static Register sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+    static Register mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+    static Register div(Register a, Register b) { return _mm256_div_ps(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+    static Register max(Register a, Register b) { return _mm256_max_ps(a, b); }
+    static Register min(Register a, Register b) { return _mm256_min_ps(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm256_and_ps(_mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_GT_OQ), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        return _mm256_blendv_ps(value, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+    }
+
+    static Register exponent(Register shifted) {
+        __m256i bits = _mm256_add_epi32(_mm256_castps_si256(shifted), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 23));
+    }
+};
+
+template <> struct Traits<double> {
+    using Register = __m256d;
+    static constexpr size_t width = 4;
+
+    static Register zero() { return _mm256_setzero_pd(); }
+    static Register set(double value) { return _mm256_set1_pd(value); }
+    static Register load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, Register r) { _mm256_storeu_pd(p, r); }
+
+    static Register add(Register a, Register b) { return _mm256_add_pd(a, b); }
+    static Register sub(Register a, Register b) { return _mm256_sub_pd(a, b); }
+    static Register mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+    static Register div(Register a, Register b) { return _mm256_div_pd(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm256_fmadd_pd(a, b, c); }
+    static Register max(Register a, Register b) { return _mm256_max_pd(a, b); }
+    static Register min(Register a, Register b) { return _mm256_min_pd(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm256_and_pd(_mm256_cmp_pd(y, _mm256_setzero_pd(), _CMP_GT_OQ), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        return _mm256_blendv_pd(value, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+    }
+
+    static Register exponent(Register shifted) {
+        __m256i bits = _mm256_add_epi64(_mm256_castpd_si256(shifted), _mm256_set1_epi64x(1023));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+    }
+};
+
+#include "Generic.hpp"
+
+} // namespace shkyera::kernels::avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
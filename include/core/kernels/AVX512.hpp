@@ -0,0 +1,101 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "Common.hpp"
+
+#ifdef SHKYERA_X86_KERNELS
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+// The intrinsics leave the unused lanes of their results undefined, which GCC takes for uninitialized values.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace shkyera::kernels::avx512 {
+
+// AVX-512 Foundation, with registers of 512 bits.
+template <typename T> struct Traits;
+
+template <> struct Traits<float> {
+    using Register = __m512;
+    static constexpr size_t width = 16;
+
+    static Register zero() { return _mm512_setzero_ps(); }
+    static Register set(float value) { return _mm512_set1_ps(value); }
+    static Register load(const float *p) { return _mm512_loadu_ps(p); }
+    static void store(float *p, Register r) { _mm512_storeu_ps(p, r); }
+
+    static Register add(Register a, Register b) { return _mm512_add_ps(a, b); }
+    static Register sub(Register a, Register b) { return _mm512_sub_ps(a, b); }
+    static Register mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+    static Register div(Register a, Register b) { return _mm512_div_ps(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+    static Register max(Register a, Register b) { return _mm512_max_ps(a, b); }
+    static Register min(Register a, Register b) { return _mm512_min_ps(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(y, _mm512_setzero_ps(), _CMP_GT_OQ), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        return _mm512_mask_mov_ps(value, _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), x);
+    }
+
+    static Register exponent(Register shifted) {
+        __m512i bits = _mm512_add_epi32(_mm512_castps_si512(shifted), _mm512_set1_epi32(127));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(bits, 23));
+    }
+};
+
+template <> struct Traits<double> {
+    using Register = __m512d;
+    static constexpr size_t width = 8;
+
+    static Register zero() { return _mm512_setzero_pd(); }
+    static Register set(double value) { return _mm512_set1_pd(value); }
+    static Register load(const double *p) { return _mm512_loadu_pd(p); }
+    static void store(double *p, Register r) { _mm512_storeu_pd(p, r); }
+
+    static Register add(Register a, Register b) { return _mm512_add_pd(a, b); }
+    static Register sub(Register a, Register b) { return _mm512_sub_pd(a, b); }
+    static Register mul(Register a, Register b) { return _mm512_mul_pd(a, b); }
+    static Register div(Register a, Register b) { return _mm512_div_pd(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm512_fmadd_pd(a, b, c); }
+    static Register max(Register a, Register b) { return _mm512_max_pd(a, b); }
+    static Register min(Register a, Register b) { return _mm512_min_pd(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(y, _mm512_setzero_pd(), _CMP_GT_OQ), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        return _mm512_mask_mov_pd(value, _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), x);
+    }
+
+    static Register exponent(Register shifted) {
+        __m512i bits = _mm512_add_epi64(_mm512_castpd_si512(shifted), _mm512_set1_epi64(1023));
+        return _mm512_castsi512_pd(_mm512_slli_epi64(bits, 52));
+    }
+};
+
+#include "Generic.hpp"
+
+} // namespace shkyera::kernels::avx512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif
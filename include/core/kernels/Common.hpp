@@ -0,0 +1,52 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// The x86 kernels are compiled for their instruction sets with target attributes, so that a single binary can contain
+// all of them and pick one at runtime.
+#if !defined(SHKYERA_DISABLE_SIMD) && (defined(__GNUC__) || defined(__clang__)) &&                                     \
+    (defined(__x86_64__) || defined(__i386__))
+#define SHKYERA_X86_KERNELS
+#endif
+
+namespace shkyera::kernels {
+
+enum class Isa : uint8_t { Scalar, SSE, AVX2, AVX512 };
+
+inline constexpr size_t isaCount = static_cast<size_t>(Isa::AVX512) + 1;
+
+enum class Activation : uint8_t { ReLU, Sigmoid, Tanh, Exp };
+
+inline constexpr size_t activationCount = static_cast<size_t>(Activation::Exp) + 1;
+
+// Rows of the tile of the matrix product kernel. Its columns are two registers wide, at most two of AVX-512 floats.
+inline constexpr size_t tileRows = 6;
+inline constexpr size_t maxTileColumns = 32;
+
+// Kernels of an instruction set. Activations write y = f(x), and their derivatives add dy * f'(x) to dx, computed from
+// y = f(x) alone. The tile kernel adds the product of packed panels to a tile of tileRows x tileColumns, see Gemm.
+template <typename T> struct Table {
+    T (*dot)(const T *a, const T *b, size_t size);
+    void (*axpy)(T alpha, const T *x, T *y, size_t size);
+    T (*sum)(const T *x, size_t size);
+    size_t (*argMax)(const T *x, size_t size);
+    std::array<void (*)(const T *x, T *y, size_t size), activationCount> activate;
+    std::array<void (*)(const T *y, const T *dy, T *dx, size_t size), activationCount> derivative;
+    size_t tileColumns;
+    void (*tile)(size_t depth, const T *a, const T *b, size_t ldb, T *c, size_t ldc);
+};
+
+} // namespace shkyera::kernels
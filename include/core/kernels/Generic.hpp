@@ -0,0 +1,282 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+// Kernels written once against Traits<T>, which every instruction set defines for float and double: registers of
+// Traits<T>::width scalars and the operations on them. There is no include guard, because each instruction set
+// includes this file in its own namespace, where it is compiled for its own target.
+
+template <typename T> using Register = typename Traits<T>::Register;
+
+template <typename T> T reduceAdd(Register<T> r) {
+    T lanes[Traits<T>::width];
+    Traits<T>::store(lanes, r);
+
+    T total = 0;
+    for (T lane : lanes)
+        total += lane;
+    return total;
+}
+
+template <typename T> T reduceMax(Register<T> r) {
+    T lanes[Traits<T>::width];
+    Traits<T>::store(lanes, r);
+    return *std::max_element(lanes, lanes + Traits<T>::width);
+}
+
+template <typename T> T dot(const T *a, const T *b, size_t size) {
+    using V = Traits<T>;
+    constexpr size_t w = V::width;
+
+    // Independent accumulators hide the latency of the additions.
+    Register<T> acc0 = V::zero(), acc1 = V::zero(), acc2 = V::zero(), acc3 = V::zero();
+    size_t i = 0;
+    for (; i + 4 * w <= size; i += 4 * w) {
+        acc0 = V::fma(V::load(a + i), V::load(b + i), acc0);
+        acc1 = V::fma(V::load(a + i + w), V::load(b + i + w), acc1);
+        acc2 = V::fma(V::load(a + i + 2 * w), V::load(b + i + 2 * w), acc2);
+        acc3 = V::fma(V::load(a + i + 3 * w), V::load(b + i + 3 * w), acc3);
+    }
+    for (; i + w <= size; i += w)
+        acc0 = V::fma(V::load(a + i), V::load(b + i), acc0);
+
+    T total = reduceAdd<T>(V::add(V::add(acc0, acc1), V::add(acc2, acc3)));
+    for (; i < size; ++i)
+        total += a[i] * b[i];
+    return total;
+}
+
+template <typename T> void axpy(T alpha, const T *x, T *y, size_t size) {
+    using V = Traits<T>;
+
+    Register<T> a = V::set(alpha);
+    size_t i = 0;
+    for (; i + V::width <= size; i += V::width)
+        V::store(y + i, V::fma(a, V::load(x + i), V::load(y + i)));
+    for (; i < size; ++i)
+        y[i] += alpha * x[i];
+}
+
+template <typename T> T sum(const T *x, size_t size) {
+    using V = Traits<T>;
+    constexpr size_t w = V::width;
+
+    Register<T> acc0 = V::zero(), acc1 = V::zero(), acc2 = V::zero(), acc3 = V::zero();
+    size_t i = 0;
+    for (; i + 4 * w <= size; i += 4 * w) {
+        acc0 = V::add(acc0, V::load(x + i));
+        acc1 = V::add(acc1, V::load(x + i + w));
+        acc2 = V::add(acc2, V::load(x + i + 2 * w));
+        acc3 = V::add(acc3, V::load(x + i + 3 * w));
+    }
+    for (; i + w <= size; i += w)
+        acc0 = V::add(acc0, V::load(x + i));
+
+    T total = reduceAdd<T>(V::add(V::add(acc0, acc1), V::add(acc2, acc3)));
+    for (; i < size; ++i)
+        total += x[i];
+    return total;
+}
+
+// Index of the first largest element, like std::max_element.
+template <typename T> size_t argMax(const T *x, size_t size) {
+    using V = Traits<T>;
+    if (size == 0)
+        return 0;
+
+    T largest = x[0];
+    size_t i = 0;
+    if (size >= V::width) {
+        Register<T> m = V::load(x);
+        for (i = V::width; i + V::width <= size; i += V::width)
+            m = V::max(m, V::load(x + i));
+        largest = reduceMax<T>(m);
+    }
+    for (; i < size; ++i)
+        largest = std::max(largest, x[i]);
+
+    return std::find(x, x + size, largest) - x;
+}
+
+// Inputs of exp() are clamped to this range, just outside of the one where e^x is finite and not rounded to zero, so
+// that the results beyond it still overflow to infinity and underflow to zero.
+template <typename T> inline constexpr T expLowest = std::is_same_v<T, float> ? T(-104) : T(-746);
+template <typename T> inline constexpr T expHighest = std::is_same_v<T, float> ? T(89) : T(710);
+
+// Cephes: e^x = 2^n * e^r with |r| <= ln(2) / 2, where n is rounded by adding a large power of two, which leaves it in
+// the low bits of the mantissa, from where Traits<T>::exponent() moves it into the exponent. Like std::exp, results
+// overflow to infinity and go through the subnormals to zero, since 2^n is applied in two halves which stay normal.
+// NaNs are passed through.
+template <typename T> Register<T> exp(Register<T> x) {
+    using V = Traits<T>;
+    const Register<T> input = x;
+    x = V::min(V::max(x, V::set(expLowest<T>)), V::set(expHighest<T>));
+
+    if constexpr (std::is_same_v<T, float>) {
+        const float magic = 12582912.0f; // 1.5 * 2^23
+
+        Register<T> shifted = V::fma(x, V::set(1.44269504088896341f), V::set(magic));
+        Register<T> n = V::sub(shifted, V::set(magic));
+        Register<T> r = V::fma(n, V::set(-0.693359375f), x);
+        r = V::fma(n, V::set(2.12194440e-4f), r);
+
+        Register<T> p = V::set(1.9875691500e-4f);
+        p = V::fma(p, r, V::set(1.3981999507e-3f));
+        p = V::fma(p, r, V::set(8.3334519073e-3f));
+        p = V::fma(p, r, V::set(4.1665795894e-2f));
+        p = V::fma(p, r, V::set(1.6666665459e-1f));
+        p = V::fma(p, r, V::set(5.0000001201e-1f));
+        p = V::fma(p, V::mul(r, r), V::add(r, V::set(1)));
+
+        Register<T> half = V::fma(n, V::set(0.5f), V::set(magic));
+        Register<T> rest = V::add(V::sub(n, V::sub(half, V::set(magic))), V::set(magic));
+        return V::keepNaN(input, V::mul(V::mul(p, V::exponent(half)), V::exponent(rest)));
+    } else {
+        const double magic = 6755399441055744.0; // 1.5 * 2^52
+
+        Register<T> shifted = V::fma(x, V::set(1.4426950408889634074), V::set(magic));
+        Register<T> n = V::sub(shifted, V::set(magic));
+        Register<T> r = V::fma(n, V::set(-6.93145751953125e-1), x);
+        r = V::fma(n, V::set(-1.42860682030941723212e-6), r);
+        Register<T> rr = V::mul(r, r);
+
+        Register<T> p = V::set(1.26177193074810590878e-4);
+        p = V::fma(p, rr, V::set(3.02994407707441961300e-2));
+        p = V::mul(V::fma(p, rr, V::set(9.99999999999999999910e-1)), r);
+
+        Register<T> q = V::set(3.00198505138664455042e-6);
+        q = V::fma(q, rr, V::set(2.52448340349684104192e-3));
+        q = V::fma(q, rr, V::set(2.27265548208155028766e-1));
+        q = V::fma(q, rr, V::set(2.00000000000000000009e0));
+
+        Register<T> e = V::fma(V::set(2), V::div(p, V::sub(q, p)), V::set(1));
+
+        Register<T> half = V::fma(n, V::set(0.5), V::set(magic));
+        Register<T> rest = V::add(V::sub(n, V::sub(half, V::set(magic))), V::set(magic));
+        return V::keepNaN(input, V::mul(V::mul(e, V::exponent(half)), V::exponent(rest)));
+    }
+}
+
+template <Activation A, typename T> Register<T> activation(Register<T> x) {
+    using V = Traits<T>;
+    const Register<T> one = V::set(1);
+
+    if constexpr (A == Activation::ReLU) {
+        return V::max(x, V::zero());
+    } else if constexpr (A == Activation::Sigmoid) {
+        return V::div(one, V::add(one, exp<T>(V::sub(V::zero(), x))));
+    } else if constexpr (A == Activation::Tanh) {
+        // tanh(x) rounds to 1 in both types once |x| > 19, long before e^2x would overflow into infinity over infinity.
+        const Register<T> limit = V::set(44);
+        Register<T> e = exp<T>(V::min(V::max(V::add(x, x), V::sub(V::zero(), limit)), limit));
+        return V::keepNaN(x, V::div(V::sub(e, one), V::add(e, one)));
+    } else {
+        return exp<T>(x);
+    }
+}
+
+template <Activation A, typename T> Register<T> gradient(Register<T> y, Register<T> dy) {
+    using V = Traits<T>;
+    const Register<T> one = V::set(1);
+
+    if constexpr (A == Activation::ReLU)
+        return V::positive(y, dy);
+    else if constexpr (A == Activation::Sigmoid)
+        return V::mul(dy, V::mul(y, V::sub(one, y)));
+    else if constexpr (A == Activation::Tanh)
+        return V::mul(dy, V::sub(one, V::mul(y, y)));
+    else
+        return V::mul(dy, y);
+}
+
+// The elements after the last full register go through a padded one, so that all of them are computed the same way.
+template <Activation A, typename T> void activate(const T *x, T *y, size_t size) {
+    using V = Traits<T>;
+
+    size_t i = 0;
+    for (; i + V::width <= size; i += V::width)
+        V::store(y + i, activation<A, T>(V::load(x + i)));
+
+    if (i < size) {
+        T in[V::width] = {};
+        T out[V::width];
+        std::copy(x + i, x + size, in);
+        V::store(out, activation<A, T>(V::load(in)));
+        std::copy(out, out + (size - i), y + i);
+    }
+}
+
+template <Activation A, typename T> void derivative(const T *y, const T *dy, T *dx, size_t size) {
+    using V = Traits<T>;
+
+    size_t i = 0;
+    for (; i + V::width <= size; i += V::width)
+        V::store(dx + i, V::add(V::load(dx + i), gradient<A, T>(V::load(y + i), V::load(dy + i))));
+
+    if (i < size) {
+        T in[V::width] = {};
+        T inGradient[V::width] = {};
+        T out[V::width];
+        std::copy(y + i, y + size, in);
+        std::copy(dy + i, dy + size, inGradient);
+        V::store(out, gradient<A, T>(V::load(in), V::load(inGradient)));
+        for (size_t j = 0; j < size - i; ++j)
+            dx[i + j] += out[j];
+    }
+}
+
+// C += A * B for a tile of C with a leading dimension of ldc. A holds tileRows scalars for every step of the depth,
+// and B two registers, ldb apart. The accumulators are spelled out, so that they stay in registers at every
+// optimization level.
+template <typename T> void tile(size_t depth, const T *a, const T *b, size_t ldb, T *c, size_t ldc) {
+    using V = Traits<T>;
+    constexpr size_t w = V::width;
+    static_assert(tileRows == 6, "The tile kernel computes 6 rows.");
+
+    Register<T> c00 = V::zero(), c01 = V::zero(), c10 = V::zero(), c11 = V::zero(), c20 = V::zero(), c21 = V::zero();
+    Register<T> c30 = V::zero(), c31 = V::zero(), c40 = V::zero(), c41 = V::zero(), c50 = V::zero(), c51 = V::zero();
+
+    for (size_t p = 0; p < depth; ++p, a += tileRows, b += ldb) {
+        Register<T> b0 = V::load(b);
+        Register<T> b1 = V::load(b + w);
+        Register<T> ar = V::set(a[0]);
+        c00 = V::fma(ar, b0, c00);
+        c01 = V::fma(ar, b1, c01);
+        ar = V::set(a[1]);
+        c10 = V::fma(ar, b0, c10);
+        c11 = V::fma(ar, b1, c11);
+        ar = V::set(a[2]);
+        c20 = V::fma(ar, b0, c20);
+        c21 = V::fma(ar, b1, c21);
+        ar = V::set(a[3]);
+        c30 = V::fma(ar, b0, c30);
+        c31 = V::fma(ar, b1, c31);
+        ar = V::set(a[4]);
+        c40 = V::fma(ar, b0, c40);
+        c41 = V::fma(ar, b1, c41);
+        ar = V::set(a[5]);
+        c50 = V::fma(ar, b0, c50);
+        c51 = V::fma(ar, b1, c51);
+    }
+
+    const Register<T> tile[tileRows][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+    for (size_t r = 0; r < tileRows; ++r, c += ldc) {
+        V::store(c, V::add(V::load(c), tile[r][0]));
+        V::store(c + w, V::add(V::load(c + w), tile[r][1]));
+    }
+}
+
+template <typename T>
+inline const Table<T> table = {&dot<T>,
+                               &axpy<T>,
+                               &sum<T>,
+                               &argMax<T>,
+                               {&activate<Activation::ReLU, T>, &activate<Activation::Sigmoid, T>,
+                                &activate<Activation::Tanh, T>, &activate<Activation::Exp, T>},
+                               {&derivative<Activation::ReLU, T>, &derivative<Activation::Sigmoid, T>,
+                                &derivative<Activation::Tanh, T>, &derivative<Activation::Exp, T>},
+                               2 * Traits<T>::width,
+                               &tile<T>};
@@ -0,0 +1,98 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "Common.hpp"
+
+#ifdef SHKYERA_X86_KERNELS
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace shkyera::kernels::sse {
+
+// SSE2, which every x86-64 processor has, with registers of 128 bits.
+template <typename T> struct Traits;
+
+template <> struct Traits<float> {
+    using Register = __m128;
+    static constexpr size_t width = 4;
+
+    static Register zero() { return _mm_setzero_ps(); }
+    static Register set(float value) { return _mm_set1_ps(value); }
+    static Register load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Register r) { _mm_storeu_ps(p, r); }
+
+    static Register add(Register a, Register b) { return _mm_add_ps(a, b); }
+    static Register sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+    static Register mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+    static Register div(Register a, Register b) { return _mm_div_ps(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Register max(Register a, Register b) { return _mm_max_ps(a, b); }
+    static Register min(Register a, Register b) { return _mm_min_ps(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm_and_ps(_mm_cmpgt_ps(y, _mm_setzero_ps()), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        Register mask = _mm_cmpunord_ps(x, x);
+        return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, value));
+    }
+
+    static Register exponent(Register shifted) {
+        __m128i bits = _mm_add_epi32(_mm_castps_si128(shifted), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(bits, 23));
+    }
+};
+
+template <> struct Traits<double> {
+    using Register = __m128d;
+    static constexpr size_t width = 2;
+
+    static Register zero() { return _mm_setzero_pd(); }
+    static Register set(double value) { return _mm_set1_pd(value); }
+    static Register load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, Register r) { _mm_storeu_pd(p, r); }
+
+    static Register add(Register a, Register b) { return _mm_add_pd(a, b); }
+    static Register sub(Register a, Register b) { return _mm_sub_pd(a, b); }
+    static Register mul(Register a, Register b) { return _mm_mul_pd(a, b); }
+    static Register div(Register a, Register b) { return _mm_div_pd(a, b); }
+    static Register fma(Register a, Register b, Register c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static Register max(Register a, Register b) { return _mm_max_pd(a, b); }
+    static Register min(Register a, Register b) { return _mm_min_pd(a, b); }
+    static Register positive(Register y, Register value) {
+        return _mm_and_pd(_mm_cmpgt_pd(y, _mm_setzero_pd()), value);
+    }
+    static Register keepNaN(Register x, Register value) {
+        Register mask = _mm_cmpunord_pd(x, x);
+        return _mm_or_pd(_mm_and_pd(mask, x), _mm_andnot_pd(mask, value));
+    }
+
+    static Register exponent(Register shifted) {
+        __m128i bits = _mm_add_epi64(_mm_castpd_si128(shifted), _mm_set1_epi64x(1023));
+        return _mm_castsi128_pd(_mm_slli_epi64(bits, 52));
+    }
+};
+
+#include "Generic.hpp"
+
+} // namespace shkyera::kernels::sse
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
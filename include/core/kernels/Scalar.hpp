@@ -0,0 +1,49 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "Common.hpp"
+
+namespace shkyera::kernels::scalar {
+
+// Portable fallback, with registers of a single scalar.
+template <typename T> struct Traits {
+    using Register = T;
+    static constexpr size_t width = 1;
+
+    static T zero() { return 0; }
+    static T set(T value) { return value; }
+    static T load(const T *p) { return *p; }
+    static void store(T *p, T r) { *p = r; }
+
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T mul(T a, T b) { return a * b; }
+    static T div(T a, T b) { return a / b; }
+    static T fma(T a, T b, T c) { return a * b + c; }
+    static T max(T a, T b) { return a > b ? a : b; }
+    static T min(T a, T b) { return a < b ? a : b; }
+    static T positive(T y, T value) { return y > 0 ? value : 0; }
+    static T keepNaN(T x, T value) { return x != x ? x : value; }
+
+    static T exponent(T shifted) {
+        using Bits = std::conditional_t<std::is_same_v<T, float>, uint32_t, uint64_t>;
+        constexpr int mantissa = std::is_same_v<T, float> ? 23 : 52;
+        constexpr Bits bias = std::is_same_v<T, float> ? 127 : 1023;
+
+        Bits bits;
+        std::memcpy(&bits, &shifted, sizeof(T));
+        bits = (bits + bias) << mantissa;
+        std::memcpy(&shifted, &bits, sizeof(T));
+        return shifted;
+    }
+};
+
+#include "Generic.hpp"
+
+} // namespace shkyera::kernels::scalar
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include "../core/Expression.hpp"
+#include "../core/ModuleScope.hpp"
+#include "../core/Profiler.hpp"
+#include "../core/Tensor.hpp"
 #include "../core/Value.hpp"
 #include "../core/Vector.hpp"
 
@@ -17,6 +21,11 @@ template <typename T> using Function = std::function<ValuePtr<T>(Vector<T> a, Ve
 using Function32 = Function<Type::float32>;
 using Function64 = Function<Type::float64>;
 
+template <typename T> using TensorFunction = std::function<TensorPtr<T>(TensorPtr<T> a, TensorPtr<T> b)>;
+
+using TensorFunction32 = TensorFunction<Type::float32>;
+using TensorFunction64 = TensorFunction<Type::float64>;
+
 template <typename T>
 Function<T> MSE = [](Vector<T> a, Vector<T> b) {
     if (a.size() != b.size()) {
@@ -24,13 +33,15 @@ Function<T> MSE = [](Vector<T> a, Vector<T> b) {
                                     std::to_string(a.size()) + " and " + std::to_string(b.size()) + ".");
     }
 
-    ValuePtr<T> loss = Value<T>::create(0);
-    for (size_t i = 0; i < a.size(); ++i) {
-        loss = loss + ((a[i] - b[i])->pow(Value<T>::create(2)));
-    }
+    std::vector<ValuePtr<T>> differences;
+    differences.reserve(a.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        differences.push_back(a[i] - b[i]);
+
+    ValuePtr<T> loss = Value<T>::dot(differences, differences);
 
     if (a.size() > 0)
-        loss = loss / Value<T>::create(a.size());
+        loss = loss / Value<T>::constant(a.size());
 
     return loss;
 };
@@ -42,14 +53,15 @@ Function<T> MAE = [](Vector<T> a, Vector<T> b) {
                                     std::to_string(a.size()) + " and " + std::to_string(b.size()) + ".");
     }
 
-    ValuePtr<T> loss = Value<T>::create(0);
-    for (size_t i = 0; i < a.size(); ++i) {
-        ValuePtr<T> difference = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
-        loss = loss + difference;
-    }
+    std::vector<ValuePtr<T>> differences;
+    differences.reserve(a.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        differences.push_back((expr::lift(a[i]) - b[i])->abs());
+
+    ValuePtr<T> loss = Value<T>::sum(differences);
 
     if (a.size() > 0)
-        loss = loss / Value<T>::create(a.size());
+        loss = loss / Value<T>::constant(a.size());
 
     return loss;
 };
@@ -62,44 +74,155 @@ Function<T> CrossEntropy = [](Vector<T> a, Vector<T> b) {
             std::to_string(a.size()) + " and " + std::to_string(b.size()) + ".");
     }
 
-    auto aSum = a.sum();
-    auto bSum = b.sum();
+    T aSum = 0;
+    T bSum = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        aSum += a[i]->getValue();
+        bSum += b[i]->getValue();
+    }
 
-    if (aSum->getValue() < 0.99 || aSum->getValue() > 1.01 || aSum->getValue() < 0.99 || aSum->getValue() > 1.01) {
+    if (aSum < 0.99 || aSum > 1.01 || bSum < 0.99 || bSum > 1.01) {
         throw std::invalid_argument("To compute Cross Entropy Loss, both elements of each vector need to sum to 1(+/- "
                                     "0.01). Currently, they sum to:" +
-                                    std::to_string(aSum->getValue()) + " and " + std::to_string(bSum->getValue()) +
-                                    ".");
+                                    std::to_string(aSum) + " and " + std::to_string(bSum) + ".");
     }
-    auto eps = Value<T>::create(1e-8);
-    auto loss = Value<T>::create(0);
+    auto eps = Value<T>::constant(1e-8);
+
+    std::vector<ValuePtr<T>> targets;
+    std::vector<ValuePtr<T>> logarithms;
+    targets.reserve(a.size());
+    logarithms.reserve(a.size());
     for (size_t i = 0; i < a.size(); ++i) {
-        if (a[i] < eps)
-            loss = loss - (b[i] * (eps->log()));
-        else
-            loss = loss - (b[i] * (a[i]->log()));
+        targets.push_back(b[i]);
+        logarithms.push_back(Value<T>::max({a[i], eps})->log());
     }
 
-    return loss;
+    return -Value<T>::dot(targets, logarithms);
+};
+
+// Takes the logits, i.e. the outputs of a network without a final Softmax layer, and builds a single node for the loss
+// instead of the Softmax and the Cross Entropy. No clamping is needed, as the log-sum-exp is computed stably.
+template <typename T>
+Function<T> SoftmaxCrossEntropy = [](Vector<T> a, Vector<T> b) {
+    if (a.size() != b.size()) {
+        throw std::invalid_argument(
+            "Vectors need to be of the same size to compute the Cross Entropy loss. Sizes are " +
+            std::to_string(a.size()) + " and " + std::to_string(b.size()) + ".");
+    }
+
+    std::vector<ValuePtr<T>> logits;
+    std::vector<ValuePtr<T>> targets;
+    logits.reserve(a.size());
+    targets.reserve(b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        logits.push_back(a[i]);
+        targets.push_back(b[i]);
+    }
+
+    return Value<T>::softmaxCrossEntropy(logits, targets);
+};
+
+template <typename T>
+TensorFunction<T> TensorMSE = [](TensorPtr<T> a, TensorPtr<T> b) { return (a - b)->pow(2)->mean(); };
+
+template <typename T>
+TensorFunction<T> TensorMAE = [](TensorPtr<T> a, TensorPtr<T> b) { return (a - b)->abs()->mean(); };
+
+template <typename T>
+TensorFunction<T> TensorCrossEntropy = [](TensorPtr<T> a, TensorPtr<T> b) {
+    size_t samples = a->shape().size() > 1 ? a->size() / a->shape().back() : 1;
+    auto clamped = a->clamp(static_cast<T>(1e-8), std::numeric_limits<T>::max());
+
+    return (b * clamped->log())->sum() * static_cast<T>(-1.0 / samples);
 };
 
+template <typename T>
+TensorFunction<T> TensorSoftmaxCrossEntropy = [](TensorPtr<T> a, TensorPtr<T> b) { return a->softmaxCrossEntropy(b); };
+
+namespace detail {
+inline uint16_t lossModule() {
+    static const uint16_t module = ModuleScope::intern("Loss");
+    return module;
+}
+} // namespace detail
+
+// Builds the loss without calling backward() on it, e.g. to time the backward pass on its own or to inspect the graph.
+template <typename T>
+ValuePtr<T> evaluate(Function<T> lossFunction, const Vector<T> prediction, const Vector<T> target) {
+    Profiler::Span span("Loss::evaluate", "Loss");
+    ModuleScope scope(detail::lossModule());
+    return lossFunction(prediction, target);
+}
+
+template <typename T> ValuePtr<T> evaluate(Function<T> lossFunction, const Batch<T> prediction, const Batch<T> target) {
+    Profiler::Span span("Loss::evaluate", "Loss");
+    ModuleScope scope(detail::lossModule());
+    std::vector<ValuePtr<T>> losses;
+    losses.reserve(prediction.size());
+    for (size_t i = 0; i < prediction.size(); ++i)
+        losses.push_back(lossFunction(prediction[i], target[i]));
+
+    return Value<T>::sum(losses) / Value<T>::constant(prediction.size());
+}
+
+template <typename T>
+TensorPtr<T> evaluate(TensorFunction<T> lossFunction, const TensorPtr<T> prediction, const TensorPtr<T> target) {
+    Profiler::Span span("Loss::evaluate", "Loss");
+    return lossFunction(prediction, target);
+}
+
 template <typename T>
 ValuePtr<T> compute(Function<T> lossFunction, const Vector<T> prediction, const Vector<T> target) {
-    auto loss = lossFunction(prediction, target);
+    Profiler::Span span("Loss::compute", "Loss");
+    ValuePtr<T> loss = evaluate(lossFunction, prediction, target);
     loss->backward();
     return loss;
 }
 
 template <typename T> ValuePtr<T> compute(Function<T> lossFunction, const Batch<T> prediction, const Batch<T> target) {
-    ValuePtr<T> loss = Value<T>::create(0);
-    for (size_t i = 0; i < prediction.size(); ++i) {
-        loss = loss + lossFunction(prediction[i], target[i]);
-    }
-    loss = loss / Value<T>::create(prediction.size());
-
+    Profiler::Span span("Loss::compute", "Loss");
+    ValuePtr<T> loss = evaluate(lossFunction, prediction, target);
     loss->backward();
+    return loss;
+}
 
+template <typename T>
+TensorPtr<T> compute(TensorFunction<T> lossFunction, const TensorPtr<T> prediction, const TensorPtr<T> target) {
+    Profiler::Span span("Loss::compute", "Loss");
+    TensorPtr<T> loss = evaluate(lossFunction, prediction, target);
+    loss->backward();
     return loss;
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template Function<Type::float32> MSE<Type::float32>;
+extern template Function<Type::float32> MAE<Type::float32>;
+extern template Function<Type::float32> CrossEntropy<Type::float32>;
+extern template Function<Type::float32> SoftmaxCrossEntropy<Type::float32>;
+extern template TensorFunction<Type::float32> TensorMSE<Type::float32>;
+extern template TensorFunction<Type::float32> TensorMAE<Type::float32>;
+extern template TensorFunction<Type::float32> TensorCrossEntropy<Type::float32>;
+extern template TensorFunction<Type::float32> TensorSoftmaxCrossEntropy<Type::float32>;
+extern template ValuePtr<Type::float32> compute(Function<Type::float32>, const Vector<Type::float32>, const Vector<Type::float32>);
+extern template ValuePtr<Type::float32> compute(Function<Type::float32>, const Batch<Type::float32>, const Batch<Type::float32>);
+extern template TensorPtr<Type::float32> compute(TensorFunction<Type::float32>, const TensorPtr<Type::float32>, const TensorPtr<Type::float32>);
+extern template ValuePtr<Type::float32> evaluate(Function<Type::float32>, const Vector<Type::float32>, const Vector<Type::float32>);
+extern template ValuePtr<Type::float32> evaluate(Function<Type::float32>, const Batch<Type::float32>, const Batch<Type::float32>);
+extern template TensorPtr<Type::float32> evaluate(TensorFunction<Type::float32>, const TensorPtr<Type::float32>, const TensorPtr<Type::float32>);
+extern template Function<Type::float64> MSE<Type::float64>;
+extern template Function<Type::float64> MAE<Type::float64>;
+extern template Function<Type::float64> CrossEntropy<Type::float64>;
+extern template Function<Type::float64> SoftmaxCrossEntropy<Type::float64>;
+extern template TensorFunction<Type::float64> TensorMSE<Type::float64>;
+extern template TensorFunction<Type::float64> TensorMAE<Type::float64>;
+extern template TensorFunction<Type::float64> TensorCrossEntropy<Type::float64>;
+extern template TensorFunction<Type::float64> TensorSoftmaxCrossEntropy<Type::float64>;
+extern template ValuePtr<Type::float64> compute(Function<Type::float64>, const Vector<Type::float64>, const Vector<Type::float64>);
+extern template ValuePtr<Type::float64> compute(Function<Type::float64>, const Batch<Type::float64>, const Batch<Type::float64>);
+extern template TensorPtr<Type::float64> compute(TensorFunction<Type::float64>, const TensorPtr<Type::float64>, const TensorPtr<Type::float64>);
+extern template ValuePtr<Type::float64> evaluate(Function<Type::float64>, const Vector<Type::float64>, const Vector<Type::float64>);
+extern template ValuePtr<Type::float64> evaluate(Function<Type::float64>, const Batch<Type::float64>, const Batch<Type::float64>);
+extern template TensorPtr<Type::float64> evaluate(TensorFunction<Type::float64>, const TensorPtr<Type::float64>, const TensorPtr<Type::float64>);
+#endif
+
 } // namespace shkyera::Loss
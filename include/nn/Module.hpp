@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "../core/Tensor.hpp"
 #include "../core/Vector.hpp"
 
 namespace shkyera {
@@ -22,8 +23,9 @@ template <typename T> class Module {
     template <typename U> U forward(const U &x) const { return (*this)(x); }
 
     virtual Vector<T> operator()(const Vector<T> &x) const { return x; }
-    std::vector<Vector<T>> operator()(const std::vector<Vector<T>> &x) const {
-        std::vector<Vector<T>> out(x.size());
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const { return x; }
+    virtual Batch<T> operator()(const Batch<T> &x) const {
+        Batch<T> out(x.size());
         for (size_t i = 0; i < x.size(); ++i) {
             out[i] = this->operator()(x[i]);
         }
@@ -39,7 +39,12 @@ template <typename T> Neuron<T>::Neuron(size_t input) {
 }
 
 template <typename T> Vector<T> Neuron<T>::operator()(const Vector<T> &x) const {
-    return Vector<T>({_bias + _weights.dot(x)});
+    if (x.size() != _weights.size()) {
+        throw std::invalid_argument("Neuron with " + std::to_string(_weights.size()) +
+                                    " inputs cannot be applied to a Vector of size " + std::to_string(x.size()) + ".");
+    }
+
+    return Vector<T>({Value<T>::affine(_weights._values, x._values, _bias)});
 }
 
 template <typename T> std::vector<ValuePtr<T>> Neuron<T>::parameters() const {
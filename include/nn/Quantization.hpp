@@ -0,0 +1,140 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../core/NoGradGuard.hpp"
+#include "../core/Vector.hpp"
+#include "Sequential.hpp"
+#include "activation/ReLU.hpp"
+#include "activation/Sigmoid.hpp"
+#include "data/Dataset.hpp"
+#include "layers/Linear.hpp"
+#include "layers/QuantizedLinear.hpp"
+
+namespace shkyera::Quantization {
+
+template <typename T> using Samples = Dataset<Vector<T>, Vector<T>>;
+
+struct Report {
+    double floatAccuracy = 0;
+    double quantizedAccuracy = 0;
+    double accuracyDelta = 0;
+    double maxOutputError = 0;
+    size_t floatWeightBytes = 0;
+    size_t quantizedWeightBytes = 0;
+};
+
+namespace detail {
+
+// Runs the layers without building a graph. Linear layers, including Dropout, are applied without dropping any input,
+// and observe(layer, input) is called before each of them.
+template <typename T, typename F>
+Vector<T> inferenceForward(const std::vector<ModulePtr<T>> &layers, Vector<T> x, F observe) {
+    NoGradGuard guard;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        if (auto linear = std::dynamic_pointer_cast<Linear<T>>(layers[l])) {
+            observe(l, x);
+            x = linear->Linear<T>::operator()(x);
+        } else {
+            x = layers[l]->forward(x);
+        }
+    }
+    return x;
+}
+
+} // namespace detail
+
+// Replaces every Linear layer of the model by a QuantizedLinear, whose input range is taken from running the model
+// on the calibration samples. A ReLU or Sigmoid right after a Linear layer is fused into it.
+template <typename T> SequentialPtr<T> quantize(const SequentialPtr<T> &model, const Samples<T> &calibration) {
+    if (calibration.size() == 0) {
+        throw std::invalid_argument("Cannot calibrate the quantization of a model on an empty dataset.");
+    }
+
+    const std::vector<ModulePtr<T>> &layers = model->getLayers();
+    std::vector<T> low(layers.size(), std::numeric_limits<T>::max());
+    std::vector<T> high(layers.size(), std::numeric_limits<T>::lowest());
+
+    for (const auto &[x, y] : calibration) {
+        detail::inferenceForward(layers, x, [&](size_t l, const Vector<T> &input) {
+            for (const ValuePtr<T> &val : input) {
+                low[l] = std::min(low[l], val->getValue());
+                high[l] = std::max(high[l], val->getValue());
+            }
+        });
+    }
+
+    std::vector<ModulePtr<T>> quantized;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        auto linear = std::dynamic_pointer_cast<Linear<T>>(layers[l]);
+        if (!linear) {
+            quantized.push_back(layers[l]);
+            continue;
+        }
+
+        using Activation = typename QuantizedLinear<T>::Activation;
+        Activation activation = Activation::None;
+        if (l + 1 < layers.size() && std::dynamic_pointer_cast<ReLU<T>>(layers[l + 1]))
+            activation = Activation::ReLU;
+        else if (l + 1 < layers.size() && std::dynamic_pointer_cast<Sigmoid<T>>(layers[l + 1]))
+            activation = Activation::Sigmoid;
+
+        quantized.push_back(QuantizedLinear<T>::create(*linear, low[l], high[l], activation));
+        if (activation != Activation::None)
+            ++l;
+    }
+
+    return Sequential<T>::create(quantized);
+}
+
+// Accuracy is the fraction of samples whose largest output matches the largest entry of the target.
+template <typename T>
+Report compare(const SequentialPtr<T> &original, const SequentialPtr<T> &quantized, const Samples<T> &samples) {
+    Report report;
+
+    size_t floatCorrect = 0;
+    size_t quantizedCorrect = 0;
+    for (const auto &[x, y] : samples) {
+        Vector<T> expected = detail::inferenceForward(original->getLayers(), x, [](size_t, const Vector<T> &) {});
+
+        Vector<T> actual;
+        {
+            NoGradGuard guard;
+            actual = quantized->forward(x);
+        }
+
+        floatCorrect += expected.argMax() == y.argMax();
+        quantizedCorrect += actual.argMax() == y.argMax();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            double error = std::abs(static_cast<double>(expected[i]->getValue() - actual[i]->getValue()));
+            report.maxOutputError = std::max(report.maxOutputError, error);
+        }
+    }
+
+    if (samples.size() > 0) {
+        report.floatAccuracy = static_cast<double>(floatCorrect) / samples.size();
+        report.quantizedAccuracy = static_cast<double>(quantizedCorrect) / samples.size();
+    }
+    report.accuracyDelta = report.quantizedAccuracy - report.floatAccuracy;
+
+    report.floatWeightBytes = original->parameters().size() * sizeof(T);
+    for (const ModulePtr<T> &layer : quantized->getLayers()) {
+        if (auto linear = std::dynamic_pointer_cast<QuantizedLinear<T>>(layer))
+            report.quantizedWeightBytes += linear->weightBytes();
+        else
+            report.quantizedWeightBytes += layer->parameters().size() * sizeof(T);
+    }
+
+    return report;
+}
+
+} // namespace shkyera::Quantization
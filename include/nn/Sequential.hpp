@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+
+#include "../core/ModuleScope.hpp"
+#include "../core/Profiler.hpp"
 #include "../core/Type.hpp"
 #include "Module.hpp"
 
@@ -21,22 +25,44 @@ using Sequential64 = Sequential<Type::float64>;
 using SequentialBuilder32 = SequentialBuilder<Type::float32>;
 using SequentialBuilder64 = SequentialBuilder<Type::float64>;
 
+/**
+ * Layers can be grouped into checkpointed segments, given by the indices of the layers that end them. The graph of such
+ * a segment is not kept after the forward pass, but recomputed during backward(), which trades compute for memory. The
+ * layers after the last boundary are run as usual.
+ *
+ * Layers are named after their Sequential and their index, e.g. "Sequential 0/1: ReLU", so that the layers of different
+ * Sequentials are told apart by the profiler and the graph inspection.
+ */
 template <typename T> class Sequential : public Module<T> {
   private:
     std::vector<ModulePtr<T>> _layers;
+    std::vector<size_t> _checkpoints;
+    std::vector<std::string> _names;
+    std::vector<uint16_t> _modules;
+
+    inline static std::atomic<size_t> _instances = 0;
 
-    Sequential(const std::vector<ModulePtr<T>> &layers);
+    Sequential(const std::vector<ModulePtr<T>> &layers, const std::vector<size_t> &checkpoints);
+
+    template <typename U> U forwardLayers(U x, size_t begin, size_t end) const;
 
   public:
-    static SequentialPtr<T> create(const std::vector<ModulePtr<T>> &layers);
+    static SequentialPtr<T> create(const std::vector<ModulePtr<T>> &layers,
+                                   const std::vector<size_t> &checkpoints = {});
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
     virtual std::vector<ValuePtr<T>> parameters() const override;
+
+    const std::vector<ModulePtr<T>> &getLayers() const;
 };
 
 template <typename T> class SequentialBuilder {
   private:
     std::vector<ModulePtr<T>> _layers;
+    std::vector<size_t> _checkpoints;
+    size_t _checkpointEvery = 0;
 
     SequentialBuilder() = default;
 
@@ -44,19 +70,97 @@ template <typename T> class SequentialBuilder {
     static SequentialBuilder<T> begin();
 
     SequentialBuilder<T> add(ModulePtr<T> layer);
+    SequentialBuilder<T> checkpoint();
+    SequentialBuilder<T> checkpointEvery(size_t layers);
     SequentialPtr<T> build();
 };
 
-template <typename T> Sequential<T>::Sequential(const std::vector<ModulePtr<T>> &layers) : _layers(layers) {}
+template <typename T>
+Sequential<T>::Sequential(const std::vector<ModulePtr<T>> &layers, const std::vector<size_t> &checkpoints)
+    : _layers(layers), _checkpoints(checkpoints) {
+    const std::string prefix = "Sequential " + std::to_string(_instances++) + "/";
+    for (size_t i = 0; i < _layers.size(); ++i)
+        _names.push_back(prefix + std::to_string(i) + ": " + Profiler::moduleName(*_layers[i]));
+    for (const std::string &name : _names)
+        _modules.push_back(ModuleScope::intern(name));
+
+    for (size_t i = 0; i < _checkpoints.size(); ++i) {
+        if (_checkpoints[i] == 0 || _checkpoints[i] > _layers.size() || (i > 0 && _checkpoints[i] <= _checkpoints[i - 1]))
+            throw std::invalid_argument("Checkpoints need to be increasing layer indices in the range [1, " +
+                                        std::to_string(_layers.size()) + "]. One of them is " +
+                                        std::to_string(_checkpoints[i]) + ".");
+    }
+}
+
+template <typename T>
+SequentialPtr<T> Sequential<T>::create(const std::vector<ModulePtr<T>> &layers, const std::vector<size_t> &checkpoints) {
+    return std::shared_ptr<Sequential<T>>(new Sequential<T>(layers, checkpoints));
+}
 
-template <typename T> SequentialPtr<T> Sequential<T>::create(const std::vector<ModulePtr<T>> &layers) {
-    return std::shared_ptr<Sequential<T>>(new Sequential<T>(layers));
+template <typename T> template <typename U> U Sequential<T>::forwardLayers(U x, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        Profiler::Span span(_names[i].c_str(), "Module");
+        ModuleScope scope(_modules[i]);
+        x = _layers[i]->forward(x);
+    }
+    return x;
 }
 
 template <typename T> Vector<T> Sequential<T>::operator()(const Vector<T> &x) const {
-    Vector<T> out = (*_layers[0])(x);
+    Vector<T> out = x;
+    size_t begin = 0;
+
+    for (size_t end : _checkpoints) {
+        auto segment = [this, begin, end](const std::vector<ValuePtr<T>> &inputs) {
+            return forwardLayers(Vector<T>(inputs), begin, end)._values;
+        };
+        out = Vector<T>(Value<T>::checkpoint(out._values, segment));
+        begin = end;
+    }
 
-    std::for_each(_layers.begin() + 1, _layers.end(), [&out](ModulePtr<T> layer) { out = layer->forward(out); });
+    return forwardLayers(out, begin, _layers.size());
+}
+
+// Checkpointed segments see the whole batch as one list of Values, which they split back into samples.
+template <typename T> Batch<T> Sequential<T>::operator()(const Batch<T> &x) const {
+    auto flatten = [](const Batch<T> &batch) {
+        std::vector<ValuePtr<T>> values;
+        for (const Vector<T> &sample : batch)
+            values.insert(values.end(), sample._values.begin(), sample._values.end());
+        return values;
+    };
+    auto split = [](const std::vector<ValuePtr<T>> &values, size_t samples) {
+        Batch<T> batch(samples);
+        size_t width = samples == 0 ? 0 : values.size() / samples;
+        for (size_t i = 0; i < samples; ++i) {
+            auto first = values.begin() + i * width;
+            batch[i] = Vector<T>(std::vector<ValuePtr<T>>(first, first + width));
+        }
+        return batch;
+    };
+
+    Batch<T> out = x;
+    size_t begin = 0;
+
+    for (size_t end : _checkpoints) {
+        size_t samples = out.size();
+        auto segment = [this, begin, end, samples, flatten, split](const std::vector<ValuePtr<T>> &inputs) {
+            return flatten(forwardLayers(split(inputs, samples), begin, end));
+        };
+        out = split(Value<T>::checkpoint(flatten(out), segment), samples);
+        begin = end;
+    }
+
+    return forwardLayers(out, begin, _layers.size());
+}
+
+template <typename T> TensorPtr<T> Sequential<T>::operator()(const TensorPtr<T> &x) const {
+    TensorPtr<T> out = x;
+
+    for (size_t i = 0; i < _layers.size(); ++i) {
+        Profiler::Span span(_names[i].c_str(), "Module");
+        out = _layers[i]->forward(out);
+    }
 
     return out;
 }
@@ -72,11 +176,30 @@ template <typename T> std::vector<ValuePtr<T>> Sequential<T>::parameters() const
     return params;
 }
 
+template <typename T> const std::vector<ModulePtr<T>> &Sequential<T>::getLayers() const { return _layers; }
+
 template <typename T> SequentialBuilder<T> SequentialBuilder<T>::begin() { return SequentialBuilder<T>(); }
 template <typename T> SequentialBuilder<T> SequentialBuilder<T>::add(ModulePtr<T> layer) {
     _layers.push_back(layer);
     return *this;
 }
-template <typename T> SequentialPtr<T> SequentialBuilder<T>::build() { return Sequential<T>::create(_layers); }
+template <typename T> SequentialBuilder<T> SequentialBuilder<T>::checkpoint() {
+    if (!_layers.empty() && (_checkpoints.empty() || _checkpoints.back() != _layers.size()))
+        _checkpoints.push_back(_layers.size());
+    return *this;
+}
+template <typename T> SequentialBuilder<T> SequentialBuilder<T>::checkpointEvery(size_t layers) {
+    _checkpointEvery = layers;
+    return *this;
+}
+template <typename T> SequentialPtr<T> SequentialBuilder<T>::build() {
+    std::vector<size_t> checkpoints = _checkpoints;
+    if (_checkpointEvery > 0) {
+        checkpoints.clear();
+        for (size_t end = _checkpointEvery; end < _layers.size(); end += _checkpointEvery)
+            checkpoints.push_back(end);
+    }
+    return Sequential<T>::create(_layers, checkpoints);
+}
 
 } // namespace shkyera
@@ -0,0 +1,354 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace shkyera {
+
+/**
+ * Throughput and latency of a training loop. The phases of every step are timed with Telemetry::measure(), or for the
+ * data loading, by iterating over Telemetry::track(loader), and finishStep() closes a step. Every reportInterval
+ * seconds, the samples per second, the percentiles of the latency of each phase and the fraction of the time spent
+ * waiting for data are appended to a JSON lines file and written to a Prometheus text file, if any were given.
+ *
+ * A job that spends most of its time waiting for data is input-bound, one that does not is compute-bound. Latencies are
+ * kept in histograms with four buckets per power of two, so percentiles are accurate to about 10%. A Telemetry is meant
+ * to be used from the thread of the training loop.
+ */
+class Telemetry {
+  public:
+    enum class Phase : uint8_t { Data, Forward, Loss, Backward, Step };
+    inline static constexpr size_t phaseCount = 5;
+
+    // Latencies in seconds.
+    struct Latency {
+        size_t count = 0;
+        double mean = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+    };
+
+    struct Report {
+        size_t steps = 0;
+        size_t samples = 0;
+        double seconds = 0;
+        double samplesPerSecond = 0;
+        double dataWaitFraction = 0;
+        std::array<Latency, phaseCount> phases;
+    };
+
+    class Timer {
+      private:
+        Telemetry &_telemetry;
+        Phase _phase;
+        std::chrono::steady_clock::time_point _start;
+
+      public:
+        Timer(Telemetry &telemetry, Phase phase);
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+    };
+
+    // Range over the batches of a loader, which times the loading of every batch as the Data phase.
+    template <typename L> class Tracked {
+      private:
+        Telemetry &_telemetry;
+        const L &_loader;
+
+      public:
+        class Iterator {
+          private:
+            Telemetry &_telemetry;
+            typename L::ConstIterator _iterator;
+
+          public:
+            Iterator(Telemetry &telemetry, typename L::ConstIterator iterator);
+
+            auto operator*();
+            Iterator &operator++();
+            bool operator!=(const Iterator &other);
+        };
+
+        Tracked(Telemetry &telemetry, const L &loader);
+
+        Iterator begin() const;
+        Iterator end() const;
+    };
+
+  private:
+    class Histogram {
+      private:
+        inline static constexpr size_t bucketCount = 256;
+
+        std::array<uint32_t, bucketCount> _buckets{};
+        size_t _count = 0;
+        double _sum = 0;
+
+      public:
+        void add(double seconds);
+        void clear();
+        size_t count() const;
+        double sum() const;
+        double percentile(double fraction) const;
+    };
+
+    std::array<Histogram, phaseCount> _window;
+    std::array<size_t, phaseCount> _totalCounts{};
+    std::array<double, phaseCount> _totalSeconds{};
+
+    size_t _steps = 0;
+    size_t _samples = 0;
+    size_t _windowSteps = 0;
+    size_t _windowSamples = 0;
+    std::chrono::steady_clock::time_point _windowStart;
+    std::chrono::steady_clock::time_point _lastStep;
+
+    double _reportInterval;
+    std::string _jsonLinesPath;
+    std::string _prometheusPath;
+
+    void writeJsonLine(const Report &report) const;
+    void writePrometheus(const Report &report) const;
+
+  public:
+    Telemetry(double reportInterval = 10);
+
+    static const char *phaseName(Phase phase);
+
+    void setJsonLinesFile(const std::string &path);
+    void setPrometheusFile(const std::string &path);
+
+    Timer measure(Phase phase);
+    void record(Phase phase, double seconds);
+    template <typename L> Tracked<L> track(const L &loader);
+
+    void finishStep(size_t samples);
+    Report report() const;
+    void flush();
+};
+
+inline Telemetry::Timer::Timer(Telemetry &telemetry, Phase phase)
+    : _telemetry(telemetry), _phase(phase), _start(std::chrono::steady_clock::now()) {}
+
+inline Telemetry::Timer::~Timer() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+    _telemetry.record(_phase, elapsed.count());
+}
+
+template <typename L>
+Telemetry::Tracked<L>::Iterator::Iterator(Telemetry &telemetry, typename L::ConstIterator iterator)
+    : _telemetry(telemetry), _iterator(iterator) {}
+
+template <typename L> auto Telemetry::Tracked<L>::Iterator::operator*() {
+    Timer timer(_telemetry, Phase::Data);
+    return *_iterator;
+}
+
+template <typename L> typename Telemetry::Tracked<L>::Iterator &Telemetry::Tracked<L>::Iterator::operator++() {
+    ++_iterator;
+    return *this;
+}
+
+template <typename L> bool Telemetry::Tracked<L>::Iterator::operator!=(const Iterator &other) {
+    return _iterator != other._iterator;
+}
+
+template <typename L>
+Telemetry::Tracked<L>::Tracked(Telemetry &telemetry, const L &loader) : _telemetry(telemetry), _loader(loader) {}
+
+// Shuffling happens when the iteration begins, so it counts as loading data too.
+template <typename L> typename Telemetry::Tracked<L>::Iterator Telemetry::Tracked<L>::begin() const {
+    Timer timer(_telemetry, Phase::Data);
+    return Iterator(_telemetry, _loader.begin());
+}
+
+template <typename L> typename Telemetry::Tracked<L>::Iterator Telemetry::Tracked<L>::end() const {
+    return Iterator(_telemetry, _loader.end());
+}
+
+// Bucket i holds the latencies in [2^(i/4), 2^((i+1)/4)) nanoseconds.
+inline void Telemetry::Histogram::add(double seconds) {
+    double nanoseconds = std::max(seconds * 1e9, 1.0);
+    size_t bucket = std::min<size_t>(static_cast<size_t>(4 * std::log2(nanoseconds)), bucketCount - 1);
+    _buckets[bucket]++;
+    _count++;
+    _sum += seconds;
+}
+
+inline void Telemetry::Histogram::clear() { *this = Histogram(); }
+
+inline size_t Telemetry::Histogram::count() const { return _count; }
+
+inline double Telemetry::Histogram::sum() const { return _sum; }
+
+inline double Telemetry::Histogram::percentile(double fraction) const {
+    if (_count == 0)
+        return 0;
+
+    size_t rank = static_cast<size_t>(std::ceil(fraction * _count));
+    size_t seen = 0;
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += _buckets[bucket];
+        if (seen >= std::max<size_t>(rank, 1))
+            return std::exp2((bucket + 0.5) / 4) / 1e9;
+    }
+    return std::exp2(bucketCount / 4.0) / 1e9;
+}
+
+inline Telemetry::Telemetry(double reportInterval)
+    : _windowStart(std::chrono::steady_clock::now()), _lastStep(_windowStart), _reportInterval(reportInterval) {}
+
+inline const char *Telemetry::phaseName(Phase phase) {
+    static const char *names[phaseCount] = {"data", "forward", "loss", "backward", "step"};
+    return names[static_cast<size_t>(phase)];
+}
+
+// Every report is appended as a line to the file.
+inline void Telemetry::setJsonLinesFile(const std::string &path) { _jsonLinesPath = path; }
+
+// The file is replaced with the latest report, so that a node exporter or a script can pick it up at any time.
+inline void Telemetry::setPrometheusFile(const std::string &path) { _prometheusPath = path; }
+
+inline Telemetry::Timer Telemetry::measure(Phase phase) { return Timer(*this, phase); }
+
+inline void Telemetry::record(Phase phase, double seconds) {
+    size_t p = static_cast<size_t>(phase);
+    _window[p].add(seconds);
+    _totalCounts[p]++;
+    _totalSeconds[p] += seconds;
+}
+
+template <typename L> Telemetry::Tracked<L> Telemetry::track(const L &loader) { return Tracked<L>(*this, loader); }
+
+inline void Telemetry::finishStep(size_t samples) {
+    _steps++;
+    _samples += samples;
+    _windowSteps++;
+    _windowSamples += samples;
+    _lastStep = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> elapsed = _lastStep - _windowStart;
+    if (elapsed.count() >= _reportInterval)
+        flush();
+}
+
+// Statistics of the steps finished since the last report.
+inline Telemetry::Report Telemetry::report() const {
+    Report report;
+    report.steps = _windowSteps;
+    report.samples = _windowSamples;
+    report.seconds = std::chrono::duration<double>(_lastStep - _windowStart).count();
+
+    if (report.seconds > 0) {
+        report.samplesPerSecond = report.samples / report.seconds;
+        report.dataWaitFraction = std::min(_window[static_cast<size_t>(Phase::Data)].sum() / report.seconds, 1.0);
+    }
+
+    for (size_t p = 0; p < phaseCount; ++p) {
+        const Histogram &histogram = _window[p];
+        Latency &latency = report.phases[p];
+        latency.count = histogram.count();
+        latency.mean = histogram.count() > 0 ? histogram.sum() / histogram.count() : 0;
+        latency.p50 = histogram.percentile(0.5);
+        latency.p95 = histogram.percentile(0.95);
+        latency.p99 = histogram.percentile(0.99);
+    }
+
+    return report;
+}
+
+// Writes the report of the current window and starts a new one. Nothing is written if no step finished since the
+// previous report.
+inline void Telemetry::flush() {
+    if (_windowSteps == 0)
+        return;
+
+    Report current = report();
+    if (!_jsonLinesPath.empty())
+        writeJsonLine(current);
+    if (!_prometheusPath.empty())
+        writePrometheus(current);
+
+    for (Histogram &histogram : _window)
+        histogram.clear();
+    _windowSteps = 0;
+    _windowSamples = 0;
+    _windowStart = _lastStep;
+}
+
+inline void Telemetry::writeJsonLine(const Report &report) const {
+    std::ofstream file(_jsonLinesPath, std::ios::app);
+    if (!file.is_open()) {
+        throw std::invalid_argument("Could not open the file " + _jsonLinesPath + " to write the telemetry.");
+    }
+
+    file << "{\"step\":" << _steps << ",\"steps\":" << report.steps << ",\"samples\":" << report.samples
+         << ",\"seconds\":" << report.seconds << ",\"samples_per_second\":" << report.samplesPerSecond
+         << ",\"data_wait_fraction\":" << report.dataWaitFraction << ",\"phases\":{";
+    for (size_t p = 0; p < phaseCount; ++p) {
+        const Latency &latency = report.phases[p];
+        file << (p > 0 ? "," : "") << "\"" << phaseName(static_cast<Phase>(p)) << "\":{\"count\":" << latency.count
+             << ",\"mean\":" << latency.mean << ",\"p50\":" << latency.p50 << ",\"p95\":" << latency.p95
+             << ",\"p99\":" << latency.p99 << "}";
+    }
+    file << "}}\n";
+}
+
+// Written to a temporary file first, so that readers never see a half-written one.
+inline void Telemetry::writePrometheus(const Report &report) const {
+    std::string temporary = _prometheusPath + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) {
+            throw std::invalid_argument("Could not open the file " + temporary + " to write the telemetry.");
+        }
+
+        file << "# HELP shkyera_training_steps_total Training steps finished.\n"
+             << "# TYPE shkyera_training_steps_total counter\n"
+             << "shkyera_training_steps_total " << _steps << "\n"
+             << "# HELP shkyera_training_samples_total Training samples processed.\n"
+             << "# TYPE shkyera_training_samples_total counter\n"
+             << "shkyera_training_samples_total " << _samples << "\n"
+             << "# HELP shkyera_training_samples_per_second Throughput since the previous report.\n"
+             << "# TYPE shkyera_training_samples_per_second gauge\n"
+             << "shkyera_training_samples_per_second " << report.samplesPerSecond << "\n"
+             << "# HELP shkyera_training_data_wait_ratio Fraction of the time spent waiting for data.\n"
+             << "# TYPE shkyera_training_data_wait_ratio gauge\n"
+             << "shkyera_training_data_wait_ratio " << report.dataWaitFraction << "\n"
+             << "# HELP shkyera_training_phase_seconds Latency of the phases of a training step.\n"
+             << "# TYPE shkyera_training_phase_seconds summary\n";
+
+        for (size_t p = 0; p < phaseCount; ++p) {
+            std::string phase = std::string("phase=\"") + phaseName(static_cast<Phase>(p)) + "\"";
+            const Latency &latency = report.phases[p];
+            file << "shkyera_training_phase_seconds{" << phase << ",quantile=\"0.5\"} " << latency.p50 << "\n"
+                 << "shkyera_training_phase_seconds{" << phase << ",quantile=\"0.95\"} " << latency.p95 << "\n"
+                 << "shkyera_training_phase_seconds{" << phase << ",quantile=\"0.99\"} " << latency.p99 << "\n"
+                 << "shkyera_training_phase_seconds_sum{" << phase << "} " << _totalSeconds[p] << "\n"
+                 << "shkyera_training_phase_seconds_count{" << phase << "} " << _totalCounts[p] << "\n";
+        }
+    }
+
+    if (std::rename(temporary.c_str(), _prometheusPath.c_str()) != 0) {
+        throw std::invalid_argument("Could not replace the file " + _prometheusPath + " with the telemetry.");
+    }
+}
+
+} // namespace shkyera
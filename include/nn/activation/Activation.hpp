@@ -20,6 +20,7 @@ template <typename T> class Activation : public Module<T> {
 
   public:
     virtual Vector<T> operator()(const Vector<T> &x) const override { return x; }
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override { return x; }
     virtual std::vector<ValuePtr<T>> parameters() const override { return {}; }
 };
 
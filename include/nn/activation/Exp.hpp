@@ -20,6 +20,7 @@ template <typename T> class Exp : public Activation<T> {
     static std::shared_ptr<Exp<T>> create();
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
 };
 
 template <typename T> std::shared_ptr<Exp<T>> Exp<T>::create() { return std::shared_ptr<Exp<T>>(new Exp<T>()); }
@@ -34,4 +35,6 @@ template <typename T> Vector<T> Exp<T>::operator()(const Vector<T> &x) const {
     return Vector<T>(out);
 }
 
+template <typename T> TensorPtr<T> Exp<T>::operator()(const TensorPtr<T> &x) const { return x->exp(); }
+
 } // namespace shkyera
@@ -20,6 +20,7 @@ template <typename T> class ReLU : public Activation<T> {
     static std::shared_ptr<ReLU<T>> create();
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
 };
 
 template <typename T> std::shared_ptr<ReLU<T>> ReLU<T>::create() { return std::shared_ptr<ReLU<T>>(new ReLU<T>()); }
@@ -34,4 +35,6 @@ template <typename T> Vector<T> ReLU<T>::operator()(const Vector<T> &x) const {
     return Vector<T>(out);
 }
 
+template <typename T> TensorPtr<T> ReLU<T>::operator()(const TensorPtr<T> &x) const { return x->relu(); }
+
 } // namespace shkyera
@@ -20,6 +20,7 @@ template <typename T> class Sigmoid : public Activation<T> {
     static std::shared_ptr<Sigmoid<T>> create();
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
 };
 
 template <typename T> std::shared_ptr<Sigmoid<T>> Sigmoid<T>::create() {
@@ -37,4 +38,6 @@ template <typename T> Vector<T> Sigmoid<T>::operator()(const Vector<T> &x) const
     return Vector<T>(out);
 }
 
+template <typename T> TensorPtr<T> Sigmoid<T>::operator()(const TensorPtr<T> &x) const { return x->sigmoid(); }
+
 } // namespace shkyera
@@ -20,6 +20,7 @@ template <typename T> class Softmax : public Activation<T> {
     static std::shared_ptr<Softmax<T>> create();
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
 };
 
 template <typename T> std::shared_ptr<Softmax<T>> Softmax<T>::create() {
@@ -27,24 +28,24 @@ template <typename T> std::shared_ptr<Softmax<T>> Softmax<T>::create() {
 }
 
 template <typename T> Vector<T> Softmax<T>::operator()(const Vector<T> &x) const {
+    std::vector<ValuePtr<T>> entries;
+    entries.reserve(x.size());
+    for (auto &entry : x)
+        entries.push_back(entry);
+
     std::vector<ValuePtr<T>> out;
     out.reserve(x.size());
 
-    auto maxValue = Value<T>::create(x[0]->getValue());
-    for (auto &entry : x)
-        if (entry > maxValue)
-            maxValue = entry;
-
-    auto sumExponentiated = Value<T>::create(0);
-    for (auto &entry : x) {
-        auto exponentiated = (entry - maxValue)->exp();
-        out.emplace_back(exponentiated);
-        sumExponentiated = sumExponentiated + exponentiated;
-    }
+    auto maxValue = Value<T>::max(entries);
+    for (auto &entry : entries)
+        out.emplace_back((entry - maxValue)->exp());
 
+    auto sumExponentiated = Value<T>::sum(out);
     auto vectorizedOut = Vector<T>(out) / sumExponentiated;
 
     return vectorizedOut;
 }
 
+template <typename T> TensorPtr<T> Softmax<T>::operator()(const TensorPtr<T> &x) const { return x->softmax(); }
+
 } // namespace shkyera
@@ -20,6 +20,7 @@ template <typename T> class Tanh : public Activation<T> {
     static std::shared_ptr<Tanh<T>> create();
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
 };
 
 template <typename T> std::shared_ptr<Tanh<T>> Tanh<T>::create() { return std::shared_ptr<Tanh<T>>(new Tanh<T>()); }
@@ -34,4 +35,6 @@ template <typename T> Vector<T> Tanh<T>::operator()(const Vector<T> &x) const {
     return Vector<T>(out);
 }
 
+template <typename T> TensorPtr<T> Tanh<T>::operator()(const TensorPtr<T> &x) const { return x->tanh(); }
+
 } // namespace shkyera
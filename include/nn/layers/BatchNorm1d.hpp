@@ -0,0 +1,223 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "../../core/Normalization.hpp"
+#include "../../core/RecomputeGuard.hpp"
+#include "../../core/StaticGraph.hpp"
+#include "../../core/Type.hpp"
+#include "../../core/Value.hpp"
+#include "../Module.hpp"
+#include "../Sequential.hpp"
+#include "Linear.hpp"
+
+namespace shkyera {
+
+template <typename T> class BatchNorm1d;
+template <typename T> using BatchNorm1dPtr = std::shared_ptr<BatchNorm1d<T>>;
+
+using BatchNorm1d32 = BatchNorm1d<Type::float32>;
+using BatchNorm1d64 = BatchNorm1d<Type::float64>;
+
+/**
+ * Batch normalization of every feature, y = gamma * (x - mean) / sqrt(variance + epsilon) + beta. During training, the
+ * mean and variance are taken over the samples of a Batch or the rows of a Tensor, and running averages of them are
+ * kept with the given momentum. In evaluation, the running statistics are used instead, which also works on single
+ * Vectors, and the layer can be folded into the Linear layer before it.
+ *
+ * The running statistics are updated once per forward pass: not again when Value::checkpoint recomputes the layer,
+ * and not by the replays of a StaticGraph, which is why the layer cannot be captured by one in training.
+ */
+template <typename T> class BatchNorm1d : public Module<T> {
+  protected:
+    size_t _size;
+    T _momentum;
+    T _epsilon;
+    bool _training = true;
+    std::vector<ValuePtr<T>> _weights;
+    std::vector<ValuePtr<T>> _biases;
+    mutable std::vector<T> _runningMean;
+    mutable std::vector<T> _runningVariance;
+
+    BatchNorm1d(size_t size, T momentum, T epsilon);
+
+    Normalization::Statistics<T> statistics(size_t samples) const;
+    void update(const Normalization::Statistics<T> &statistics, size_t samples) const;
+
+  public:
+    static BatchNorm1dPtr<T> create(size_t size, T momentum = 0.1, T epsilon = 1e-5);
+
+    void setTraining(bool training);
+    bool isTraining() const;
+    const std::vector<T> &getRunningMean() const;
+    const std::vector<T> &getRunningVariance() const;
+
+    LinearPtr<T> fold(const Linear<T> &linear) const;
+    static SequentialPtr<T> fold(const SequentialPtr<T> &model);
+
+    virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
+    virtual std::vector<ValuePtr<T>> parameters() const override;
+};
+
+template <typename T>
+BatchNorm1d<T>::BatchNorm1d(size_t size, T momentum, T epsilon)
+    : _size(size), _momentum(momentum), _epsilon(epsilon), _runningMean(size, 0), _runningVariance(size, 1) {
+    if (momentum < 0 || momentum > 1) {
+        throw std::invalid_argument("Momentum of BatchNorm1d must be in the range [0,1]. You set it to " +
+                                    std::to_string(momentum) + ".");
+    }
+
+    _weights.reserve(size);
+    _biases.reserve(size);
+    for (size_t f = 0; f < size; ++f) {
+        _weights.push_back(Value<T>::create(1));
+        _biases.push_back(Value<T>::create(0));
+    }
+}
+
+template <typename T> BatchNorm1dPtr<T> BatchNorm1d<T>::create(size_t size, T momentum, T epsilon) {
+    return std::shared_ptr<BatchNorm1d<T>>(new BatchNorm1d<T>(size, momentum, epsilon));
+}
+
+template <typename T> void BatchNorm1d<T>::setTraining(bool training) { _training = training; }
+
+template <typename T> bool BatchNorm1d<T>::isTraining() const { return _training; }
+
+template <typename T> const std::vector<T> &BatchNorm1d<T>::getRunningMean() const { return _runningMean; }
+
+template <typename T> const std::vector<T> &BatchNorm1d<T>::getRunningVariance() const { return _runningVariance; }
+
+// Statistics to be measured on a batch during training, or the running ones.
+template <typename T> Normalization::Statistics<T> BatchNorm1d<T>::statistics(size_t samples) const {
+    if (!_training)
+        return {_runningMean, _runningVariance, false};
+
+    if (StaticGraph<T>::isCapturing()) {
+        throw std::invalid_argument("BatchNorm1d cannot be captured by a StaticGraph in training, because its replays "
+                                    "would not update the running statistics. Call setTraining(false) first.");
+    }
+    if (samples < 2) {
+        throw std::invalid_argument("BatchNorm1d needs at least 2 samples in training, but got " +
+                                    std::to_string(samples) +
+                                    ". Pass a Batch or a Tensor, or call setTraining(false).");
+    }
+    return {};
+}
+
+// The running variance is the unbiased one.
+template <typename T>
+void BatchNorm1d<T>::update(const Normalization::Statistics<T> &statistics, size_t samples) const {
+    if (!statistics.measured || RecomputeGuard::isActive())
+        return;
+
+    const T correction = static_cast<T>(samples) / static_cast<T>(samples - 1);
+    for (size_t f = 0; f < _size; ++f) {
+        _runningMean[f] = (1 - _momentum) * _runningMean[f] + _momentum * statistics.mean[f];
+        _runningVariance[f] = (1 - _momentum) * _runningVariance[f] + _momentum * statistics.variance[f] * correction;
+    }
+}
+
+// Linear layer equivalent to the given one followed by this layer in evaluation.
+template <typename T> LinearPtr<T> BatchNorm1d<T>::fold(const Linear<T> &linear) const {
+    if (linear._output != _size) {
+        throw std::invalid_argument("BatchNorm1d of size " + std::to_string(_size) +
+                                    " cannot be folded into a Linear layer with " + std::to_string(linear._output) +
+                                    " outputs.");
+    }
+
+    std::vector<T> weights(linear._weights.size());
+    std::vector<T> biases(_size);
+    for (size_t o = 0; o < _size; ++o) {
+        const T scale = _weights[o]->getValue() / std::sqrt(_runningVariance[o] + _epsilon);
+        for (size_t i = 0; i < linear._input; ++i) {
+            const size_t index = o * linear._input + i;
+            weights[index] = linear._weights[index]->getValue() * scale;
+        }
+        biases[o] = (linear._biases[o]->getValue() - _runningMean[o]) * scale + _biases[o]->getValue();
+    }
+
+    return LinearPtr<T>(new Linear<T>(linear._input, linear._output, weights, biases));
+}
+
+// Replaces every Linear layer followed by a BatchNorm1d with a single Linear layer, for inference. Dropout layers are
+// Linear ones, which lose their dropout when folded.
+template <typename T> SequentialPtr<T> BatchNorm1d<T>::fold(const SequentialPtr<T> &model) {
+    const std::vector<ModulePtr<T>> &layers = model->getLayers();
+
+    std::vector<ModulePtr<T>> folded;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        auto linear = std::dynamic_pointer_cast<Linear<T>>(layers[l]);
+        auto norm = l + 1 < layers.size() ? std::dynamic_pointer_cast<BatchNorm1d<T>>(layers[l + 1]) : nullptr;
+        if (linear && norm) {
+            folded.push_back(norm->fold(*linear));
+            ++l;
+        } else {
+            folded.push_back(layers[l]);
+        }
+    }
+
+    return Sequential<T>::create(folded);
+}
+
+template <typename T> Vector<T> BatchNorm1d<T>::operator()(const Vector<T> &x) const { return (*this)(Batch<T>{x})[0]; }
+
+template <typename T> TensorPtr<T> BatchNorm1d<T>::operator()(const TensorPtr<T> &x) const {
+    Normalization::Statistics<T> stats = statistics(x->size() / _size);
+
+    auto gamma = Tensor<T>::fromValues(_weights, {_size});
+    auto beta = Tensor<T>::fromValues(_biases, {_size});
+    TensorPtr<T> y = Tensor<T>::normalize(x, gamma, beta, Normalization::Axis::Batch, _epsilon, stats);
+
+    update(stats, x->size() / _size);
+    return y;
+}
+
+template <typename T> Batch<T> BatchNorm1d<T>::operator()(const Batch<T> &x) const {
+    Normalization::Statistics<T> stats = statistics(x.size());
+
+    std::vector<ValuePtr<T>> rows;
+    rows.reserve(x.size() * _size);
+    for (const Vector<T> &sample : x) {
+        if (sample.size() != _size) {
+            throw std::invalid_argument("BatchNorm1d of size " + std::to_string(_size) +
+                                        " cannot be applied to a Vector of size " + std::to_string(sample.size()) +
+                                        ".");
+        }
+        rows.insert(rows.end(), sample._values.begin(), sample._values.end());
+    }
+
+    std::vector<ValuePtr<T>> y =
+        Value<T>::normalize(rows, _weights, _biases, Normalization::Axis::Batch, _epsilon, stats);
+    update(stats, x.size());
+
+    Batch<T> out(x.size());
+    for (size_t r = 0; r < x.size(); ++r)
+        out[r] = Vector<T>(std::vector<ValuePtr<T>>(y.begin() + r * _size, y.begin() + (r + 1) * _size));
+    return out;
+}
+
+// Every feature contributes its scale followed by its shift.
+template <typename T> std::vector<ValuePtr<T>> BatchNorm1d<T>::parameters() const {
+    std::vector<ValuePtr<T>> params;
+    params.reserve(2 * _size);
+    for (size_t f = 0; f < _size; ++f) {
+        params.push_back(_weights[f]);
+        params.push_back(_biases[f]);
+    }
+
+    return params;
+}
+
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class BatchNorm1d<Type::float32>;
+extern template class BatchNorm1d<Type::float64>;
+#endif
+
+} // namespace shkyera
@@ -0,0 +1,155 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "../../core/ImageShape.hpp"
+#include "../../core/Type.hpp"
+#include "../../core/Utils.hpp"
+#include "../../core/Value.hpp"
+#include "../../core/WeightCache.hpp"
+#include "../Module.hpp"
+
+namespace shkyera {
+
+template <typename T> class Conv2D;
+template <typename T> using Conv2DPtr = std::shared_ptr<Conv2D<T>>;
+
+using Conv2D32 = Conv2D<Type::float32>;
+using Conv2D64 = Conv2D<Type::float64>;
+
+/**
+ * Two-dimensional convolution with square filters, stride and zero padding. Inputs hold an image of the given shape,
+ * channel by channel (see Image::planes), and outputs hold one channel per filter in the same layout. The weights are
+ * stored filter by filter, each as (channels, kernel, kernel).
+ *
+ * The windows of an image are unfolded into the rows of a matrix, which turns the convolution into a single matrix
+ * multiplication with the filters: Value::linear for Vectors and Batches, Tensor::conv2d for tensors.
+ */
+template <typename T> class Conv2D : public Module<T> {
+  protected:
+    ImageShape _input;
+    ImageShape _output;
+    size_t _kernel;
+    size_t _stride;
+    size_t _padding;
+    std::vector<ValuePtr<T>> _weights;
+    std::vector<ValuePtr<T>> _biases;
+    WeightCache<T> _weightCache;
+
+    Conv2D(ImageShape input, size_t filters, size_t kernel, size_t stride, size_t padding);
+
+    std::vector<ValuePtr<T>> patches(const Vector<T> &x) const;
+
+  public:
+    static Conv2DPtr<T> create(ImageShape input, size_t filters, size_t kernel, size_t stride = 1, size_t padding = 0);
+
+    ImageShape outputShape() const;
+
+    virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
+    virtual std::vector<ValuePtr<T>> parameters() const override;
+};
+
+template <typename T>
+Conv2D<T>::Conv2D(ImageShape input, size_t filters, size_t kernel, size_t stride, size_t padding)
+    : _input(input), _output(input.slide(filters, kernel, stride, padding)), _kernel(kernel), _stride(stride),
+      _padding(padding) {
+    const size_t depth = input.channels * kernel * kernel;
+    _weights.reserve(filters * depth);
+    _biases.reserve(filters);
+    for (size_t f = 0; f < filters; ++f) {
+        for (T weight : utils::sample<T>(-1, 1, depth))
+            _weights.push_back(Value<T>::create(weight));
+        _biases.push_back(Value<T>::create(utils::sample<T>(-1, 1)));
+    }
+}
+
+template <typename T>
+Conv2DPtr<T> Conv2D<T>::create(ImageShape input, size_t filters, size_t kernel, size_t stride, size_t padding) {
+    return std::shared_ptr<Conv2D<T>>(new Conv2D<T>(input, filters, kernel, stride, padding));
+}
+
+template <typename T> ImageShape Conv2D<T>::outputShape() const { return _output; }
+
+// One row per output pixel, holding the window under it channel by channel. Padding is filled with a constant zero.
+template <typename T> std::vector<ValuePtr<T>> Conv2D<T>::patches(const Vector<T> &x) const {
+    if (x.size() != _input.size()) {
+        throw std::invalid_argument("Conv2D layer for images of shape " + _input.toString() +
+                                    " cannot be applied to a Vector of size " + std::to_string(x.size()) + ".");
+    }
+
+    const size_t positions = _output.height * _output.width;
+    const size_t depth = _input.channels * _kernel * _kernel;
+
+    std::vector<ValuePtr<T>> columns(depth * positions);
+    _input.im2col(x._values.data(), _kernel, _stride, _padding, Value<T>::constant(0), columns.data());
+
+    std::vector<ValuePtr<T>> rows(positions * depth);
+    for (size_t d = 0; d < depth; ++d)
+        for (size_t p = 0; p < positions; ++p)
+            rows[p * depth + d] = std::move(columns[d * positions + p]);
+    return rows;
+}
+
+template <typename T> Vector<T> Conv2D<T>::operator()(const Vector<T> &x) const { return (*this)(Batch<T>{x})[0]; }
+
+template <typename T> TensorPtr<T> Conv2D<T>::operator()(const TensorPtr<T> &x) const {
+    const size_t filters = _biases.size();
+    auto weightTensor = Tensor<T>::fromValues(_weights, {filters, _input.channels, _kernel, _kernel});
+    auto biasTensor = Tensor<T>::fromValues(_biases, {filters});
+
+    return Tensor<T>::conv2d(x, _input, weightTensor, biasTensor, _stride, _padding);
+}
+
+// The windows of all samples are multiplied with the filters at once, which yields the pixels of each sample position
+// by position, and they are reordered channel by channel afterwards.
+template <typename T> Batch<T> Conv2D<T>::operator()(const Batch<T> &x) const {
+    const size_t filters = _biases.size();
+    const size_t positions = _output.height * _output.width;
+
+    std::vector<ValuePtr<T>> rows;
+    rows.reserve(x.size() * positions * _input.channels * _kernel * _kernel);
+    for (const Vector<T> &sample : x) {
+        std::vector<ValuePtr<T>> sampleRows = patches(sample);
+        rows.insert(rows.end(), std::make_move_iterator(sampleRows.begin()), std::make_move_iterator(sampleRows.end()));
+    }
+
+    std::vector<ValuePtr<T>> y = Value<T>::linear(rows, _weights, _biases, &_weightCache);
+
+    Batch<T> out(x.size());
+    for (size_t s = 0; s < x.size(); ++s) {
+        std::vector<ValuePtr<T>> image(filters * positions);
+        for (size_t p = 0; p < positions; ++p)
+            for (size_t f = 0; f < filters; ++f)
+                image[f * positions + p] = y[(s * positions + p) * filters + f];
+        out[s] = Vector<T>(std::move(image));
+    }
+    return out;
+}
+
+// Every filter contributes its weights followed by its bias.
+template <typename T> std::vector<ValuePtr<T>> Conv2D<T>::parameters() const {
+    const size_t depth = _input.channels * _kernel * _kernel;
+
+    std::vector<ValuePtr<T>> params;
+    params.reserve(_weights.size() + _biases.size());
+    for (size_t f = 0; f < _biases.size(); ++f) {
+        params.insert(params.end(), _weights.begin() + f * depth, _weights.begin() + (f + 1) * depth);
+        params.push_back(_biases[f]);
+    }
+
+    return params;
+}
+
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Conv2D<Type::float32>;
+extern template class Conv2D<Type::float64>;
+#endif
+
+} // namespace shkyera
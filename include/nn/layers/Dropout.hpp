@@ -24,14 +24,18 @@ template <typename T> class Dropout : public Linear<T> {
 
     Dropout(size_t input, size_t size, double dropout);
 
+    Vector<T> drop(const Vector<T> &x) const;
+
   public:
     static DropoutPtr<T> create(size_t input, size_t size, double dropout);
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
 };
 
 template <typename T> Dropout<T>::Dropout(size_t input, size_t size, double dropout) : Linear<T>(input, size) {
-    if (_dropout < 0 || _dropout >= 1) {
+    if (dropout < 0 || dropout >= 1) {
         throw std::invalid_argument("Droput rate must be in the range [0,1). You set it to " + std::to_string(dropout) +
                                     ".");
     }
@@ -42,7 +46,7 @@ template <typename T> DropoutPtr<T> Dropout<T>::create(size_t input, size_t size
     return std::shared_ptr<Dropout<T>>(new Dropout(input, size, dropout));
 }
 
-template <typename T> Vector<T> Dropout<T>::operator()(const Vector<T> &x) const {
+template <typename T> Vector<T> Dropout<T>::drop(const Vector<T> &x) const {
     std::vector<ValuePtr<T>> alteredInput;
     alteredInput.reserve(x.size());
     for (const ValuePtr<T> &val : x)
@@ -52,9 +56,29 @@ template <typename T> Vector<T> Dropout<T>::operator()(const Vector<T> &x) const
     for (size_t idxToRemove : indicesToRemove)
         alteredInput[idxToRemove] = Value<T>::create(0);
 
-    auto transformedInput = Vector<T>(alteredInput) * static_cast<T>(1.0 / (1 - _dropout));
+    return Vector<T>(alteredInput) * static_cast<T>(1.0 / (1 - _dropout));
+}
+
+template <typename T> Vector<T> Dropout<T>::operator()(const Vector<T> &x) const {
+    return Linear<T>::operator()(drop(x));
+}
+
+template <typename T> TensorPtr<T> Dropout<T>::operator()(const TensorPtr<T> &x) const {
+    std::vector<T> mask(x->size(), static_cast<T>(1.0 / (1 - _dropout)));
+
+    std::vector<size_t> indicesToRemove = utils::sample<size_t>(0, x->size() - 1, _dropout * x->size(), false);
+    for (size_t idxToRemove : indicesToRemove)
+        mask[idxToRemove] = 0;
+
+    return Linear<T>::operator()(x * Tensor<T>::of(x->shape(), mask));
+}
+
+template <typename T> Batch<T> Dropout<T>::operator()(const Batch<T> &x) const {
+    Batch<T> dropped(x.size());
+    for (size_t i = 0; i < x.size(); ++i)
+        dropped[i] = drop(x[i]);
 
-    return Linear<T>::operator()(transformedInput);
+    return Linear<T>::operator()(dropped);
 }
 
 } // namespace shkyera
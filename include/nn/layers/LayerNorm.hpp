@@ -0,0 +1,108 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "../../core/Normalization.hpp"
+#include "../../core/Type.hpp"
+#include "../../core/Value.hpp"
+#include "../Module.hpp"
+
+namespace shkyera {
+
+template <typename T> class LayerNorm;
+template <typename T> using LayerNormPtr = std::shared_ptr<LayerNorm<T>>;
+
+using LayerNorm32 = LayerNorm<Type::float32>;
+using LayerNorm64 = LayerNorm<Type::float64>;
+
+/**
+ * Layer normalization, y = gamma * (x - mean) / sqrt(variance + epsilon) + beta, where the mean and variance are taken
+ * over the features of every sample on its own. It behaves the same during training and evaluation.
+ */
+template <typename T> class LayerNorm : public Module<T> {
+  protected:
+    size_t _size;
+    T _epsilon;
+    std::vector<ValuePtr<T>> _weights;
+    std::vector<ValuePtr<T>> _biases;
+
+    LayerNorm(size_t size, T epsilon);
+
+  public:
+    static LayerNormPtr<T> create(size_t size, T epsilon = 1e-5);
+
+    virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
+    virtual std::vector<ValuePtr<T>> parameters() const override;
+};
+
+template <typename T> LayerNorm<T>::LayerNorm(size_t size, T epsilon) : _size(size), _epsilon(epsilon) {
+    _weights.reserve(size);
+    _biases.reserve(size);
+    for (size_t f = 0; f < size; ++f) {
+        _weights.push_back(Value<T>::create(1));
+        _biases.push_back(Value<T>::create(0));
+    }
+}
+
+template <typename T> LayerNormPtr<T> LayerNorm<T>::create(size_t size, T epsilon) {
+    return std::shared_ptr<LayerNorm<T>>(new LayerNorm<T>(size, epsilon));
+}
+
+template <typename T> Vector<T> LayerNorm<T>::operator()(const Vector<T> &x) const { return (*this)(Batch<T>{x})[0]; }
+
+template <typename T> TensorPtr<T> LayerNorm<T>::operator()(const TensorPtr<T> &x) const {
+    Normalization::Statistics<T> stats;
+
+    auto gamma = Tensor<T>::fromValues(_weights, {_size});
+    auto beta = Tensor<T>::fromValues(_biases, {_size});
+    return Tensor<T>::normalize(x, gamma, beta, Normalization::Axis::Features, _epsilon, stats);
+}
+
+// All samples are normalized by a single node of the graph.
+template <typename T> Batch<T> LayerNorm<T>::operator()(const Batch<T> &x) const {
+    std::vector<ValuePtr<T>> rows;
+    rows.reserve(x.size() * _size);
+    for (const Vector<T> &sample : x) {
+        if (sample.size() != _size) {
+            throw std::invalid_argument("LayerNorm of size " + std::to_string(_size) +
+                                        " cannot be applied to a Vector of size " + std::to_string(sample.size()) +
+                                        ".");
+        }
+        rows.insert(rows.end(), sample._values.begin(), sample._values.end());
+    }
+
+    Normalization::Statistics<T> stats;
+    std::vector<ValuePtr<T>> y =
+        Value<T>::normalize(rows, _weights, _biases, Normalization::Axis::Features, _epsilon, stats);
+
+    Batch<T> out(x.size());
+    for (size_t r = 0; r < x.size(); ++r)
+        out[r] = Vector<T>(std::vector<ValuePtr<T>>(y.begin() + r * _size, y.begin() + (r + 1) * _size));
+    return out;
+}
+
+// Every feature contributes its scale followed by its shift.
+template <typename T> std::vector<ValuePtr<T>> LayerNorm<T>::parameters() const {
+    std::vector<ValuePtr<T>> params;
+    params.reserve(2 * _size);
+    for (size_t f = 0; f < _size; ++f) {
+        params.push_back(_weights[f]);
+        params.push_back(_biases[f]);
+    }
+
+    return params;
+}
+
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class LayerNorm<Type::float32>;
+extern template class LayerNorm<Type::float64>;
+#endif
+
+} // namespace shkyera
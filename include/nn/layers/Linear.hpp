@@ -8,59 +8,129 @@
 #pragma once
 
 #include "../../core/Type.hpp"
+#include "../../core/Utils.hpp"
+#include "../../core/Value.hpp"
+#include "../../core/WeightCache.hpp"
 #include "../Module.hpp"
-#include "../Neuron.hpp"
 
 namespace shkyera {
 
 template <typename T> class Linear;
+template <typename T> class QuantizedLinear;
+template <typename T> class BatchNorm1d;
 template <typename T> using LinearPtr = std::shared_ptr<Linear<T>>;
 
 using Linear32 = Linear<Type::float32>;
 using Linear64 = Linear<Type::float64>;
 
+/**
+ * Fully connected layer, y = W * x + b. The weights are stored as a matrix, row by row, with one row per output. A
+ * batch is treated as a single matrix multiplication, whose graph has one node for the whole layer (see Value::linear).
+ * The weights are also kept as one contiguous matrix and its transpose, which are gathered again only after an
+ * optimizer step (see WeightCache).
+ */
 template <typename T> class Linear : public Module<T> {
   protected:
-    std::vector<Neuron<T>> _neurons;
+    size_t _input;
+    size_t _output;
+    std::vector<ValuePtr<T>> _weights;
+    std::vector<ValuePtr<T>> _biases;
+    WeightCache<T> _weightCache;
 
     Linear(size_t input, size_t size);
 
+  private:
+    Linear(size_t input, size_t size, const std::vector<T> &weights, const std::vector<T> &biases);
+
   public:
+    friend class QuantizedLinear<T>;
+    friend class BatchNorm1d<T>;
+
     static LinearPtr<T> create(size_t input, size_t size);
 
     virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+    virtual Batch<T> operator()(const Batch<T> &x) const override;
     virtual std::vector<ValuePtr<T>> parameters() const override;
 };
 
-template <typename T> Linear<T>::Linear(size_t input, size_t size) {
-    _neurons.reserve(size);
-    for (size_t i = 0; i < size; ++i) {
-        _neurons.emplace_back(Neuron<T>(input));
+template <typename T> Linear<T>::Linear(size_t input, size_t size) : _input(input), _output(size) {
+    _weights.reserve(size * input);
+    _biases.reserve(size);
+    for (size_t o = 0; o < size; ++o) {
+        for (T weight : utils::sample<T>(-1, 1, input))
+            _weights.push_back(Value<T>::create(weight));
+        _biases.push_back(Value<T>::create(utils::sample<T>(-1, 1)));
     }
 }
 
+// Layer with the given weights, row by row, which draws nothing from the generator.
+template <typename T>
+Linear<T>::Linear(size_t input, size_t size, const std::vector<T> &weights, const std::vector<T> &biases)
+    : _input(input), _output(size) {
+    _weights.reserve(size * input);
+    _biases.reserve(size);
+    for (T weight : weights)
+        _weights.push_back(Value<T>::create(weight));
+    for (T bias : biases)
+        _biases.push_back(Value<T>::create(bias));
+}
+
 template <typename T> LinearPtr<T> Linear<T>::create(size_t input, size_t size) {
     return std::shared_ptr<Linear<T>>(new Linear<T>(input, size));
 }
 
 template <typename T> Vector<T> Linear<T>::operator()(const Vector<T> &x) const {
-    std::vector<ValuePtr<T>> output(_neurons.size());
+    if (x.size() != _input) {
+        throw std::invalid_argument("Linear layer with " + std::to_string(_input) +
+                                    " inputs cannot be applied to a Vector of size " + std::to_string(x.size()) + ".");
+    }
 
-    for (size_t i = 0; i < _neurons.size(); i++) {
-        output[i] = _neurons[i](x)[0];
+    return Vector<T>(Value<T>::linear(x._values, _weights, _biases, &_weightCache));
+}
+
+template <typename T> TensorPtr<T> Linear<T>::operator()(const TensorPtr<T> &x) const {
+    auto weightTensor = Tensor<T>::fromValues(_weights, {_output, _input});
+    auto biasTensor = Tensor<T>::fromValues(_biases, {_output});
+
+    return Tensor<T>::affine(x, weightTensor, biasTensor);
+}
+
+template <typename T> Batch<T> Linear<T>::operator()(const Batch<T> &x) const {
+    std::vector<ValuePtr<T>> rows;
+    rows.reserve(x.size() * _input);
+    for (const Vector<T> &sample : x) {
+        if (sample.size() != _input) {
+            throw std::invalid_argument("Linear layer with " + std::to_string(_input) +
+                                        " inputs cannot be applied to a Vector of size " +
+                                        std::to_string(sample.size()) + ".");
+        }
+        rows.insert(rows.end(), sample._values.begin(), sample._values.end());
     }
 
-    return Vector<T>(output);
+    std::vector<ValuePtr<T>> y = Value<T>::linear(rows, _weights, _biases, &_weightCache);
+
+    Batch<T> out(x.size());
+    for (size_t r = 0; r < x.size(); ++r)
+        out[r] = Vector<T>(std::vector<ValuePtr<T>>(y.begin() + r * _output, y.begin() + (r + 1) * _output));
+    return out;
 }
 
+// Every output contributes its weights followed by its bias.
 template <typename T> std::vector<ValuePtr<T>> Linear<T>::parameters() const {
     std::vector<ValuePtr<T>> params;
-    for (const Neuron<T> &n : _neurons) {
-        std::vector<ValuePtr<T>> neuronParams = n.parameters();
-        params.insert(params.end(), neuronParams.begin(), neuronParams.end());
+    params.reserve(_weights.size() + _biases.size());
+    for (size_t o = 0; o < _output; ++o) {
+        params.insert(params.end(), _weights.begin() + o * _input, _weights.begin() + (o + 1) * _input);
+        params.push_back(_biases[o]);
     }
 
     return params;
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Linear<Type::float32>;
+extern template class Linear<Type::float64>;
+#endif
+
 } // namespace shkyera
@@ -0,0 +1,99 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include "../../core/ImageShape.hpp"
+#include "../../core/Type.hpp"
+#include "../../core/Value.hpp"
+#include "../Module.hpp"
+
+namespace shkyera {
+
+template <typename T> class MaxPool2D;
+template <typename T> using MaxPool2DPtr = std::shared_ptr<MaxPool2D<T>>;
+
+using MaxPool2D32 = MaxPool2D<Type::float32>;
+using MaxPool2D64 = MaxPool2D<Type::float64>;
+
+/**
+ * Takes the largest pixel of every window of a square size, separately for every channel. The stride defaults to the
+ * size of the window, and the padding is never picked. Inputs and outputs hold images channel by channel.
+ */
+template <typename T> class MaxPool2D : public Module<T> {
+  protected:
+    ImageShape _input;
+    ImageShape _output;
+    size_t _size;
+    size_t _stride;
+    size_t _padding;
+
+    MaxPool2D(ImageShape input, size_t size, size_t stride, size_t padding);
+
+  public:
+    static MaxPool2DPtr<T> create(ImageShape input, size_t size, size_t stride = 0, size_t padding = 0);
+
+    ImageShape outputShape() const;
+
+    virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+};
+
+template <typename T>
+MaxPool2D<T>::MaxPool2D(ImageShape input, size_t size, size_t stride, size_t padding)
+    : _input(input), _size(size), _stride(stride == 0 ? size : stride), _padding(padding) {
+    if (padding >= size) {
+        throw std::invalid_argument("Padding of a pooling window must be smaller than the window. Sizes are " +
+                                    std::to_string(padding) + " and " + std::to_string(size) + ".");
+    }
+    _output = input.slide(input.channels, _size, _stride, _padding);
+}
+
+template <typename T>
+MaxPool2DPtr<T> MaxPool2D<T>::create(ImageShape input, size_t size, size_t stride, size_t padding) {
+    return std::shared_ptr<MaxPool2D<T>>(new MaxPool2D<T>(input, size, stride, padding));
+}
+
+template <typename T> ImageShape MaxPool2D<T>::outputShape() const { return _output; }
+
+template <typename T> Vector<T> MaxPool2D<T>::operator()(const Vector<T> &x) const {
+    if (x.size() != _input.size()) {
+        throw std::invalid_argument("MaxPool2D layer for images of shape " + _input.toString() +
+                                    " cannot be applied to a Vector of size " + std::to_string(x.size()) + ".");
+    }
+
+    std::vector<ValuePtr<T>> out;
+    out.reserve(_output.size());
+    std::vector<ValuePtr<T>> window;
+    for (size_t c = 0; c < _input.channels; ++c) {
+        const size_t plane = c * _input.height * _input.width;
+        for (size_t oy = 0; oy < _output.height; ++oy) {
+            auto [yBegin, yEnd] = detail::windowRange(oy * _stride, _size, _padding, _input.height);
+            for (size_t ox = 0; ox < _output.width; ++ox) {
+                auto [xBegin, xEnd] = detail::windowRange(ox * _stride, _size, _padding, _input.width);
+                window.clear();
+                for (size_t row = yBegin; row < yEnd; ++row)
+                    for (size_t column = xBegin; column < xEnd; ++column)
+                        window.push_back(x._values[plane + row * _input.width + column]);
+                out.push_back(Value<T>::max(window));
+            }
+        }
+    }
+
+    return Vector<T>(out);
+}
+
+template <typename T> TensorPtr<T> MaxPool2D<T>::operator()(const TensorPtr<T> &x) const {
+    return x->maxPool2d(_input, _size, _stride, _padding);
+}
+
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class MaxPool2D<Type::float32>;
+extern template class MaxPool2D<Type::float64>;
+#endif
+
+} // namespace shkyera
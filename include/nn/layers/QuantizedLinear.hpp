@@ -0,0 +1,180 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "../../core/Type.hpp"
+#include "../Module.hpp"
+#include "Linear.hpp"
+
+namespace shkyera {
+
+template <typename T> class QuantizedLinear;
+template <typename T> using QuantizedLinearPtr = std::shared_ptr<QuantizedLinear<T>>;
+
+using QuantizedLinear32 = QuantizedLinear<Type::float32>;
+using QuantizedLinear64 = QuantizedLinear<Type::float64>;
+
+/**
+ * Inference-only counterpart of a trained Linear layer. Weights are stored as int8 with one scale per output, inputs
+ * are quantized to int8 with a scale and zero point calibrated on sample data, and the products are accumulated in
+ * int32. The outputs are computed directly, without building a graph, and a following ReLU or Sigmoid can be fused
+ * into the layer. Such layers are created by Quantization::quantize().
+ */
+template <typename T> class QuantizedLinear : public Module<T> {
+  public:
+    enum class Activation { None, ReLU, Sigmoid };
+
+  private:
+    size_t _input;
+    size_t _output;
+
+    std::vector<int8_t> _weights;
+    std::vector<int32_t> _weightSums;
+    std::vector<float> _weightScales;
+    std::vector<float> _biases;
+
+    float _inputScale;
+    int32_t _inputZeroPoint;
+    Activation _activation;
+
+    QuantizedLinear(const Linear<T> &linear, T inputMin, T inputMax, Activation activation);
+
+    void quantizeInput(const T *x, int8_t *quantized) const;
+    void forwardRow(const int8_t *quantized, T *y) const;
+
+  public:
+    static QuantizedLinearPtr<T> create(const Linear<T> &linear, T inputMin, T inputMax,
+                                        Activation activation = Activation::None);
+
+    size_t weightBytes() const;
+
+    virtual Vector<T> operator()(const Vector<T> &x) const override;
+    virtual TensorPtr<T> operator()(const TensorPtr<T> &x) const override;
+};
+
+template <typename T>
+QuantizedLinear<T>::QuantizedLinear(const Linear<T> &linear, T inputMin, T inputMax, Activation activation)
+    : _input(linear._input), _output(linear._output), _activation(activation) {
+    // The range has to contain zero, so that zero inputs, e.g. the outputs of a ReLU, are represented exactly.
+    float low = std::min<float>(inputMin, 0);
+    float high = std::max<float>(inputMax, 0);
+    _inputScale = high > low ? (high - low) / 255 : 1;
+    _inputZeroPoint = static_cast<int32_t>(std::lround(-128 - low / _inputScale));
+
+    _weights.resize(_output * _input);
+    _weightSums.resize(_output);
+    _weightScales.resize(_output);
+    _biases.resize(_output);
+
+    std::vector<ValuePtr<T>> params = linear.parameters();
+    for (size_t o = 0; o < _output; ++o) {
+        const ValuePtr<T> *row = params.data() + o * (_input + 1);
+
+        float largest = 0;
+        for (size_t i = 0; i < _input; ++i)
+            largest = std::max<float>(largest, std::abs(row[i]->getValue()));
+        float scale = largest > 0 ? largest / 127 : 1;
+
+        int32_t sum = 0;
+        for (size_t i = 0; i < _input; ++i) {
+            long quantized = std::lround(row[i]->getValue() / scale);
+            _weights[o * _input + i] = static_cast<int8_t>(std::clamp<long>(quantized, -127, 127));
+            sum += _weights[o * _input + i];
+        }
+
+        _weightSums[o] = sum;
+        _weightScales[o] = scale;
+        _biases[o] = row[_input]->getValue();
+    }
+}
+
+template <typename T>
+QuantizedLinearPtr<T> QuantizedLinear<T>::create(const Linear<T> &linear, T inputMin, T inputMax,
+                                                 Activation activation) {
+    return std::shared_ptr<QuantizedLinear<T>>(new QuantizedLinear<T>(linear, inputMin, inputMax, activation));
+}
+
+template <typename T> size_t QuantizedLinear<T>::weightBytes() const {
+    return _weights.size() * sizeof(int8_t) + (_weightSums.size() + _weightScales.size() + _biases.size()) * 4;
+}
+
+template <typename T> void QuantizedLinear<T>::quantizeInput(const T *x, int8_t *quantized) const {
+    float inverseScale = 1 / _inputScale;
+    float zeroPoint = static_cast<float>(_inputZeroPoint);
+    for (size_t i = 0; i < _input; ++i) {
+        float q = std::clamp(static_cast<float>(x[i]) * inverseScale + zeroPoint, -128.0f, 127.0f);
+        quantized[i] = static_cast<int8_t>(q < 0 ? q - 0.5f : q + 0.5f);
+    }
+}
+
+// y = s_x * s_w * (sum(w_q * x_q) - z_x * sum(w_q)) + b, where the sums are exact in int32.
+template <typename T> void QuantizedLinear<T>::forwardRow(const int8_t *quantized, T *y) const {
+    for (size_t o = 0; o < _output; ++o) {
+        const int8_t *w = _weights.data() + o * _input;
+
+        int32_t accumulated = 0;
+        for (size_t i = 0; i < _input; ++i)
+            accumulated += static_cast<int32_t>(w[i]) * static_cast<int32_t>(quantized[i]);
+        accumulated -= _inputZeroPoint * _weightSums[o];
+
+        float result = static_cast<float>(accumulated) * (_inputScale * _weightScales[o]) + _biases[o];
+        if (_activation == Activation::ReLU)
+            result = std::max(result, 0.0f);
+        else if (_activation == Activation::Sigmoid)
+            result = 1 / (1 + std::exp(-result));
+
+        y[o] = static_cast<T>(result);
+    }
+}
+
+template <typename T> Vector<T> QuantizedLinear<T>::operator()(const Vector<T> &x) const {
+    if (x.size() != _input) {
+        throw std::invalid_argument("Quantized layer with " + std::to_string(_input) +
+                                    " inputs cannot be applied to a Vector of size " + std::to_string(x.size()) + ".");
+    }
+
+    std::vector<T> input(_input);
+    for (size_t i = 0; i < _input; ++i)
+        input[i] = x[i]->getValue();
+
+    std::vector<int8_t> quantized(_input);
+    quantizeInput(input.data(), quantized.data());
+
+    std::vector<T> output(_output);
+    forwardRow(quantized.data(), output.data());
+
+    return Vector<T>::of(output);
+}
+
+template <typename T> TensorPtr<T> QuantizedLinear<T>::operator()(const TensorPtr<T> &x) const {
+    size_t input = x->shape().empty() ? 1 : x->shape().back();
+    if (input != _input) {
+        throw std::invalid_argument("Quantized layer with " + std::to_string(_input) +
+                                    " inputs cannot be applied to a Tensor of shape " +
+                                    detail::shapeToString(x->shape()) + ".");
+    }
+
+    std::vector<size_t> shape = x->shape().empty() ? std::vector<size_t>{1} : x->shape();
+    shape.back() = _output;
+
+    size_t rows = x->size() / _input;
+    std::vector<T> output(rows * _output);
+    std::vector<int8_t> quantized(_input);
+    for (size_t r = 0; r < rows; ++r) {
+        quantizeInput(x->data() + r * _input, quantized.data());
+        forwardRow(quantized.data(), output.data() + r * _output);
+    }
+
+    return Tensor<T>::of(shape, output);
+}
+
+} // namespace shkyera
@@ -19,51 +19,61 @@ namespace shkyera {
 
 template <typename T> class AdaMax;
 using AdaMax32 = AdaMax<Type::float32>;
-using AdaMax64 = AdaMax<Type::float32>;
+using AdaMax64 = AdaMax<Type::float64>;
 
 template <typename T> class AdaMax : public Optimizer<T> {
   private:
     size_t _timestep;
-    T _b1;
-    T _b2;
-    T _eps;
+    Type::Accumulator<T> _b1;
+    Type::Accumulator<T> _b2;
+    Type::Accumulator<T> _eps;
 
-    std::vector<T> _moments;
-    std::vector<T> _infinityNorms;
+    std::vector<Type::Accumulator<T>> _moments;
+    std::vector<Type::Accumulator<T>> _infinityNorms;
 
   public:
-    AdaMax(std::vector<ValuePtr<T>> params, T learningRate, T b1 = 0.9, T b2 = 0.999, T eps = 1e-8);
+    template <typename P>
+    AdaMax(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> b1 = 0.9,
+           Type::Accumulator<T> b2 = 0.999, Type::Accumulator<T> eps = 1e-8);
 
     void step() override;
 };
 
 template <typename T>
-AdaMax<T>::AdaMax(std::vector<ValuePtr<T>> params, T learningRate, T b1, T b2, T eps)
+template <typename P>
+AdaMax<T>::AdaMax(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> b1,
+                  Type::Accumulator<T> b2, Type::Accumulator<T> eps)
     : Optimizer<T>(params, learningRate) {
     _b1 = b1;
     _b2 = b2;
     _eps = eps;
 
     _timestep = 0;
-    _moments.resize(params.size(), 0);
-    _infinityNorms.resize(params.size(), 0);
+    _moments.resize(this->parameterCount(), 0);
+    _infinityNorms.resize(this->parameterCount(), 0);
 }
 
 template <typename T> void AdaMax<T>::step() {
-    ++_timestep;
+    Profiler::Span span("AdaMax::step", "Optimizer");
+    if (!this->unscaleGradients())
+        return;
 
-    for (size_t i = 0; i < this->_parameters.size(); ++i) {
-        const ValuePtr<T> &param = this->_parameters[i];
+    ++_timestep;
 
-        T gradient = param->getGradient();
-        T moment = _b1 * _moments[i] + (1 - _b1) * gradient;
-        T infinityNorm = std::max(_b2 * _infinityNorms[i], std::abs(gradient) + _eps);
+    this->forEachParameter([this](size_t i, Type::Accumulator<T> &data, Type::Accumulator<T> gradient) {
+        Type::Accumulator<T> moment = _b1 * _moments[i] + (1 - _b1) * gradient;
+        Type::Accumulator<T> infinityNorm = std::max(_b2 * _infinityNorms[i], std::abs(gradient) + _eps);
 
-        param->_data -= (this->_learningRate / (1 - std::pow(_b1, _timestep))) * (moment / infinityNorm);
+        data -= (this->_learningRate / (1 - std::pow(_b1, _timestep))) * (moment / infinityNorm);
 
         _infinityNorms[i] = infinityNorm;
         _moments[i] = moment;
-    }
+    });
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class AdaMax<Type::float32>;
+extern template class AdaMax<Type::float64>;
+#endif
+
 } // namespace shkyera
@@ -19,54 +19,64 @@ namespace shkyera {
 
 template <typename T> class Adam;
 using Adam32 = Adam<Type::float32>;
-using Adam64 = Adam<Type::float32>;
+using Adam64 = Adam<Type::float64>;
 
 template <typename T> class Adam : public Optimizer<T> {
   private:
-    T _b1;
-    T _b2;
-    T _eps;
+    Type::Accumulator<T> _b1;
+    Type::Accumulator<T> _b2;
+    Type::Accumulator<T> _eps;
     size_t _timestep;
 
-    std::vector<T> _firstMoments;
-    std::vector<T> _secondMoments;
+    std::vector<Type::Accumulator<T>> _firstMoments;
+    std::vector<Type::Accumulator<T>> _secondMoments;
 
   public:
-    Adam(std::vector<ValuePtr<T>> params, T learningRate, T b1 = 0.9, T b2 = 0.999, T eps = 1e-8);
+    template <typename P>
+    Adam(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> b1 = 0.9,
+         Type::Accumulator<T> b2 = 0.999, Type::Accumulator<T> eps = 1e-8);
 
     void step() override;
 };
 
 template <typename T>
-Adam<T>::Adam(std::vector<ValuePtr<T>> params, T learningRate, T b1, T b2, T eps) : Optimizer<T>(params, learningRate) {
+template <typename P>
+Adam<T>::Adam(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> b1,
+              Type::Accumulator<T> b2, Type::Accumulator<T> eps)
+    : Optimizer<T>(params, learningRate) {
     _b1 = b1;
     _b2 = b2;
     _eps = eps;
 
     _timestep = 0;
-    _firstMoments.resize(params.size(), 0);
-    _secondMoments.resize(params.size(), 0);
+    _firstMoments.resize(this->parameterCount(), 0);
+    _secondMoments.resize(this->parameterCount(), 0);
 }
 
 template <typename T> void Adam<T>::step() {
-    _timestep++;
-
-    for (size_t i = 0; i < this->_parameters.size(); ++i) {
-        const ValuePtr<T> &param = this->_parameters[i];
+    Profiler::Span span("Adam::step", "Optimizer");
+    if (!this->unscaleGradients())
+        return;
 
-        T gradient = param->getGradient();
+    _timestep++;
 
-        T firstMoment = _b1 * _firstMoments[i] + (1 - _b1) * gradient;
-        T secondMoment = _b2 * _secondMoments[i] + (1 - _b2) * gradient * gradient;
+    this->forEachParameter([this](size_t i, Type::Accumulator<T> &data, Type::Accumulator<T> gradient) {
+        Type::Accumulator<T> firstMoment = _b1 * _firstMoments[i] + (1 - _b1) * gradient;
+        Type::Accumulator<T> secondMoment = _b2 * _secondMoments[i] + (1 - _b2) * gradient * gradient;
 
         _firstMoments[i] = firstMoment;
         _secondMoments[i] = secondMoment;
 
-        T firstMomentHat = firstMoment / (1 - pow(_b1, _timestep));
-        T secondMomentHat = secondMoment / (1 - pow(_b2, _timestep));
+        Type::Accumulator<T> firstMomentHat = firstMoment / (1 - pow(_b1, _timestep));
+        Type::Accumulator<T> secondMomentHat = secondMoment / (1 - pow(_b2, _timestep));
 
-        param->_data -= (this->_learningRate * firstMomentHat) / (sqrt(secondMomentHat) + _eps);
-    }
+        data -= (this->_learningRate * firstMomentHat) / (sqrt(secondMomentHat) + _eps);
+    });
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Adam<Type::float32>;
+extern template class Adam<Type::float64>;
+#endif
+
 } // namespace shkyera
@@ -19,38 +19,46 @@ namespace shkyera {
 
 template <typename T> class NAG;
 using NAG32 = NAG<Type::float32>;
-using NAG64 = NAG<Type::float32>;
+using NAG64 = NAG<Type::float64>;
 
 template <typename T> class NAG : public Optimizer<T> {
   private:
-    T _momentum;
-    std::vector<T> _moments;
+    Type::Accumulator<T> _momentum;
+    std::vector<Type::Accumulator<T>> _moments;
 
   public:
-    NAG(std::vector<ValuePtr<T>> params, T learningRate, T momentum = 0.9);
+    template <typename P>
+    NAG(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> momentum = 0.9);
 
     void step() override;
 };
 
 template <typename T>
-NAG<T>::NAG(std::vector<ValuePtr<T>> params, T learningRate, T momentum) : Optimizer<T>(params, learningRate) {
+template <typename P>
+NAG<T>::NAG(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> momentum)
+    : Optimizer<T>(params, learningRate) {
     _momentum = momentum;
-    _moments.resize(params.size(), 0);
+    _moments.resize(this->parameterCount(), 0);
 }
 
 template <typename T> void NAG<T>::step() {
+    Profiler::Span span("NAG::step", "Optimizer");
     static bool initialized = false;
+    if (!this->unscaleGradients())
+        return;
 
-    for (size_t i = 0; i < this->_parameters.size(); ++i) {
-        const ValuePtr<T> &param = this->_parameters[i];
+    this->forEachParameter([this](size_t i, Type::Accumulator<T> &data, Type::Accumulator<T> gradient) {
+        Type::Accumulator<T> moment = initialized ? _momentum * _moments[i] + (1 - _momentum) * gradient : gradient;
 
-        T gradient = param->getGradient();
-        T moment = initialized ? _momentum * _moments[i] + (1 - _momentum) * gradient : gradient;
-
-        param->_data -= this->_learningRate * (moment + _momentum * _moments[i]);
+        data -= this->_learningRate * (moment + _momentum * _moments[i]);
 
         _moments[i] = moment;
-    }
+    });
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class NAG<Type::float32>;
+extern template class NAG<Type::float64>;
+#endif
+
 } // namespace shkyera
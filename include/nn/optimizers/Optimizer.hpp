@@ -7,42 +7,237 @@
 
 #pragma once
 
+#include <cmath>
 #include <vector>
 
+#include "../../core/Kernels.hpp"
+#include "../../core/LossScale.hpp"
+#include "../../core/NodeStatistics.hpp"
+#include "../../core/Profiler.hpp"
+#include "../../core/Tensor.hpp"
 #include "../../core/Type.hpp"
 #include "../../core/Value.hpp"
+#include "../../core/WeightCache.hpp"
 #include "../Module.hpp"
 
 namespace shkyera {
 
 using Optimizer32 = Optimizer<Type::float32>;
-using Optimizer64 = Optimizer<Type::float32>;
+using Optimizer64 = Optimizer<Type::float64>;
 
 template <typename T> class Optimizer {
   protected:
     std::vector<ValuePtr<T>> _parameters;
-    T _learningRate;
+    std::vector<TensorPtr<T>> _tensorParameters;
+    std::vector<Type::Accumulator<T>> _masterWeights;
+    Type::Accumulator<T> _learningRate;
+    GraphArena *_arena = nullptr;
+    Tape<T> *_tape = nullptr;
+
+    double _lossScale = 1;
+    double _unscale = 1;
+    bool _scalesLoss = false;
+    bool _dynamicLossScale = false;
+    size_t _stepsWithoutOverflow = 0;
+
+    inline static const size_t lossScaleGrowthInterval = 2000;
+
+    size_t parameterCount() const;
+    void keepMasterWeights();
+    bool unscaleGradients();
+    template <typename F> void forEachParameter(F update);
+    template <typename F, typename G> void forEachParameter(F update, G updateTensor);
 
   public:
-    Optimizer(std::vector<ValuePtr<T>> params, T learningRate);
+    Optimizer(std::vector<ValuePtr<T>> params, Type::Accumulator<T> learningRate);
+    Optimizer(std::vector<TensorPtr<T>> params, Type::Accumulator<T> learningRate);
+    virtual ~Optimizer();
+
+    void attach(GraphArena &arena);
+    void attach(Tape<T> &tape);
+
+    void setLossScale(double scale, bool dynamic = false);
+    double getLossScale() const;
 
     virtual void reset();
     virtual void step();
 };
 
 template <typename T>
-Optimizer<T>::Optimizer(std::vector<ValuePtr<T>> params, T learningRate) : _learningRate(learningRate) {
+Optimizer<T>::Optimizer(std::vector<ValuePtr<T>> params, Type::Accumulator<T> learningRate)
+    : _learningRate(learningRate) {
     _parameters = params;
+    keepMasterWeights();
+}
+
+template <typename T>
+Optimizer<T>::Optimizer(std::vector<TensorPtr<T>> params, Type::Accumulator<T> learningRate)
+    : _learningRate(learningRate) {
+    _tensorParameters = params;
+    keepMasterWeights();
+}
+
+template <typename T> Optimizer<T>::~Optimizer() {
+    if (_arena != nullptr && GraphArena::current() == _arena)
+        GraphArena::setCurrent(nullptr);
+    if (_tape != nullptr && Tape<T>::current() == _tape)
+        Tape<T>::setCurrent(nullptr);
+    if (_scalesLoss)
+        LossScale::setCurrent(1);
+}
+
+// After reset(), the graph built on this thread is allocated from the arena until the optimizer is destroyed.
+template <typename T> void Optimizer<T>::attach(GraphArena &arena) { _arena = &arena; }
+
+// After reset(), operations on this thread are recorded on the tape, which is cleared on every reset().
+template <typename T> void Optimizer<T>::attach(Tape<T> &tape) { _tape = &tape; }
+
+// After reset(), the gradients computed on this thread are multiplied by the scale, which step() divides out again. A
+// dynamic scale is halved and the step skipped whenever a gradient overflows, and doubled after a long run of steps
+// without overflows.
+template <typename T> void Optimizer<T>::setLossScale(double scale, bool dynamic) {
+    if (scale <= 0) {
+        throw std::invalid_argument("Loss scale needs to be positive. It is " + std::to_string(scale) + ".");
+    }
+
+    _lossScale = scale;
+    _scalesLoss = true;
+    _dynamicLossScale = dynamic;
+    _stepsWithoutOverflow = 0;
+}
+
+template <typename T> double Optimizer<T>::getLossScale() const { return _lossScale; }
+
+template <typename T> size_t Optimizer<T>::parameterCount() const {
+    size_t count = _parameters.size();
+    for (const TensorPtr<T> &tensor : _tensorParameters)
+        count += tensor->size();
+    return count;
+}
+
+// Parameters stored in 16-bit types are updated through float32 copies, so that small steps are not lost to rounding.
+template <typename T> void Optimizer<T>::keepMasterWeights() {
+    if constexpr (Type::isReduced<T>) {
+        _masterWeights.reserve(parameterCount());
+        for (ValuePtr<T> &val : _parameters)
+            _masterWeights.push_back(val->_data);
+
+        for (TensorPtr<T> &tensor : _tensorParameters)
+            _masterWeights.insert(_masterWeights.end(), tensor->_data.begin(), tensor->_data.end());
+    }
+}
+
+// Returns false if the step has to be skipped, because the scaled gradients overflowed.
+template <typename T> bool Optimizer<T>::unscaleGradients() {
+    _unscale = 1 / _lossScale;
+    if (!_dynamicLossScale)
+        return true;
+
+    bool finite = true;
+    for (ValuePtr<T> &val : _parameters)
+        finite = finite && std::isfinite(static_cast<double>(val->_gradient));
+
+    for (TensorPtr<T> &tensor : _tensorParameters) {
+        const Type::Accumulator<T> *gradient = tensor->gradient();
+        for (size_t i = 0; i < tensor->size() && finite; ++i)
+            finite = std::isfinite(static_cast<double>(gradient[i]));
+    }
+
+    if (!finite) {
+        _lossScale /= 2;
+        _stepsWithoutOverflow = 0;
+        return false;
+    }
+
+    if (++_stepsWithoutOverflow == lossScaleGrowthInterval) {
+        _lossScale *= 2;
+        _stepsWithoutOverflow = 0;
+    }
+
+    return true;
+}
+
+// Calls update(index, data, gradient) for every scalar parameter, counting tensor elements one by one. The gradients
+// are unscaled, and 16-bit parameters are seen through their float32 master weights. Layers gather their weights again
+// afterwards (see WeightCache).
+template <typename T> template <typename F> void Optimizer<T>::forEachParameter(F update) {
+    using Accumulator = Type::Accumulator<T>;
+
+    forEachParameter(update, [&](size_t index, Accumulator *data, const Accumulator *gradient, size_t size,
+                                 Accumulator unscale) {
+        for (size_t i = 0; i < size; ++i)
+            update(index + i, data[i], _unscale == 1 ? gradient[i] : gradient[i] * unscale);
+    });
+}
+
+// Like forEachParameter(update), but tensors of float or double are passed to updateTensor(index, data, gradient, size,
+// unscale) as a whole, with gradients that still have to be multiplied by unscale, so that they can go through the
+// vectorized kernels.
+template <typename T>
+template <typename F, typename G>
+void Optimizer<T>::forEachParameter(F update, G updateTensor) {
+    using Accumulator = Type::Accumulator<T>;
+    WeightCache<T>::invalidate();
+    Accumulator unscale = static_cast<Accumulator>(_unscale);
+
+    auto visit = [&](size_t index, T &data, Accumulator gradient) {
+        if constexpr (Type::isReduced<T>) {
+            update(index, _masterWeights[index], gradient * unscale);
+            data = _masterWeights[index];
+        } else {
+            update(index, data, _unscale == 1 ? gradient : gradient * unscale);
+        }
+    };
+
+    size_t index = 0;
+    for (ValuePtr<T> &val : _parameters)
+        visit(index++, val->_data, val->_gradient);
+
+    for (TensorPtr<T> &tensor : _tensorParameters) {
+        const Accumulator *gradient = tensor->gradient();
+        if constexpr (Type::isReduced<T>) {
+            for (size_t i = 0; i < tensor->size(); ++i)
+                visit(index++, tensor->_data[i], gradient[i]);
+        } else {
+            updateTensor(index, tensor->_data.data(), gradient, tensor->size(), unscale);
+            index += tensor->size();
+        }
+    }
 }
 
 template <typename T> void Optimizer<T>::reset() {
+    NodeStatistics::resetPeak();
+    if (_scalesLoss)
+        LossScale::setCurrent(_lossScale);
+    if (_arena != nullptr)
+        GraphArena::setCurrent(_arena);
+    if (_tape != nullptr) {
+        _tape->clear();
+        Tape<T>::setCurrent(_tape);
+    }
+
     for (ValuePtr<T> &val : _parameters)
         val->_gradient = 0;
+
+    for (TensorPtr<T> &tensor : _tensorParameters)
+        std::fill(tensor->gradient(), tensor->gradient() + tensor->size(), 0);
 }
 
 template <typename T> void Optimizer<T>::step() {
-    std::for_each(_parameters.begin(), _parameters.end(),
-                  [this](ValuePtr<T> val) { val->_data -= _learningRate * val->_gradient; });
+    Profiler::Span span("Optimizer::step", "Optimizer");
+    if (!unscaleGradients())
+        return;
+
+    using Accumulator = Type::Accumulator<T>;
+    forEachParameter([this](size_t, Accumulator &data, Accumulator gradient) { data -= _learningRate * gradient; },
+                     [this](size_t, Accumulator *data, const Accumulator *gradient, size_t size, Accumulator unscale) {
+                         Kernels::axpy(-_learningRate * unscale, gradient, data, size);
+                     });
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class Optimizer<Type::float32>;
+extern template class Optimizer<Type::float64>;
+#endif
+
 } // namespace shkyera
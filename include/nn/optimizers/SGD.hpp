@@ -10,6 +10,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "../../core/Kernels.hpp"
 #include "../../core/Type.hpp"
 #include "../../core/Value.hpp"
 #include "../Module.hpp"
@@ -19,37 +20,56 @@ namespace shkyera {
 
 template <typename T> class SGD;
 using SGD32 = SGD<Type::float32>;
-using SGD64 = SGD<Type::float32>;
+using SGD64 = SGD<Type::float64>;
 
 template <typename T> class SGD : public Optimizer<T> {
   private:
-    T _momentum;
-    std::vector<T> _moments;
+    Type::Accumulator<T> _momentum;
+    std::vector<Type::Accumulator<T>> _moments;
 
   public:
-    SGD(std::vector<ValuePtr<T>> params, T learningRate, T momentum = 0.9);
+    template <typename P>
+    SGD(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> momentum = 0.9);
 
     void step() override;
 };
 
 template <typename T>
-SGD<T>::SGD(std::vector<ValuePtr<T>> params, T learningRate, T momentum) : Optimizer<T>(params, learningRate) {
+template <typename P>
+SGD<T>::SGD(const std::vector<P> &params, Type::Accumulator<T> learningRate, Type::Accumulator<T> momentum)
+    : Optimizer<T>(params, learningRate) {
     _momentum = momentum;
-    _moments.resize(params.size(), 0);
+    _moments.resize(this->parameterCount(), 0);
 }
 
 template <typename T> void SGD<T>::step() {
+    Profiler::Span span("SGD::step", "Optimizer");
     static bool initialized = false;
+    if (!this->unscaleGradients())
+        return;
 
-    for (size_t i = 0; i < this->_parameters.size(); ++i) {
-        const ValuePtr<T> &param = this->_parameters[i];
+    using Accumulator = Type::Accumulator<T>;
+    this->forEachParameter(
+        [this](size_t i, Accumulator &data, Accumulator gradient) {
+            Accumulator moment = initialized ? _momentum * _moments[i] + (1 - _momentum) * gradient : gradient;
+            _moments[i] = moment;
 
-        T gradient = param->getGradient();
-        T moment = initialized ? _momentum * _moments[i] + (1 - _momentum) * gradient : gradient;
-        _moments[i] = moment;
+            data -= this->_learningRate * moment;
+        },
+        [this](size_t index, Accumulator *data, const Accumulator *gradient, size_t size, Accumulator unscale) {
+            Accumulator *moments = _moments.data() + index;
+            for (size_t i = 0; i < size; ++i) {
+                Accumulator unscaled = gradient[i] * unscale;
+                moments[i] = initialized ? _momentum * moments[i] + (1 - _momentum) * unscaled : unscaled;
+            }
 
-        param->_data -= this->_learningRate * moment;
-    }
+            Kernels::axpy(-this->_learningRate, moments, data, size);
+        });
 }
 
+#ifdef SHKYERA_COMPILED_LIBRARY
+extern template class SGD<Type::float32>;
+extern template class SGD<Type::float64>;
+#endif
+
 } // namespace shkyera
@@ -0,0 +1,58 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+// Compiled part of the library. Programs that define SHKYERA_COMPILED_LIBRARY see the instantiations below as extern
+// templates and link them from here, instead of compiling them in every translation unit.
+
+#include "../include/ShkyeraGrad.hpp"
+
+// The headers only declare stb_image in this mode, so its implementation goes here.
+#define STB_IMAGE_IMPLEMENTATION
+#include "../include/external/stb_image.h"
+
+namespace shkyera {
+
+#define SHKYERA_INSTANTIATE(T)                                                                                         \
+    template class Value<T>;                                                                                           \
+    template ValuePtr<T> operator+(ValuePtr<T> a, ValuePtr<T> b);                                                      \
+    template ValuePtr<T> operator-(ValuePtr<T> a, ValuePtr<T> b);                                                      \
+    template ValuePtr<T> operator*(ValuePtr<T> a, ValuePtr<T> b);                                                      \
+    template ValuePtr<T> operator/(ValuePtr<T> a, ValuePtr<T> b);                                                      \
+    template ValuePtr<T> operator-(ValuePtr<T> a);                                                                     \
+    template class Vector<T>;                                                                                          \
+    template class Linear<T>;                                                                                          \
+    template class Conv2D<T>;                                                                                          \
+    template class MaxPool2D<T>;                                                                                       \
+    template class AvgPool2D<T>;                                                                                       \
+    template class BatchNorm1d<T>;                                                                                     \
+    template class LayerNorm<T>;                                                                                       \
+    template class Optimizer<T>;                                                                                       \
+    template class SGD<T>;                                                                                             \
+    template class NAG<T>;                                                                                             \
+    template class Adam<T>;                                                                                            \
+    template class AdaMax<T>;                                                                                          \
+    template Loss::Function<T> Loss::MSE<T>;                                                                           \
+    template Loss::Function<T> Loss::MAE<T>;                                                                           \
+    template Loss::Function<T> Loss::CrossEntropy<T>;                                                                  \
+    template Loss::Function<T> Loss::SoftmaxCrossEntropy<T>;                                                           \
+    template Loss::TensorFunction<T> Loss::TensorMSE<T>;                                                               \
+    template Loss::TensorFunction<T> Loss::TensorMAE<T>;                                                               \
+    template Loss::TensorFunction<T> Loss::TensorCrossEntropy<T>;                                                      \
+    template Loss::TensorFunction<T> Loss::TensorSoftmaxCrossEntropy<T>;                                               \
+    template ValuePtr<T> Loss::compute(Loss::Function<T>, const Vector<T>, const Vector<T>);                           \
+    template ValuePtr<T> Loss::compute(Loss::Function<T>, const Batch<T>, const Batch<T>);                             \
+    template TensorPtr<T> Loss::compute(Loss::TensorFunction<T>, const TensorPtr<T>, const TensorPtr<T>);              \
+    template ValuePtr<T> Loss::evaluate(Loss::Function<T>, const Vector<T>, const Vector<T>);                          \
+    template ValuePtr<T> Loss::evaluate(Loss::Function<T>, const Batch<T>, const Batch<T>);                            \
+    template TensorPtr<T> Loss::evaluate(Loss::TensorFunction<T>, const TensorPtr<T>, const TensorPtr<T>);
+
+SHKYERA_INSTANTIATE(Type::float32)
+SHKYERA_INSTANTIATE(Type::float64)
+
+#undef SHKYERA_INSTANTIATE
+
+} // namespace shkyera
@@ -0,0 +1,127 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+#include "../include/ShkyeraGrad.hpp"
+
+/**
+ * Finite-difference checks of the gradients of modules. A module is applied to a few samples, and its outputs are
+ * weighted and summed up into a loss, whose gradients with respect to the inputs and the parameters are compared with
+ * central differences.
+ */
+namespace shkyera::test {
+
+inline int failures = 0;
+
+// Parameters are moved through an optimizer, which also invalidates the cached copies of the weights.
+template <typename T> class Nudge : public Optimizer<T> {
+  public:
+    Nudge(const std::vector<ValuePtr<T>> &parameters) : Optimizer<T>(parameters, 0) {}
+
+    void shift(size_t parameter, T step) {
+        this->forEachParameter([&](size_t index, Type::Accumulator<T> &data, Type::Accumulator<T>) {
+            if (index == parameter)
+                data += step;
+        });
+    }
+};
+
+// Computes the loss for the given inputs, and with a gradient to fill, also their gradients.
+template <typename T> using Evaluate = std::function<T(const std::vector<T> &inputs, std::vector<T> *gradient)>;
+
+template <typename T> T weight(size_t index) { return static_cast<T>(std::cos(1.7 * static_cast<double>(index))); }
+
+template <typename T> Evaluate<T> onBatch(const ModulePtr<T> &module, size_t samples) {
+    return [module, samples](const std::vector<T> &inputs, std::vector<T> *gradient) {
+        const size_t width = inputs.size() / samples;
+        Batch<T> x(samples);
+        for (size_t s = 0; s < samples; ++s)
+            x[s] = Vector<T>::of(std::vector<T>(inputs.begin() + s * width, inputs.begin() + (s + 1) * width));
+
+        Batch<T> y = (*module)(x);
+        std::vector<ValuePtr<T>> terms;
+        for (const Vector<T> &output : y)
+            for (size_t i = 0; i < output.size(); ++i)
+                terms.push_back(output[i] * Value<T>::create(weight<T>(terms.size())));
+        ValuePtr<T> loss = Value<T>::sum(terms);
+
+        if (gradient) {
+            loss->backward();
+            for (size_t s = 0; s < samples; ++s)
+                for (size_t i = 0; i < width; ++i)
+                    (*gradient)[s * width + i] = x[s][i]->getGradient();
+        }
+        return loss->getValue();
+    };
+}
+
+template <typename T> Evaluate<T> onTensor(const ModulePtr<T> &module, size_t samples) {
+    return [module, samples](const std::vector<T> &inputs, std::vector<T> *gradient) {
+        TensorPtr<T> x = Tensor<T>::of({samples, inputs.size() / samples}, inputs);
+        TensorPtr<T> y = (*module)(x);
+
+        std::vector<T> weights(y->size());
+        for (size_t i = 0; i < weights.size(); ++i)
+            weights[i] = weight<T>(i);
+        TensorPtr<T> loss = (y * Tensor<T>::of(y->shape(), weights))->sum();
+
+        if (gradient) {
+            loss->backward();
+            for (size_t i = 0; i < inputs.size(); ++i)
+                (*gradient)[i] = x->getGradient(i);
+        }
+        return loss->getValue();
+    };
+}
+
+template <typename T>
+void expectNear(const std::string &what, T actual, T expected, T tolerance) {
+    if (std::abs(actual - expected) <= tolerance * (1 + std::abs(expected)))
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+template <typename T>
+void expectGradients(const std::string &what, const std::vector<ValuePtr<T>> &parameters,
+                     const std::vector<T> &inputs, const Evaluate<T> &evaluate, T step = 1e-6, T tolerance = 1e-6) {
+    Nudge<T> nudge(parameters);
+    nudge.reset();
+
+    std::vector<T> gradient(inputs.size());
+    evaluate(inputs, &gradient);
+    std::vector<T> parameterGradient;
+    for (const ValuePtr<T> &parameter : parameters)
+        parameterGradient.push_back(parameter->getGradient());
+
+    std::vector<T> x = inputs;
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = inputs[i] + step;
+        const T plus = evaluate(x, nullptr);
+        x[i] = inputs[i] - step;
+        const T minus = evaluate(x, nullptr);
+        x[i] = inputs[i];
+        expectNear<T>(what + " input " + std::to_string(i), gradient[i], (plus - minus) / (2 * step), tolerance);
+    }
+
+    for (size_t p = 0; p < parameters.size(); ++p) {
+        nudge.shift(p, step);
+        const T plus = evaluate(inputs, nullptr);
+        nudge.shift(p, -2 * step);
+        const T minus = evaluate(inputs, nullptr);
+        nudge.shift(p, step);
+        expectNear<T>(what + " parameter " + std::to_string(p), parameterGradient[p], (plus - minus) / (2 * step),
+                      tolerance);
+    }
+}
+
+} // namespace shkyera::test
@@ -0,0 +1,52 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include "GradientCheck.hpp"
+
+using namespace shkyera;
+using T = Type::float64;
+
+namespace {
+
+const size_t samples = 2;
+
+// Strides and paddings that leave pixels out of some windows and put them into several others.
+void convolutionGradients() {
+    for (auto [kernel, stride, padding] : {std::tuple<size_t, size_t, size_t>{3, 1, 0}, {3, 2, 1}, {2, 3, 2}}) {
+        const ImageShape shape{2, 5, 6};
+        auto conv = Conv2D64::create(shape, 3, kernel, stride, padding);
+        const std::vector<T> inputs = utils::sample<T>(-1, 1, samples * shape.size());
+
+        const std::string what = "Conv2D " + std::to_string(kernel) + "/" + std::to_string(stride) + "/" +
+                                 std::to_string(padding);
+        test::expectGradients<T>(what + " on a Batch", conv->parameters(), inputs, test::onBatch<T>(conv, samples));
+        test::expectGradients<T>(what + " on a Tensor", conv->parameters(), inputs, test::onTensor<T>(conv, samples));
+    }
+}
+
+template <typename Pool> void poolingGradients(const std::string &name) {
+    for (auto [size, stride, padding] : {std::tuple<size_t, size_t, size_t>{2, 2, 0}, {3, 2, 1}, {3, 1, 1}}) {
+        const ImageShape shape{2, 5, 7};
+        auto pool = Pool::create(shape, size, stride, padding);
+        const std::vector<T> inputs = utils::sample<T>(-1, 1, samples * shape.size());
+
+        const std::string what =
+            name + " " + std::to_string(size) + "/" + std::to_string(stride) + "/" + std::to_string(padding);
+        test::expectGradients<T>(what + " on a Batch", {}, inputs, test::onBatch<T>(pool, samples));
+        test::expectGradients<T>(what + " on a Tensor", {}, inputs, test::onTensor<T>(pool, samples));
+    }
+}
+
+} // namespace
+
+int main() {
+    utils::generator.seed(23);
+    convolutionGradients();
+    poolingGradients<MaxPool2D64>("MaxPool2D");
+    poolingGradients<AvgPool2D64>("AvgPool2D");
+    return test::failures == 0 ? 0 : 1;
+}
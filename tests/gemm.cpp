@@ -0,0 +1,122 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "../include/ShkyeraGrad.hpp"
+
+using namespace shkyera;
+
+namespace {
+
+int failures = 0;
+
+struct Shape {
+    size_t m, n, k;
+};
+
+template <typename T> std::vector<T> randomMatrix(std::mt19937 &generator, size_t size) {
+    std::uniform_real_distribution<T> distribution(-1, 1);
+    std::vector<T> matrix(size);
+    for (T &element : matrix)
+        element = distribution(generator);
+    return matrix;
+}
+
+// C = alpha * op(A) * op(B) + beta * C, one dot product at a time, with every term summed up in its magnitude.
+template <typename T>
+void naive(bool transposeA, bool transposeB, const Shape &shape, T alpha, const std::vector<T> &a, size_t lda,
+           const std::vector<T> &b, size_t ldb, T beta, std::vector<T> &c, std::vector<T> &magnitude, size_t ldc) {
+    for (size_t i = 0; i < shape.m; ++i) {
+        for (size_t j = 0; j < shape.n; ++j) {
+            double total = 0, absolute = 0;
+            for (size_t p = 0; p < shape.k; ++p) {
+                double term = static_cast<double>(transposeA ? a[p * lda + i] : a[i * lda + p]) *
+                              static_cast<double>(transposeB ? b[j * ldb + p] : b[p * ldb + j]);
+                total += term;
+                absolute += std::abs(term);
+            }
+            T &element = c[i * ldc + j];
+            magnitude[i * ldc + j] = static_cast<T>(std::abs(alpha) * absolute + std::abs(beta * element));
+            element = static_cast<T>(alpha * total + (beta == T(0) ? 0 : beta * element));
+        }
+    }
+}
+
+template <typename T> void multiplyMatchesTheNaiveProduct(const std::string &prefix, const Shape &shape) {
+    std::mt19937 generator(static_cast<unsigned>(shape.m * 10007 + shape.n * 101 + shape.k));
+
+    for (bool transposeA : {false, true}) {
+        for (bool transposeB : {false, true}) {
+            // Leading dimensions are padded, so that reading past the end of a row is caught.
+            const size_t lda = (transposeA ? shape.m : shape.k) + 3;
+            const size_t ldb = (transposeB ? shape.k : shape.n) + 2;
+            const size_t ldc = shape.n + 1;
+            const std::vector<T> a = randomMatrix<T>(generator, (transposeA ? shape.k : shape.m) * lda);
+            const std::vector<T> b = randomMatrix<T>(generator, (transposeB ? shape.n : shape.k) * ldb);
+            const std::vector<T> c = randomMatrix<T>(generator, shape.m * ldc);
+
+            for (auto [alpha, beta] : {std::pair<T, T>{1, 0}, {T(0.5), 1}, {-2, T(0.25)}, {0, T(0.5)}}) {
+                std::vector<T> expected = c, magnitude(c.size());
+                naive(transposeA, transposeB, shape, alpha, a, lda, b, ldb, beta, expected, magnitude, ldc);
+
+                std::vector<T> actual = c;
+                Gemm::multiply(transposeA, transposeB, shape.m, shape.n, shape.k, alpha, a.data(), lda, b.data(), ldb,
+                               beta, actual.data(), ldc);
+
+                const std::string what = prefix + std::to_string(shape.m) + "x" + std::to_string(shape.n) + "x" +
+                                         std::to_string(shape.k) + (transposeA ? " A^T" : " A") +
+                                         (transposeB ? " B^T" : " B") + " alpha " + std::to_string(alpha) +
+                                         " beta " + std::to_string(beta);
+                for (size_t i = 0; i < shape.m; ++i) {
+                    for (size_t j = 0; j < ldc; ++j) {
+                        const size_t index = i * ldc + j;
+                        // The padding of C must be left alone.
+                        const T tolerance = j < shape.n ? 4 * (shape.k + 2) * std::numeric_limits<T>::epsilon() *
+                                                              magnitude[index]
+                                                        : 0;
+                        if (std::abs(actual[index] - expected[index]) <= tolerance)
+                            continue;
+                        std::cerr << what << ", C[" << i << "][" << j << "]: got " << actual[index] << ", expected "
+                                  << expected[index] << std::endl;
+                        failures++;
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Vectors and single depths take their own paths, odd sizes leave partial tiles, and the large products are deeper
+// than a block and big enough to be shared between threads.
+const std::vector<Shape> shapes = {{1, 1, 1},    {1, 7, 5},     {9, 1, 5},     {5, 7, 0},    {6, 8, 1},
+                                   {13, 17, 1},  {7, 13, 19},   {6, 16, 16},   {31, 33, 29}, {121, 5, 67},
+                                   {3, 130, 41}, {65, 97, 300}, {97, 131, 73}, {201, 163, 67}};
+
+} // namespace
+
+int main() {
+    for (Kernels::Isa isa : {Kernels::Isa::Scalar, Kernels::Isa::SSE, Kernels::Isa::AVX2, Kernels::Isa::AVX512}) {
+        if (!Kernels::isSupported(isa))
+            continue;
+        Kernels::force(isa);
+
+        for (size_t threads : {1, 3, 8}) {
+            Gemm::setThreads(threads);
+            const std::string prefix = std::string(Kernels::name(isa)) + " " + std::to_string(threads) + " threads ";
+            for (const Shape &shape : shapes) {
+                multiplyMatchesTheNaiveProduct<float>(prefix + "float ", shape);
+                multiplyMatchesTheNaiveProduct<double>(prefix + "double ", shape);
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
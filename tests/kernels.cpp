@@ -0,0 +1,191 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "../include/ShkyeraGrad.hpp"
+
+using namespace shkyera;
+
+namespace {
+
+int failures = 0;
+
+std::vector<Kernels::Isa> supported() {
+    std::vector<Kernels::Isa> isas;
+    for (Kernels::Isa isa : {Kernels::Isa::Scalar, Kernels::Isa::SSE, Kernels::Isa::AVX2, Kernels::Isa::AVX512})
+        if (Kernels::isSupported(isa))
+            isas.push_back(isa);
+    return isas;
+}
+
+void expectEqual(const std::string &what, size_t actual, size_t expected) {
+    if (actual == expected)
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+// Infinities and NaNs have to match exactly, finite values within a few units in the last place, or in the last
+// place of the smallest subnormal.
+template <typename T> void expectClose(const std::string &what, T actual, T expected, T ulps) {
+    bool same;
+    if (std::isnan(expected))
+        same = std::isnan(actual);
+    else if (std::isinf(expected))
+        same = actual == expected;
+    else
+        same = std::abs(actual - expected) <= ulps * (std::numeric_limits<T>::epsilon() * std::abs(expected) +
+                                                      std::numeric_limits<T>::denorm_min());
+    if (same)
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+// Around the largest finite result, the smallest normal and the smallest subnormal one, and beyond.
+template <typename T> std::vector<T> expInputs() {
+    const T infinity = std::numeric_limits<T>::infinity();
+    std::vector<T> inputs = {std::numeric_limits<T>::quiet_NaN(), infinity, -infinity, 0, -0.0, 1, -1, 0.5, 10, -10};
+    if constexpr (std::is_same_v<T, float>) {
+        for (T x : {88.3f, 88.37f, 88.5f, 88.72f, 88.7228f, 88.723f, 89.0f, 100.0f, -87.3f, -87.5f, -100.0f, -103.2f,
+                    -103.9f, -104.0f, -105.0f, -1000.0f})
+            inputs.push_back(x);
+    } else {
+        for (T x : {709.0, 709.78, 709.79, 710.0, 1000.0, -708.0, -708.5, -740.0, -745.0, -745.2, -746.0, -800.0})
+            inputs.push_back(x);
+    }
+
+    const T lowest = std::log(std::numeric_limits<T>::denorm_min()) - 2;
+    const T highest = std::log(std::numeric_limits<T>::max()) + 2;
+    for (size_t i = 0; i <= 1000; ++i)
+        inputs.push_back(lowest + (highest - lowest) * static_cast<T>(i) / 1000);
+    return inputs;
+}
+
+template <typename T> void expMatchesTheStandardLibrary(Kernels::Isa isa) {
+    std::vector<T> x = expInputs<T>();
+    std::vector<T> y(x.size());
+    Kernels::activate(Kernels::Activation::Exp, x.data(), y.data(), x.size());
+
+    for (size_t i = 0; i < x.size(); ++i) {
+        const std::string what = std::string(Kernels::name(isa)) + " exp(" + std::to_string(x[i]) + ")";
+        expectClose<T>(what, y[i], std::exp(x[i]), 4);
+    }
+}
+
+// Activations built on exp(), far from zero and at NaN.
+template <typename T> void activationsPassNaNAndSaturate(Kernels::Isa isa) {
+    const T nan = std::numeric_limits<T>::quiet_NaN();
+    const T infinity = std::numeric_limits<T>::infinity();
+    const std::vector<T> x = {nan, infinity, -infinity, 50, -50, 200, -200, 1000, -1000};
+
+    for (Kernels::Activation activation : {Kernels::Activation::Sigmoid, Kernels::Activation::Tanh}) {
+        std::vector<T> y(x.size());
+        Kernels::activate(activation, x.data(), y.data(), x.size());
+
+        const bool sigmoid = activation == Kernels::Activation::Sigmoid;
+        for (size_t i = 0; i < x.size(); ++i) {
+            const std::string what =
+                std::string(Kernels::name(isa)) + (sigmoid ? " sigmoid(" : " tanh(") + std::to_string(x[i]) + ")";
+            expectClose<T>(what, y[i], sigmoid ? 1 / (1 + std::exp(-x[i])) : std::tanh(x[i]), 4);
+        }
+    }
+}
+
+template <typename T> std::vector<T> randomArray(std::mt19937 &generator, size_t size) {
+    std::uniform_real_distribution<T> distribution(-4, 4);
+    std::vector<T> x(size);
+    for (T &element : x)
+        element = distribution(generator);
+    return x;
+}
+
+// Differences between instruction sets come from reordered sums and fused multiply-adds, so they are bounded by the
+// magnitude of the terms rather than of the result.
+template <typename T> void expectWithin(const std::string &what, T actual, T expected, T magnitude) {
+    if (std::abs(actual - expected) <= 16 * std::numeric_limits<T>::epsilon() * magnitude)
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+// Every kernel against the portable one, on sizes around the widths of the registers and their unrolled loops.
+template <typename T> void matchesTheScalarKernels(Kernels::Isa isa) {
+    const std::string prefix = std::string(Kernels::name(isa)) + (std::is_same_v<T, float> ? " float " : " double ");
+    std::mt19937 generator(42);
+
+    for (size_t size : {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 63, 64, 65, 100, 255, 257, 1000}) {
+        const std::string what = prefix + std::to_string(size) + " ";
+        const std::vector<T> a = randomArray<T>(generator, size);
+        const std::vector<T> b = randomArray<T>(generator, size);
+        std::vector<T> withTies = a;
+        if (size > 2)
+            withTies[size / 3] = withTies[size - 1] = *std::max_element(a.begin(), a.end()) + 1;
+
+        T magnitude = 1;
+        for (size_t i = 0; i < size; ++i)
+            magnitude += std::abs(a[i] * b[i]) + std::abs(a[i]);
+
+        Kernels::force(Kernels::Isa::Scalar);
+        const T dot = Kernels::dot(a.data(), b.data(), size);
+        const T sum = Kernels::sum(a.data(), size);
+        const size_t argMax = Kernels::argMax(a.data(), size);
+        const size_t argMaxWithTies = Kernels::argMax(withTies.data(), size);
+        std::vector<T> axpy = b;
+        Kernels::axpy<T>(T(0.75), a.data(), axpy.data(), size);
+
+        Kernels::force(isa);
+        expectWithin<T>(what + "dot", Kernels::dot(a.data(), b.data(), size), dot, magnitude);
+        expectWithin<T>(what + "sum", Kernels::sum(a.data(), size), sum, magnitude);
+        expectEqual(what + "argMax", Kernels::argMax(a.data(), size), argMax);
+        expectEqual(what + "argMax with ties", Kernels::argMax(withTies.data(), size), argMaxWithTies);
+        std::vector<T> y = b;
+        Kernels::axpy<T>(T(0.75), a.data(), y.data(), size);
+        for (size_t i = 0; i < size; ++i)
+            expectWithin<T>(what + "axpy", y[i], axpy[i], std::abs(a[i]) + std::abs(b[i]));
+
+        for (Kernels::Activation activation : {Kernels::Activation::ReLU, Kernels::Activation::Sigmoid,
+                                               Kernels::Activation::Tanh, Kernels::Activation::Exp}) {
+            const std::string name = what + "activation " + std::to_string(static_cast<int>(activation));
+
+            Kernels::force(Kernels::Isa::Scalar);
+            std::vector<T> forward(size), backward = b;
+            Kernels::activate(activation, a.data(), forward.data(), size);
+            Kernels::derivative(activation, forward.data(), a.data(), backward.data(), size);
+
+            Kernels::force(isa);
+            std::vector<T> output(size), gradient = b;
+            Kernels::activate(activation, a.data(), output.data(), size);
+            Kernels::derivative(activation, forward.data(), a.data(), gradient.data(), size);
+            for (size_t i = 0; i < size; ++i) {
+                expectWithin<T>(name, output[i], forward[i], std::abs(forward[i]) + 1);
+                expectWithin<T>(name + " derivative", gradient[i], backward[i],
+                                std::abs(a[i] * (forward[i] * forward[i] + forward[i] + 1)) + std::abs(b[i]));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    for (Kernels::Isa isa : supported()) {
+        Kernels::force(isa);
+        expMatchesTheStandardLibrary<float>(isa);
+        expMatchesTheStandardLibrary<double>(isa);
+        activationsPassNaNAndSaturate<float>(isa);
+        activationsPassNaNAndSaturate<double>(isa);
+        matchesTheScalarKernels<float>(isa);
+        matchesTheScalarKernels<double>(isa);
+    }
+    return failures == 0 ? 0 : 1;
+}
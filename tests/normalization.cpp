@@ -0,0 +1,116 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include "GradientCheck.hpp"
+
+using namespace shkyera;
+using T = Type::float64;
+
+namespace {
+
+const size_t samples = 4;
+const size_t features = 5;
+
+// Moves the scales and shifts away from 1 and 0, so that their gradients are not hidden.
+void perturb(const std::vector<ValuePtr<T>> &parameters) {
+    test::Nudge<T> nudge(parameters);
+    std::vector<T> steps = utils::sample<T>(-0.5, 0.5, parameters.size());
+    for (size_t p = 0; p < parameters.size(); ++p)
+        nudge.shift(p, steps[p]);
+}
+
+Batch<T> randomBatch(size_t size, size_t width) {
+    Batch<T> batch;
+    for (size_t s = 0; s < size; ++s)
+        batch.push_back(Vec64::of(utils::sample<T>(-2, 2, width)));
+    return batch;
+}
+
+void batchNormGradients() {
+    auto norm = BatchNorm1d64::create(features);
+    perturb(norm->parameters());
+    const std::vector<T> inputs = utils::sample<T>(-2, 2, samples * features);
+
+    test::expectGradients<T>("BatchNorm1d in training on a Batch", norm->parameters(), inputs,
+                             test::onBatch<T>(norm, samples));
+    test::expectGradients<T>("BatchNorm1d in training on a Tensor", norm->parameters(), inputs,
+                             test::onTensor<T>(norm, samples));
+
+    for (size_t i = 0; i < 10; ++i)
+        (*norm)(randomBatch(samples, features));
+    norm->setTraining(false);
+
+    test::expectGradients<T>("BatchNorm1d in evaluation on a Batch", norm->parameters(), inputs,
+                             test::onBatch<T>(norm, samples));
+    test::expectGradients<T>("BatchNorm1d in evaluation on a Tensor", norm->parameters(), inputs,
+                             test::onTensor<T>(norm, samples));
+    test::expectGradients<T>("BatchNorm1d in evaluation on a Vector", norm->parameters(),
+                             std::vector<T>(inputs.begin(), inputs.begin() + features), test::onBatch<T>(norm, 1));
+}
+
+void layerNormGradients() {
+    auto norm = LayerNorm64::create(features);
+    perturb(norm->parameters());
+    const std::vector<T> inputs = utils::sample<T>(-2, 2, samples * features);
+
+    test::expectGradients<T>("LayerNorm on a Batch", norm->parameters(), inputs, test::onBatch<T>(norm, samples));
+    test::expectGradients<T>("LayerNorm on a Tensor", norm->parameters(), inputs, test::onTensor<T>(norm, samples));
+}
+
+// A folded model gives the outputs of the original one in evaluation, and folding draws nothing from the generator.
+void foldingKeepsTheOutputs() {
+    auto first = BatchNorm1d64::create(6);
+    auto second = BatchNorm1d64::create(3);
+    auto model = SequentialBuilder<T>::begin()
+                     .add(Linear64::create(features, 6))
+                     .add(first)
+                     .add(Tanh64::create())
+                     .add(Linear64::create(6, 3))
+                     .add(second)
+                     .build();
+    perturb(first->parameters());
+    perturb(second->parameters());
+
+    for (size_t i = 0; i < 10; ++i)
+        model->forward(randomBatch(samples, features));
+    first->setTraining(false);
+    second->setTraining(false);
+
+    const auto generator = utils::generator;
+    auto folded = BatchNorm1d<T>::fold(model);
+    if (!(generator == utils::generator)) {
+        std::cerr << "BatchNorm1d::fold drew from the generator" << std::endl;
+        test::failures++;
+    }
+    if (folded->getLayers().size() != 3) {
+        std::cerr << "BatchNorm1d::fold left " << folded->getLayers().size() << " layers, expected 3" << std::endl;
+        test::failures++;
+    }
+
+    const Batch<T> x = randomBatch(samples, features);
+    const Batch<T> expected = model->forward(x);
+    const Batch<T> actual = folded->forward(x);
+    const TensorPtr<T> tensor = folded->forward(Tensor<T>::of(x));
+    for (size_t s = 0; s < samples; ++s) {
+        for (size_t o = 0; o < 3; ++o) {
+            const std::string what = "folded output " + std::to_string(s) + "/" + std::to_string(o);
+            test::expectNear<T>(what, actual[s][o]->getValue(), expected[s][o]->getValue(), 1e-12);
+            test::expectNear<T>(what + " of a Tensor", tensor->getValue(s * 3 + o), expected[s][o]->getValue(),
+                                1e-12);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    utils::generator.seed(24);
+    batchNormGradients();
+    layerNormGradients();
+    foldingKeepsTheOutputs();
+    return test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include "../include/ShkyeraGrad.hpp"
+
+using namespace shkyera;
+using T = Type::float64;
+
+namespace {
+
+int failures = 0;
+
+void expectNear(const std::string &what, T actual, T expected) {
+    if (std::isfinite(actual) && std::abs(actual - expected) <= 1e-9 * std::max<T>(1, std::abs(expected)))
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+// The loss and the gradients of the parameters after a replay have to match an eager run on the same batch.
+void replaysSoftmaxCrossEntropyFarFromCapture() {
+    std::vector<ValuePtr<T>> shift = {Value<T>::create(0.5), Value<T>::create(-0.25), Value<T>::create(1)};
+    auto step = [&](const Batch<T> &x, const Batch<T> &y) {
+        std::vector<ValuePtr<T>> logits;
+        for (size_t i = 0; i < shift.size(); ++i)
+            logits.push_back(x[0][i] + shift[i]);
+        return Loss::compute(Loss::SoftmaxCrossEntropy<T>, Vector<T>(logits), y[0]);
+    };
+
+    Optimizer<T> optimizer(shift, 0.1);
+    StaticGraph<T> graph(step);
+    Batch<T> targets = {Vec64::of(1, 0, 0)};
+    graph({Vec64::of(0.1, 0.2, 0.3)}, targets);
+
+    Batch<T> far = {Vec64::of(1000, 999, 998)};
+    optimizer.reset();
+    T replayed = graph(far, targets);
+    std::vector<T> replayedGradients;
+    for (const ValuePtr<T> &s : shift)
+        replayedGradients.push_back(s->getGradient());
+
+    optimizer.reset();
+    T eager = step(far, targets)->getValue();
+
+    expectNear("replays", graph.getReplays(), 1);
+    expectNear("loss", replayed, eager);
+    for (size_t i = 0; i < shift.size(); ++i)
+        expectNear("gradient " + std::to_string(i), replayedGradients[i], shift[i]->getGradient());
+}
+
+} // namespace
+
+int main() {
+    replaysSoftmaxCrossEntropyFarFromCapture();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * Copyright © 2023 Franciszek Szewczyk. None of the rights reserved.
+ * This code is released under the Beerware License. If you find this code useful or you appreciate the work, you are
+ * encouraged to buy the author a beer in return.
+ * Contact the author at szewczyk.franciszek02@gmail.com for inquiries and support.
+ */
+
+#include <iostream>
+
+#include "../include/ShkyeraGrad.hpp"
+
+using namespace shkyera;
+using T = Type::float32;
+
+namespace {
+
+int failures = 0;
+
+void expectEqual(const std::string &what, T actual, T expected) {
+    if (actual == expected)
+        return;
+    std::cerr << what << ": got " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+
+std::vector<T> gradients(const std::vector<ValuePtr<T>> &parameters) {
+    std::vector<T> result;
+    for (const ValuePtr<T> &parameter : parameters)
+        result.push_back(parameter->getGradient());
+    return result;
+}
+
+// Gradients of a small MLP trained on one sample at a time, computed on a tape or by the graph engine.
+std::vector<T> trainOnSamples(bool onTape, bool backwardTwice) {
+    utils::generator.seed(7);
+    auto model = SequentialBuilder<T>::begin()
+                     .add(Linear32::create(10, 24))
+                     .add(Tanh32::create())
+                     .add(Linear32::create(24, 12))
+                     .add(Sigmoid32::create())
+                     .add(Linear32::create(12, 5))
+                     .build();
+
+    Batch<T> x, y;
+    for (size_t s = 0; s < 8; ++s) {
+        x.push_back(Vec32::of(utils::sample<T>(-1, 1, 10)));
+        y.push_back(Vec32::of(utils::sample<T>(0, 1, 5)));
+    }
+
+    Tape<T> tape;
+    Optimizer<T> optimizer(model->parameters(), 0.1);
+    if (onTape)
+        optimizer.attach(tape);
+    optimizer.reset();
+
+    for (size_t s = 0; s < x.size(); ++s) {
+        ValuePtr<T> loss = Loss::compute(Loss::MSE<T>, model->forward(x[s]), y[s]);
+        if (backwardTwice)
+            loss->backward();
+    }
+
+    Tape<T>::setCurrent(nullptr);
+    return gradients(model->parameters());
+}
+
+// Both engines add up the gradients in the same order, so they agree to the last bit.
+void matchesTheGraphEngine() {
+    std::vector<T> graph = trainOnSamples(false, false);
+    std::vector<T> tape = trainOnSamples(true, false);
+    for (size_t i = 0; i < graph.size(); ++i)
+        expectEqual("gradient " + std::to_string(i), tape[i], graph[i]);
+}
+
+void ignoresASecondBackward() {
+    std::vector<T> once = trainOnSamples(true, false);
+    std::vector<T> twice = trainOnSamples(true, true);
+    for (size_t i = 0; i < once.size(); ++i)
+        expectEqual("gradient " + std::to_string(i), twice[i], once[i]);
+}
+
+} // namespace
+
+int main() {
+    matchesTheGraphEngine();
+    ignoresASecondBackward();
+    return failures == 0 ? 0 : 1;
+}